@@ -1,6 +1,10 @@
 param(
     [switch]
     $Verbose,
+    [switch]
+    $AllocStats,
+    [switch]
+    $Mimalloc,
     [ValidateSet("Debug", "RelWithDebInfo", "Release")]
     [string]
     $Config = "Release"
@@ -13,7 +17,11 @@ if (!$root) {
 
 $logLevel = if ($Verbose) { "STATUS" } else { "ERROR" }
 
-cmake --preset vcpkg --log-level=$logLevel
+$allocStats = if ($AllocStats) { "ON" } else { "OFF" }
+$mimalloc = if ($Mimalloc) { "ON" } else { "OFF" }
+
+cmake --preset vcpkg --log-level=$logLevel `
+    -DMOB_ALLOC_STATS="$allocStats" -DMOB_MIMALLOC="$mimalloc"
 
 if ($Verbose) {
     cmake --build --preset $Config --verbose
@@ -0,0 +1,482 @@
+#include "pch.h"
+#include "../core/conf.h"
+#include "../core/context.h"
+#include "../core/env.h"
+#include "../core/ini.h"
+#include "../core/op.h"
+#include "../core/paths.h"
+#include "../core/process.h"
+#include "../net.h"
+#include "../tasks/tasks.h"
+#include "../tools/tools.h"
+#include "../utility.h"
+#include "commands.h"
+
+namespace mob {
+
+    // number of processes started for each spawn measurement
+    constexpr std::size_t spawn_count = 20;
+
+    // number and size of files for the filesystem measurements
+    constexpr std::size_t small_file_count = 1000;
+    constexpr std::size_t small_file_size  = 4096;
+
+    // number of projects in the synthetic cmake project, at most
+    constexpr std::size_t max_compile_projects = 32;
+
+    // a job count is good enough if it's within this ratio of the fastest one
+    constexpr double good_enough_ratio = 1.1;
+
+    // estimated peak memory of one compiler process, used to cap the number of
+    // processes
+    constexpr std::uint64_t memory_per_process = 2ull * 1024 * 1024 * 1024;
+
+    // seconds since the given time point
+    //
+    double seconds_since(hr_clock::time_point start)
+    {
+        using namespace std::chrono;
+        return duration_cast<duration<double>>(hr_clock::now() - start).count();
+    }
+
+    bench_env_command::bench_env_command() : command(requires_options) {}
+
+    command::meta_t bench_env_command::meta() const
+    {
+        return {"bench-env", "measures this machine and recommends settings"};
+    }
+
+    clipp::group bench_env_command::do_group()
+    {
+        return clipp::group(
+            clipp::command("bench-env").set(picked_),
+
+            (clipp::option("-h", "--help") >> help_) % ("shows this message"),
+
+            (clipp::option("-o", "--output") & clipp::value("PATH") >> output_) %
+                "INI file to write, defaults to mob-bench.ini in the current "
+                "directory",
+
+            clipp::option("--force").set(force_) %
+                "overwrites the output file if it already exists",
+
+            (clipp::option("--url") & clipp::value("URL") >> url_) %
+                "URL to download for the download benchmark, defaults to the "
+                "explorer++ archive",
+
+            clipp::option("--no-download").set(download_, false) %
+                "skips the download benchmark",
+
+            clipp::option("--no-compile").set(compile_, false) %
+                "skips the compile benchmark");
+    }
+
+    std::string bench_env_command::do_doc()
+    {
+        return "Measures this machine and writes recommended values to an INI\n"
+               "file. Measures process spawn latency, small file throughput in\n"
+               "the prefix and the cache, download throughput and how well\n"
+               "builds scale with the number of parallel jobs.\n"
+               "\n"
+               "The output is written to mob-bench.ini in the current directory\n"
+               "by default, which is picked up automatically after mob.ini when\n"
+               "mob runs from there. Use --output with MOBINI or --ini otherwise.";
+    }
+
+    int bench_env_command::do_run()
+    {
+        const fs::path out = fs::absolute(
+            output_.empty() ? fs::path(bench_ini_filename()) : fs::path(output_));
+
+        // check before spending minutes on benchmarks
+        if (fs::exists(out)) {
+            if (fs::equivalent(out, find_in_root(default_ini_filename()))) {
+                u8cerr << "won't overwrite the master ini " << path_to_utf8(out)
+                       << "\n";
+                return 1;
+            }
+
+            if (!force_) {
+                u8cerr << path_to_utf8(out)
+                       << " already exists, use --force to overwrite it\n";
+                return 1;
+            }
+        }
+
+        results r;
+        r.cores  = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+        r.memory = total_memory();
+
+        u8cout << r.cores << " cores, " << (r.memory / 1024 / 1024)
+               << " MB of memory\n";
+
+        bench_spawn(r);
+        bench_files(r);
+
+        if (!download_)
+            u8cout << "download: skipped\n";
+        else if (conf().global().offline())
+            u8cout << "download: skipped, offline\n";
+        else
+            bench_download(r);
+
+        if (compile_)
+            bench_compile(r);
+        else
+            u8cout << "compile: skipped\n";
+
+        write_ini(r, out);
+
+        return 0;
+    }
+
+    std::uint64_t bench_env_command::total_memory()
+    {
+        MEMORYSTATUSEX ms = {};
+        ms.dwLength       = sizeof(ms);
+
+        if (!GlobalMemoryStatusEx(&ms))
+            return 0;
+
+        return ms.ullTotalPhys;
+    }
+
+    void bench_env_command::bench_spawn(results& r)
+    {
+        u8cout << "spawn: ";
+
+        // every process goes through cmd.exe, see process::make_cmd_args(), so the
+        // baseline is starting cmd directly and the second measurement is a
+        // process object running cmd, which is what tools actually pay
+        const fs::path cmd = utf8_to_utf16(this_env::get("COMSPEC"));
+
+        {
+            const auto start = hr_clock::now();
+
+            for (std::size_t i = 0; i < spawn_count; ++i) {
+                std::wstring cl = L"\"" + cmd.native() + L"\" /d /c exit";
+
+                STARTUPINFOW si = {};
+                si.cb           = sizeof(si);
+
+                PROCESS_INFORMATION pi = {};
+
+                if (!::CreateProcessW(cmd.native().c_str(), cl.data(), nullptr, nullptr,
+                                      FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &si,
+                                      &pi)) {
+                    const auto e = GetLastError();
+                    gcx().bail_out(context::generic, "failed to start {}, {}", cmd,
+                                   error_message(e));
+                }
+
+                ::WaitForSingleObject(pi.hProcess, INFINITE);
+                ::CloseHandle(pi.hThread);
+                ::CloseHandle(pi.hProcess);
+            }
+
+            r.spawn_direct_ms = seconds_since(start) * 1000 / spawn_count;
+        }
+
+        {
+            const auto start = hr_clock::now();
+
+            for (std::size_t i = 0; i < spawn_count; ++i) {
+                process().binary(cmd).arg("/d").arg("/c").arg("exit").run_and_join();
+            }
+
+            r.spawn_process_ms = seconds_since(start) * 1000 / spawn_count;
+        }
+
+        u8cout << std::format("{:.1f}ms direct, {:.1f}ms through cmd.exe\n",
+                              r.spawn_direct_ms, r.spawn_process_ms);
+    }
+
+    void bench_env_command::bench_files(results& r)
+    {
+        if (conf().global().dry()) {
+            u8cout << "files: skipped, dry run\n";
+            return;
+        }
+
+        r.prefix_files = bench_files_in(conf().path().prefix());
+
+        // only measure the cache if it's on another drive, it's in the prefix by
+        // default
+        const auto cache = conf().path().cache();
+
+        if (cache.root_name() != conf().path().prefix().root_name())
+            r.cache_files = bench_files_in(cache);
+    }
+
+    bench_env_command::file_results
+    bench_env_command::bench_files_in(const fs::path& root)
+    {
+        const auto dir = root / "_mob_bench_env";
+        const auto src = dir / "src";
+        const auto dst = dir / "dst";
+
+        u8cout << "files in " << path_to_utf8(root) << ": ";
+
+        op::create_directories(gcx(), src);
+        op::create_directories(gcx(), dst);
+
+        // always clean up, even if something fails
+        guard g([&] {
+            std::error_code ec;
+            fs::remove_all(dir, ec);
+        });
+
+        const std::string content(small_file_size, 'x');
+        file_results fr;
+
+        {
+            const auto start = hr_clock::now();
+
+            for (std::size_t i = 0; i < small_file_count; ++i) {
+                std::ofstream(src / std::to_string(i), std::ios::binary)
+                    .write(content.data(), content.size());
+            }
+
+            fr.create = small_file_count / seconds_since(start);
+        }
+
+        {
+            const auto start = hr_clock::now();
+
+            for (std::size_t i = 0; i < small_file_count; ++i) {
+                const auto name = std::to_string(i);
+
+                std::error_code ec;
+                fs::copy_file(src / name, dst / name, ec);
+
+                if (ec) {
+                    gcx().bail_out(context::fs, "can't copy {}, {}", src / name,
+                                   ec.message());
+                }
+            }
+
+            fr.copy = small_file_count / seconds_since(start);
+        }
+
+        {
+            const auto start = hr_clock::now();
+
+            for (std::size_t i = 0; i < small_file_count; ++i) {
+                const auto name = std::to_string(i);
+
+                std::error_code ec;
+                fs::remove(src / name, ec);
+                fs::remove(dst / name, ec);
+
+                if (ec) {
+                    gcx().bail_out(context::fs, "can't delete {}, {}", dst / name,
+                                   ec.message());
+                }
+            }
+
+            fr.remove = (small_file_count * 2) / seconds_since(start);
+        }
+
+        u8cout << std::format("create {:.0f}/s, copy {:.0f}/s, delete {:.0f}/s\n",
+                              fr.create, fr.copy, fr.remove);
+
+        return fr;
+    }
+
+    void bench_env_command::bench_download(results& r)
+    {
+        const mob::url u =
+            (url_.empty() ? tasks::explorerpp::source_url() : mob::url(url_));
+
+        u8cout << "download from " << u.string() << ": ";
+
+        const auto file = make_temp_file();
+
+        guard g([&] {
+            std::error_code ec;
+            fs::remove(file, ec);
+        });
+
+        curl_downloader dl;
+
+        const auto start = hr_clock::now();
+        dl.url(u).file(file).start().join();
+        const auto secs = seconds_since(start);
+
+        if (!dl.ok() || !fs::exists(file)) {
+            u8cout << "failed\n";
+            return;
+        }
+
+        const auto size = fs::file_size(file);
+
+        r.download_url = u.string();
+        r.download_mbs = (static_cast<double>(size) / 1024 / 1024) / secs;
+
+        u8cout << std::format("{:.1f} MB/s\n", r.download_mbs);
+    }
+
+    void bench_env_command::bench_compile(results& r)
+    {
+        const auto dir      = conf().path().build() / "_mob_bench_env";
+        const auto projects = std::min(r.cores, max_compile_projects);
+
+        u8cout << "compile: generating " << projects << " projects in "
+               << path_to_utf8(dir) << "\n";
+
+        guard g([&] {
+            std::error_code ec;
+            fs::remove_all(dir, ec);
+        });
+
+        write_compile_project(dir, projects);
+
+        // copy the global context, the tools will modify it
+        context cxcopy = gcx();
+
+        cmake(cmake::generate).generator(cmake::vs).root(dir).run(cxcopy);
+
+        // 1, 2, 4, etc. up to the number of projects, which is also the last one
+        // even if it's not a power of two
+        std::vector<std::size_t> jobs;
+
+        for (std::size_t j = 1; j < projects; j *= 2)
+            jobs.push_back(j);
+
+        jobs.push_back(projects);
+
+        for (auto j : jobs) {
+            const auto start = hr_clock::now();
+
+            cmake(cmake::build)
+                .generator(cmake::vs)
+                .root(dir)
+                .configuration(config::release)
+                .arg("--clean-first")
+                .arg("--parallel")
+                .arg(std::to_string(j))
+                .run(cxcopy);
+
+            const auto secs = seconds_since(start);
+            r.compile.push_back({j, secs});
+
+            u8cout << std::format("compile: {} jobs, {:.1f}s\n", j, secs);
+        }
+    }
+
+    void bench_env_command::write_compile_project(const fs::path& dir,
+                                                  std::size_t projects)
+    {
+        std::string cmakelists = "cmake_minimum_required(VERSION 3.16)\n"
+                                 "project(mob_bench_env CXX)\n";
+
+        for (std::size_t i = 0; i < projects; ++i) {
+            const auto name = std::format("bench{}", i);
+
+            cmakelists += std::format("add_library({} STATIC {}.cpp)\n", name, name);
+
+            // regex and iostreams are slow enough to compile that the time is
+            // dominated by the compiler and not by msbuild itself
+            const auto cpp = std::format("#include <regex>\n"
+                                         "#include <sstream>\n"
+                                         "#include <map>\n"
+                                         "\n"
+                                         "std::string {}(const std::string& s)\n"
+                                         "{{\n"
+                                         "    std::map<std::string, int> m;\n"
+                                         "    std::ostringstream oss;\n"
+                                         "    std::regex re(\"([a-z]+)([0-9]*)\");\n"
+                                         "    std::smatch sm;\n"
+                                         "    if (std::regex_match(s, sm, re))\n"
+                                         "        m[sm[1]] = {};\n"
+                                         "    oss << m.size();\n"
+                                         "    return oss.str();\n"
+                                         "}}\n",
+                                         name, i);
+
+            op::write_text_file(gcx(), encodings::utf8, dir / (name + ".cpp"), cpp);
+        }
+
+        op::write_text_file(gcx(), encodings::utf8, dir / "CMakeLists.txt",
+                            cmakelists);
+    }
+
+    void bench_env_command::write_ini(const results& r, const fs::path& out)
+    {
+        // build jobs: the fewest that are about as fast as the fastest
+        std::size_t build_jobs = 0;
+
+        if (!r.compile.empty()) {
+            double best = r.compile[0].seconds;
+            for (auto&& c : r.compile)
+                best = std::min(best, c.seconds);
+
+            for (auto&& c : r.compile) {
+                if (c.seconds <= best * good_enough_ratio) {
+                    build_jobs = c.jobs;
+                    break;
+                }
+            }
+        }
+
+        // processes: cores, but not more than memory can handle
+        std::size_t max_processes = r.cores;
+
+        if (r.memory > 0) {
+            const auto by_memory = r.memory / memory_per_process;
+            max_processes = std::clamp<std::size_t>(by_memory, 1, r.cores);
+        }
+
+        std::string s;
+
+        s += "# written by `mob bench-env`\n";
+        s += std::format("#   {} cores, {} MB of memory\n", r.cores,
+                         r.memory / 1024 / 1024);
+
+        s += std::format("#   spawn: {:.1f}ms direct, {:.1f}ms through cmd.exe\n",
+                         r.spawn_direct_ms, r.spawn_process_ms);
+
+        if (r.prefix_files) {
+            s += std::format("#   files in prefix: create {:.0f}/s, copy {:.0f}/s, "
+                             "delete {:.0f}/s\n",
+                             r.prefix_files->create, r.prefix_files->copy,
+                             r.prefix_files->remove);
+        }
+
+        if (r.cache_files) {
+            s += std::format("#   files in cache: create {:.0f}/s, copy {:.0f}/s, "
+                             "delete {:.0f}/s\n",
+                             r.cache_files->create, r.cache_files->copy,
+                             r.cache_files->remove);
+        }
+
+        if (!r.download_url.empty()) {
+            s += std::format("#   download: {:.1f} MB/s from {}\n", r.download_mbs,
+                             r.download_url);
+        }
+
+        for (auto&& c : r.compile)
+            s += std::format("#   compile: {} jobs, {:.1f}s\n", c.jobs, c.seconds);
+
+        s += "\n[global]\n";
+        s += std::format("build_jobs    = {}\n", build_jobs);
+        s += std::format("max_processes = {}\n", max_processes);
+        // tasks spend most of their time waiting on tools, which are already
+        // limited by max_processes and the throttle
+        s += "max_tasks     = 0\n";
+
+        // a cache on another drive that's much slower than the prefix,
+        // downloads are extracted into the prefix, so keep them close
+        if (r.prefix_files && r.cache_files &&
+            r.cache_files->copy * 2 < r.prefix_files->copy) {
+            s += "\n[paths]\n";
+            s += std::format("cache = {}\n",
+                             path_to_utf8(conf().path().prefix() / "downloads"));
+        }
+
+        op::write_text_file(gcx(), encodings::utf8, out, s);
+
+        u8cout << "\nwrote " << path_to_utf8(out) << ":\n\n" << s;
+    }
+
+}  // namespace mob
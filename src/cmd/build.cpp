@@ -1,9 +1,14 @@
 #include "pch.h"
+#include "../core/checkpoint.h"
 #include "../core/conf.h"
 #include "../core/context.h"
+#include "../core/gc.h"
+#include "../core/history.h"
 #include "../core/ini.h"
 #include "../core/op.h"
+#include "../tasks/plan.h"
 #include "../tasks/task_manager.h"
+#include "../tasks/tasks.h"
 #include "commands.h"
 
 namespace mob {
@@ -84,9 +89,26 @@ namespace mob {
                    "when --reextract is given, directories controlled by git will "
                    "be deleted even if they contain uncommitted changes",
 
+               (clipp::option("--configs") & clipp::value("CONFIGS") >> configs_) %
+                   "comma-separated list of configurations to build and install "
+                   "concurrently, such as Debug,RelWithDebInfo; sources are "
+                   "fetched once",
+
+               (clipp::option("--compare-profiles") &
+                clipp::value("PROFILES") >> compare_profiles_) %
+                   "comma-separated list of build profiles; ModOrganizer projects "
+                   "are built from scratch with each one and the times are "
+                   "compared without installing them, other tasks are built and "
+                   "installed as usual; tasks run one at a time",
+
                (clipp::option("--keep-msbuild") >> keep_msbuild_) %
                    "don't terminate msbuild.exe instances after building",
 
+               (clipp::option("--plan") >> plan_) %
+                   "doesn't build anything, outputs a json plan of the phases "
+                   "that would run, the processes that would be spawned and "
+                   "estimated durations from previous builds",
+
                (clipp::opt_values(clipp::match::prefix_not("-"), "task", tasks_)) %
                    "tasks to run; specify 'super' to only build modorganizer "
                    "projects";
@@ -146,16 +168,62 @@ namespace mob {
                 common.options.push_back("_override:task/revert_ts=false");
         }
 
+        if (!configs_.empty())
+            common.options.push_back("_override:task/configurations=" + configs_);
+
+        if (!compare_profiles_.empty()) {
+            common.options.push_back("_override:task/compare_profiles=" +
+                                     compare_profiles_);
+
+            // other projects compiling at the same time would skew the times
+            common.options.push_back("global/max_tasks=1");
+        }
+
+        if (plan_) {
+            // the plan is a dry run; the json goes to stdout, so keep the logs out
+            // of it unless a log level was given explicitly
+            common.options.push_back("global/dry=true");
+
+            if (common.output_log_level < 0)
+                common.options.push_back("global/output_log_level=0");
+        }
+
         if (!tasks_.empty())
             set_task_enabled_flags(tasks_);
     }
 
     int build_command::do_run()
     {
+        if (plan_)
+            return do_plan();
+
         try {
             create_prefix_ini();
+            resolve_remote_heads();
+
+            // the resolved paths of vs, qt, etc. are part of the inputs, a
+            // resumed build after upgrading them must start over
+            if (conf().global().get<bool>("resume")) {
+                resolve_lazy_options();
+                checkpoints::instance().begin(checkpoint_inputs());
+            }
+
+            if (!task_manager::instance().run_all()) {
+                // the checkpoints are kept so the next build resumes, and gc
+                // must not look at half-fetched or half-built directories
+                phase_history::instance().save();
+                access_log::instance().save();
 
-            task_manager::instance().run_all();
+                gcx().error(context::interruption, "interrupted");
+                return 1;
+            }
+
+            checkpoints::instance().finish();
+            phase_history::instance().save();
+            access_log::instance().save();
+
+            if (conf().gc().get<bool>("auto"))
+                garbage_collector().run();
 
             if (!keep_msbuild_)
                 terminate_msbuild();
@@ -164,11 +232,68 @@ namespace mob {
             return 0;
         }
         catch (bailed&) {
+            // phases that completed before bailing out are still worth keeping
+            phase_history::instance().save();
+            access_log::instance().save();
+
             gcx().error(context::generic, "bailing out");
             return 1;
         }
     }
 
+    std::string build_command::checkpoint_inputs()
+    {
+        // options that only change what's logged, measured or how interruptions
+        // are handled can change between an interrupted build and the next one
+        static const std::set<std::string, std::less<>> ignored = {
+            "output_log_level", "file_log_level", "log_file",
+            "metrics_file",     "metrics_textfile", "metrics_interval",
+            "cancel_timeout"};
+
+        fingerprint fp;
+        fp.add(mob_version());
+
+        // "what  key = value", see format_options()
+        for (auto&& line : format_options()) {
+            const auto parts = split(line, " ");
+
+            if (parts.size() >= 2 && ignored.contains(parts[1]))
+                continue;
+
+            fp.add(line);
+        }
+
+        return fp.hex();
+    }
+
+    int build_command::do_plan()
+    {
+        auto& plan = build_plan::instance();
+        auto& tm   = task_manager::instance();
+
+        plan.enable();
+
+        // dry runs can fail when a task needs files that haven't been fetched
+        // yet; whatever was recorded until then is still output
+        std::optional<std::string> error;
+
+        try {
+            tm.run_all();
+        }
+        catch (bailed& e) {
+            error = e.what();
+        }
+
+        auto json = plan.to_json(tm.top_level());
+
+        if (error)
+            json["error"] = *error;
+
+        u8cout << json.dump(2) << "\n";
+
+        return (error ? 1 : 0);
+    }
+
     void build_command::create_prefix_ini()
     {
         const auto prefix = conf().path().prefix();
@@ -184,6 +309,41 @@ namespace mob {
         }
     }
 
+    void build_command::resolve_remote_heads()
+    {
+        if (!conf().global().fetch())
+            return;
+
+        std::vector<std::pair<url, std::string>> v;
+
+        // repos that will be pulled need the head, new clones only need it
+        // when the fallback branch might be used
+        const auto add = [&](const task& t, const fs::path& source, const url& u) {
+            const auto tc     = conf().task(t.names());
+            const bool pulled = exists(source / ".git") && !tc.no_pull();
+
+            if (pulled || !tc.mo_fallback_branch().empty())
+                v.emplace_back(u, tc.mo_branch());
+        };
+
+        for (auto* t : task_manager::instance().all()) {
+            if (!t->enabled())
+                continue;
+
+            if (const auto* mo = dynamic_cast<const tasks::modorganizer*>(t)) {
+                add(*mo, mo->source_path(), mo->git_url());
+                continue;
+            }
+
+            // the installer checks its branch before cloning, the clone would
+            // otherwise wait on it
+            if (const auto* i = dynamic_cast<const tasks::installer*>(t))
+                add(*i, tasks::installer::source_path(), i->git_url());
+        }
+
+        git_wrap::resolve_remote_heads(v);
+    }
+
     void build_command::terminate_msbuild()
     {
         if (conf().global().dry())
@@ -2,6 +2,7 @@
 #include "commands.h"
 #include "../core/conf.h"
 #include "../core/ini.h"
+#include "../core/metrics.h"
 #include "../net.h"
 #include "../tasks/task_manager.h"
 #include "../tools/tools.h"
@@ -56,6 +57,9 @@ namespace mob {
 
                (clipp::option("--dry") >> o.dry) % "simulates filesystem operations",
 
+               (clipp::option("--offline") >> o.offline) %
+                   "never touches the network, only uses what was already fetched",
+
                (clipp::option("-l", "--log-level") &
                 clipp::value("LEVEL") >> o.output_log_level) %
                    "0 is silent, 6 is max",
@@ -123,6 +127,9 @@ namespace mob {
         if (o.dry)
             o.options.push_back("global/dry=true");
 
+        if (o.offline)
+            o.options.push_back("global/offline=true");
+
         if (!o.prefix.empty())
             o.options.push_back("paths/prefix=" + o.prefix);
     }
@@ -177,12 +184,34 @@ namespace mob {
             const auto r = load_options();
             if (r != 0)
                 return r;
+
+            run_metrics::instance().start();
+
+            // time since mob started, paths and tools that are resolved later
+            // are logged separately
+            const auto startup = timestamp();
+
+            gcx().debug(context::generic, "startup took {}ms",
+                        std::chrono::duration_cast<std::chrono::milliseconds>(startup)
+                            .count());
+
+            run_metrics::instance().set("mob_startup_seconds", {},
+                                        std::chrono::duration<double>(startup).count());
         }
 
         if (flags_ & handle_sigint)
             set_sigint_handler();
 
-        const auto r = do_run();
+        // the metrics are also useful when the command bails out; commands
+        // that don't load options have nothing to measure
+        int r = 1;
+
+        guard g([&] {
+            if (flags_ & requires_options)
+                run_metrics::instance().save(r);
+        });
+
+        r = do_run();
 
         if (code_)
             return *code_;
@@ -290,6 +319,9 @@ namespace mob {
 
     int options_command::do_run()
     {
+        // show the final values
+        resolve_lazy_options();
+
         for (auto&& line : format_options())
             u8cout << line << "\n";
 
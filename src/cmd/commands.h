@@ -19,6 +19,7 @@ namespace mob {
         //
         struct common_options {
             bool dry             = false;
+            bool offline         = false;
             int output_log_level = -1;
             int file_log_level   = -1;
             std::string log_file;
@@ -204,12 +205,33 @@ namespace mob {
         std::optional<bool> nopull_;
         bool ignore_uncommitted_ = false;
         bool keep_msbuild_       = false;
+        bool plan_               = false;
         std::optional<bool> revert_ts_;
+        std::string configs_;
+        std::string compare_profiles_;
 
         // creates a bare bones ini file in the prefix so mob can be invoked in any
         // directory below it
         //
         void create_prefix_ini();
+
+        // runs `git ls-remote` concurrently for all the enabled modorganizer
+        // repos and the installer before the tasks start, so pulls that would
+        // be no-ops and mo_fallback probes don't each wait for their own round
+        // trip
+        //
+        void resolve_remote_heads();
+
+        // runs all the tasks in dry mode to record what they would do, outputs
+        // the build plan as json, see build_plan
+        //
+        int do_plan();
+
+        // fingerprint of the options that affect what the build does, a build
+        // only resumes from the checkpoints of an interrupted build if they're
+        // the same, see checkpoints
+        //
+        static std::string checkpoint_inputs();
     };
 
     // applies a pr
@@ -233,6 +255,8 @@ namespace mob {
         std::string op_;
         std::string pr_;
         std::string github_token_;
+        std::string install_;
+        bool worktree_ = false;
 
         std::pair<const tasks::modorganizer*, std::string>
         parse_pr(const std::string& pr) const;
@@ -250,6 +274,33 @@ namespace mob {
         int pull();
         int find();
         int revert();
+        int build();
+
+        // directory that contains the worktrees for this pr, something like
+        // build/pr/modorganizer-123; build/pr is never collected by gc
+        //
+        fs::path worktrees_root() const;
+
+        // directory of the worktree for the given task in worktrees_root()
+        //
+        fs::path worktree_path(const tasks::modorganizer& task) const;
+
+        // used by pull() with --worktree, creates the worktree for the given pr
+        // or updates it if it already exists
+        //
+        void pull_worktree(const tasks::modorganizer& task, const pr_info& pr);
+
+        // used by build() and pull() with --worktree, builds the tasks for the
+        // given prs and all the tasks that might depend on them; with
+        // --worktree, the tasks for the prs are built from their worktrees
+        //
+        int build_prs(const std::vector<pr_info>& prs);
+
+        // returns the enabled modorganizer tasks that might depend on any of the
+        // given tasks
+        //
+        std::vector<const tasks::modorganizer*> find_dependents(
+            const std::vector<const tasks::modorganizer*>& changed) const;
     };
 
     // lists available tasks
@@ -280,8 +331,11 @@ namespace mob {
 
         void make_bin();
         void make_pdbs();
+        void make_symbols();
         void make_src();
         void make_installer();
+        void make_manifest();
+        void make_bin_delta();
 
     protected:
         clipp::group do_group() override;
@@ -292,10 +346,36 @@ namespace mob {
     private:
         enum class modes { none = 0, devbuild, official };
 
+        // a file in a manifest
+        struct manifest_file {
+            std::uintmax_t size = 0;
+            std::string hash;
+        };
+
+        // relative path with forward slashes to file
+        using manifest = std::map<std::string, manifest_file>;
+
+        // a binary or pdb for the symbol store
+        struct symbol_file {
+            fs::path file;
+
+            // name of the directory in the symbol store
+            std::string key;
+
+            bool is_pdb = false;
+
+            // for binaries, filename and key of the pdb from the codeview
+            // record, if any
+            fs::path pdb_name;
+            std::string pdb_key;
+        };
+
         modes mode_     = modes::none;
         bool bin_       = true;
         bool src_       = true;
         bool pdbs_      = true;
+        bool symbols_   = false;
+        bool compress_  = false;
         bool installer_ = false;
         std::string utf8out_;
         fs::path out_;
@@ -307,6 +387,9 @@ namespace mob {
         bool force_ = false;
         std::string suffix_;
         std::string branch_;
+        std::string utf8_delta_from_;
+        std::string utf8_delta_base_;
+        std::optional<manifest> bin_manifest_;
 
         int do_devbuild();
         int do_official();
@@ -315,7 +398,8 @@ namespace mob {
         void check_repos_for_branch();
         bool check_clean_prefix();
 
-        fs::path make_filename(const std::string& what) const;
+        fs::path make_filename(const std::string& what,
+                               const std::string& ext = ".7z") const;
 
         void walk_dir(const fs::path& dir, std::vector<fs::path>& files,
                       const std::vector<std::regex>& ignore_re,
@@ -323,6 +407,46 @@ namespace mob {
 
         std::string version_from_exe() const;
         std::string version_from_rc() const;
+
+        // adds all the binaries and pdbs in `dir` to `files`, recursive
+        //
+        void find_symbol_files(const fs::path& dir, std::vector<fs::path>& files);
+
+        // reads the key of the given binary or pdb, returns empty if the file
+        // isn't a valid binary or pdb
+        //
+        std::optional<symbol_file> read_symbol_file(const fs::path& file) const;
+
+        // warns about binaries that reference a pdb by name when none of the
+        // pdbs with that name has the key from the binary's codeview record
+        //
+        void check_symbol_files(const std::vector<symbol_file>& files) const;
+
+        // copies the given binary or pdb into its entry `dir` of the symbol
+        // store, compresses it if --compress-symbols was given
+        //
+        void add_to_symbol_store(const fs::path& file, const fs::path& dir);
+
+        // sizes and hashes of all the files in install/bin, computed once
+        //
+        const manifest& bin_manifest();
+
+        // sha-256 of the given file as hex, bails out if it can't be read
+        //
+        std::string hash_file(const fs::path& p) const;
+
+        // reads a manifest written by make_manifest(), bails out on failure;
+        // sets `version` to the release it was made for
+        //
+        manifest read_manifest(const fs::path& p, std::string& version) const;
+
+        // puts `name` from install/bin in the delta directory `dir`, either as a
+        // binary delta against the same file in `base` or as a copy; returns the
+        // entry for the delta manifest
+        //
+        nlohmann::json add_to_delta(const std::string& name, const fs::path& dir,
+                                    const fs::path& base,
+                                    const manifest_file* old_file);
     };
 
     // manages git repos
@@ -404,6 +528,88 @@ namespace mob {
         void do_build();
     };
 
+    // measures the machine and writes recommended settings to an ini
+    //
+    class bench_env_command : public command {
+    public:
+        bench_env_command();
+        meta_t meta() const override;
+
+    protected:
+        clipp::group do_group() override;
+        int do_run() override;
+        std::string do_doc() override;
+
+    private:
+        // operations per second for small files
+        struct file_results {
+            double create = 0;
+            double copy   = 0;
+            double remove = 0;
+        };
+
+        // time taken to build the synthetic project with some number of jobs
+        struct compile_result {
+            std::size_t jobs = 0;
+            double seconds   = 0;
+        };
+
+        // everything that was measured
+        struct results {
+            std::size_t cores    = 1;
+            std::uint64_t memory = 0;
+
+            double spawn_direct_ms  = 0;
+            double spawn_process_ms = 0;
+
+            std::optional<file_results> prefix_files;
+            std::optional<file_results> cache_files;
+
+            std::string download_url;
+            double download_mbs = 0;
+
+            std::vector<compile_result> compile;
+        };
+
+        std::string output_;
+        std::string url_;
+        bool force_    = false;
+        bool download_ = true;
+        bool compile_  = true;
+
+        // total physical memory, 0 on error
+        //
+        static std::uint64_t total_memory();
+
+        void bench_spawn(results& r);
+        void bench_files(results& r);
+        file_results bench_files_in(const fs::path& root);
+        void bench_download(results& r);
+        void bench_compile(results& r);
+
+        // writes a CMakeLists.txt with the given number of static libraries, so
+        // msbuild can build them in parallel
+        //
+        void write_compile_project(const fs::path& dir, std::size_t projects);
+
+        // picks the recommended values and writes them to the ini
+        //
+        void write_ini(const results& r, const fs::path& out);
+    };
+
+    // deletes old and unused downloads, builds, releases and temporary files
+    //
+    class gc_command : public command {
+    public:
+        gc_command();
+        meta_t meta() const override;
+
+    protected:
+        clipp::group do_group() override;
+        int do_run() override;
+        std::string do_doc() override;
+    };
+
     // print CMake configuration variables
     //
     class cmake_config_command : public command {
@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "../core/context.h"
+#include "../core/gc.h"
+#include "commands.h"
+
+namespace mob {
+
+    gc_command::gc_command() : command(requires_options) {}
+
+    command::meta_t gc_command::meta() const
+    {
+        return {"gc", "deletes old and unused cached files"};
+    }
+
+    clipp::group gc_command::do_group()
+    {
+        return clipp::group(clipp::command("gc").set(picked_),
+
+                            (clipp::option("-h", "--help") >> help_) %
+                                ("shows this message"));
+    }
+
+    int gc_command::do_run()
+    {
+        try {
+            // logs what was freed
+            garbage_collector().run();
+            return 0;
+        }
+        catch (bailed&) {
+            gcx().error(context::generic, "bailing out");
+            return 1;
+        }
+    }
+
+    std::string gc_command::do_doc()
+    {
+        return "Deletes downloads, build trees, releases and temporary files that\n"
+               "are older or larger than the budgets in the [gc] section of the\n"
+               "INI. The least recently used ones are deleted first. Anything\n"
+               "used by a task, and git working trees with uncommitted or\n"
+               "stashed changes, are never deleted.\n"
+               "\n"
+               "This also runs after every successful build if [gc] auto is\n"
+               "true. Use --dry to see what would be deleted.";
+    }
+
+}  // namespace mob
@@ -7,12 +7,6 @@
 
 namespace mob {
 
-    std::string read_file(const fs::path& p)
-    {
-        std::ifstream t(p);
-        return {std::istreambuf_iterator<char>(t), std::istreambuf_iterator<char>()};
-    }
-
     pr_command::pr_command() : command(requires_options | handle_sigint) {}
 
     command::meta_t pr_command::meta() const
@@ -28,6 +22,22 @@ namespace mob {
                "  - pull:   fetches the pr's branch and checks it out; all repos\n"
                "            will be in detached HEAD state\n"
                "  - revert: checks out branch `master` for every affected repo\n"
+               "  - build:  builds every affected repo and all the repos that\n"
+               "            might depend on them, nothing is fetched; use after\n"
+               "            `pull`; the regular build directories are used and\n"
+               "            the regular install directory is overwritten\n"
+               "\n"
+               "With --install, `build` installs in the given directory instead\n"
+               "of the regular install directory, which is still used to find\n"
+               "the dependencies that are not rebuilt; the build directories\n"
+               "are then in build/pr/ because a different install directory\n"
+               "would reconfigure the regular ones.\n"
+               "\n"
+               "With --worktree, `pull` creates a git worktree for every affected\n"
+               "repo in build/pr/ instead of checking out the pr in place, then\n"
+               "builds them from there like `build` would; the regular build\n"
+               "directories of the affected repos are left alone so they don't\n"
+               "have to be rebuilt after `revert`, which removes the worktrees.\n"
                "\n"
                "Repos that are not handled:\n"
                "  - mob itself\n"
@@ -46,8 +56,14 @@ namespace mob {
                 clipp::value("TOKEN") >> github_token_) %
                    "github api key",
 
+               (clipp::option("--worktree") >> worktree_) %
+                   "uses a separate worktree for every repo, see below",
+
+               (clipp::option("--install") & clipp::value("DIR") >> install_) %
+                   "for `build`, installs in this directory, see below",
+
                (clipp::value("OP") >> op_) %
-                   "one of `find`, `pull` or `revert`; see below",
+                   "one of `find`, `pull`, `revert` or `build`; see below",
 
                (clipp::value("PR") >> pr_) %
                    "PR to apply, must be `task/pr`, such as `modorganizer/123`";
@@ -55,6 +71,13 @@ namespace mob {
 
     int pr_command::do_run()
     {
+        // all operations start by looking up the pr on github
+        if (conf().global().offline()) {
+            u8cerr << "pr needs the github api, which is not available with "
+                      "--offline\n";
+            return 1;
+        }
+
         if (github_token_.empty())
             github_token_ = conf().global().get("github_key");
 
@@ -64,6 +87,8 @@ namespace mob {
             return find();
         else if (op_ == "revert")
             return revert();
+        else if (op_ == "build")
+            return build();
         else
             u8cerr << "bad operation '" << op_ << "'\n";
 
@@ -116,6 +141,11 @@ namespace mob {
                 if (!task)
                     return 1;
 
+                if (worktree_) {
+                    pull_worktree(*task, pr);
+                    continue;
+                }
+
                 u8cout << "checking out pr " << pr.number << " "
                        << "in " << task->name() << "\n";
 
@@ -127,6 +157,9 @@ namespace mob {
                 g.checkout("FETCH_HEAD");
             }
 
+            if (worktree_)
+                return build_prs(okay_prs);
+
             u8cout << "note: all these repos are now in detached HEAD state\n";
 
             return 0;
@@ -153,6 +186,10 @@ namespace mob {
             return 1;
 
         try {
+            // worktrees left by `pull --worktree` are in the pr directory too,
+            // it can only be deleted once they're removed
+            bool has_worktrees = false;
+
             for (auto&& pr : okay_prs) {
                 const auto* task = dynamic_cast<const tasks::modorganizer*>(
                     task_manager::instance().find_one(pr.repo));
@@ -160,11 +197,33 @@ namespace mob {
                 if (!task)
                     return 1;
 
+                if (!worktree_ && exists(worktree_path(*task) / ".git"))
+                    has_worktrees = true;
+
+                if (worktree_) {
+                    const auto wt = worktree_path(*task);
+
+                    if (!exists(wt)) {
+                        u8cout << "no worktree for " << task->name() << "\n";
+                        continue;
+                    }
+
+                    u8cout << "removing worktree " << path_to_utf8(wt) << "\n";
+                    git_wrap(task->source_path()).remove_worktree(wt);
+
+                    continue;
+                }
+
                 u8cout << "reverting " << task->name() << " to master\n";
 
                 git_wrap(task->source_path()).checkout("master");
             }
 
+            // the worktrees are gone, remove what's left of the pr directory,
+            // which also has the build directories used by `build`
+            if (!has_worktrees)
+                op::delete_directory(gcx(), worktrees_root(), op::optional);
+
             return 0;
         }
         catch (std::exception& e) {
@@ -173,6 +232,189 @@ namespace mob {
         }
     }
 
+    int pr_command::build()
+    {
+        const auto prs = get_matching_prs(pr_);
+        if (prs.empty())
+            return 1;
+
+        const auto okay_prs = validate_prs(prs);
+        if (okay_prs.empty())
+            return 1;
+
+        return build_prs(okay_prs);
+    }
+
+    fs::path pr_command::worktrees_root() const
+    {
+        return conf().path().build() / "pr" / replace_all(pr_, "/", "-");
+    }
+
+    fs::path pr_command::worktree_path(const tasks::modorganizer& task) const
+    {
+        return worktrees_root() / task.name();
+    }
+
+    void pr_command::pull_worktree(const tasks::modorganizer& task, const pr_info& pr)
+    {
+        const auto wt  = worktree_path(task);
+        const auto ref = std::format("pull/{}/head", pr.number);
+
+        if (exists(wt)) {
+            // created by a previous pull, FETCH_HEAD is per worktree so fetch
+            // from there
+            u8cout << "updating worktree " << path_to_utf8(wt) << "\n";
+
+            git_wrap g(wt);
+            g.fetch(task.git_url().string(), ref);
+            g.checkout("FETCH_HEAD");
+        }
+        else {
+            // fetching in the clone puts the objects in the repo shared by all the
+            // worktrees
+            u8cout << "creating worktree " << path_to_utf8(wt) << "\n";
+
+            git_wrap g(task.source_path());
+            g.fetch(task.git_url().string(), ref);
+            g.add_worktree(wt, "FETCH_HEAD");
+        }
+    }
+
+    int pr_command::build_prs(const std::vector<pr_info>& prs)
+    {
+        auto& tm = task_manager::instance();
+
+        std::vector<const tasks::modorganizer*> changed;
+
+        for (auto&& pr : prs) {
+            const auto* task =
+                dynamic_cast<const tasks::modorganizer*>(tm.find_one(pr.repo));
+
+            if (!task)
+                return 1;
+
+            if (worktree_ && !exists(worktree_path(*task))) {
+                u8cerr << "no worktree for " << task->name() << ", use "
+                       << "`pr pull --worktree` first\n";
+
+                return 1;
+            }
+
+            changed.push_back(task);
+        }
+
+        // must be done before changing the enabled flags below
+        const auto dependents = find_dependents(changed);
+
+        // only the tasks that are rebuilt are enabled; options for specific tasks
+        // are always set on the main name, see process_option() in conf.cpp
+        for (auto* t : tm.all())
+            conf().task({t->name()}).set("enabled", "false");
+
+        const auto enable = [&](const tasks::modorganizer* t) {
+            auto tc = conf().task({t->name()});
+            tc.set("enabled", "true");
+
+            if (install_.empty())
+                return;
+
+            tc.set("mo_install", path_to_utf8(fs::absolute(install_)));
+
+            // dependents are built from their regular clones, but a different
+            // install directory changes their configuration and would force a
+            // full rebuild of their regular build directory, twice
+            tc.set("mo_build", path_to_utf8(worktrees_root() / t->name() / "vsbuild"));
+        };
+
+        for (auto* t : changed) {
+            enable(t);
+
+            if (worktree_) {
+                conf().task({t->name()}).set("mo_worktree",
+                                             path_to_utf8(worktree_path(*t)));
+            }
+        }
+
+        for (auto* t : dependents)
+            enable(t);
+
+        const auto names = [](auto&& v) {
+            return join(map(v,
+                            [](auto* t) {
+                                return t->name();
+                            }),
+                        ", ");
+        };
+
+        u8cout << "building " << names(changed) << "\n";
+
+        if (!dependents.empty())
+            u8cout << "and dependents " << names(dependents) << "\n";
+
+        if (install_.empty()) {
+            u8cout << "installing in " << path_to_utf8(conf().path().install())
+                   << ", the binaries there will be replaced by the ones from "
+                   << "the pr until the next `mob build`; use --install to keep "
+                   << "them\n";
+        }
+
+        // the prs are already checked out and pulling the other repos would
+        // change what the prs are built against
+        conf().global().set("fetch_task", "false");
+
+        try {
+            if (!tm.run_all()) {
+                gcx().error(context::interruption, "interrupted");
+                return 1;
+            }
+
+            return 0;
+        }
+        catch (bailed&) {
+            gcx().error(context::generic, "bailing out");
+            return 1;
+        }
+    }
+
+    std::vector<const tasks::modorganizer*> pr_command::find_dependents(
+        const std::vector<const tasks::modorganizer*>& changed) const
+    {
+        // mob has no dependencies between tasks, only an order: top level tasks
+        // run one after the other and a task can only depend on tasks that ran
+        // before it, so any task in a top level task that comes after one of the
+        // changed tasks might depend on it; tasks that run in parallel with a
+        // changed task can't depend on it
+
+        std::vector<const tasks::modorganizer*> v;
+        bool after_changed = false;
+
+        for (auto* top : task_manager::instance().top_level()) {
+            std::vector<task*> group;
+
+            if (auto* pt = dynamic_cast<parallel_tasks*>(top))
+                group = pt->children();
+            else
+                group = {top};
+
+            bool has_changed = false;
+
+            for (auto* t : group) {
+                const auto* mo = dynamic_cast<const tasks::modorganizer*>(t);
+                if (!mo)
+                    continue;
+
+                if (std::find(changed.begin(), changed.end(), mo) != changed.end())
+                    has_changed = true;
+                else if (after_changed && mo->enabled())
+                    v.push_back(mo);
+            }
+
+            after_changed = (after_changed || has_changed);
+        }
+
+        return v;
+    }
+
     std::vector<pr_command::pr_info>
     pr_command::get_matching_prs(const std::string& repo_pr)
     {
@@ -1,8 +1,11 @@
 #include "pch.h"
 #include "../core/conf.h"
 #include "../core/context.h"
+#include "../core/gc.h"
 #include "../core/ini.h"
 #include "../core/op.h"
+#include "../core/process.h"
+#include "../core/staging.h"
 #include "../tasks/task_manager.h"
 #include "../tasks/tasks.h"
 #include "../utility.h"
@@ -20,13 +23,327 @@ namespace mob {
         return {"release", "creates a release"};
     }
 
+    // modified files at least this large are shipped as binary deltas in the
+    // delta archive if the previous release is available, smaller ones are
+    // always copied
+    //
+    constexpr std::uintmax_t delta_min_size = 256 * 1024;
+
+    // files in the install directory that are never released: python caches and
+    // files left behind by a merge of staged installs
+    //
+    std::vector<std::string> release_ignore()
+    {
+        auto v = install_staging::merge_file_globs();
+        v.push_back("__pycache__");
+        return v;
+    }
+
     void release_command::make_bin()
     {
         const auto out = out_ / make_filename("");
         u8cout << "making binary archive " << path_to_utf8(out) << "\n";
 
         op::archive_from_glob(gcx(), conf().path().install_bin() / "*", out,
-                              {"__pycache__"});
+                              release_ignore());
+
+        make_manifest();
+    }
+
+    void release_command::make_manifest()
+    {
+        const auto out = out_ / make_filename("manifest", ".json");
+        u8cout << "making manifest " << path_to_utf8(out) << "\n";
+
+        nlohmann::json files = nlohmann::json::object();
+
+        for (auto&& [name, f] : bin_manifest())
+            files[name] = {{"size", f.size}, {"hash", f.hash}};
+
+        const nlohmann::json json = {
+            {"version", version_}, {"hash_algorithm", "sha256"}, {"files", files}};
+
+        op::write_text_file(gcx(), encodings::utf8, out, json.dump(2));
+    }
+
+    void release_command::make_bin_delta()
+    {
+        const fs::path from = utf8_to_utf16(utf8_delta_from_);
+        const fs::path base = utf8_to_utf16(utf8_delta_base_);
+
+        std::string old_version;
+        const auto old      = read_manifest(from, old_version);
+        const auto& current = bin_manifest();
+
+        const auto out = out_ / make_filename("delta-" + old_version);
+        u8cout << "making delta archive " << path_to_utf8(out) << "\n";
+
+        // new and modified files, with their entry in the old manifest
+        std::vector<std::pair<std::string, const manifest_file*>> changed;
+
+        for (auto&& [name, f] : current) {
+            auto itor = old.find(name);
+
+            if (itor == old.end())
+                changed.push_back({name, nullptr});
+            else if (itor->second.size != f.size || itor->second.hash != f.hash)
+                changed.push_back({name, &itor->second});
+        }
+
+        std::vector<std::string> deleted;
+
+        for (auto&& [name, f] : old) {
+            if (!current.contains(name))
+                deleted.push_back(name);
+        }
+
+        const auto dir = out_ / "delta";
+        op::delete_directory(gcx(), dir, op::optional);
+
+        // the threads below only write files
+        std::set<fs::path> dirs = {dir};
+        for (auto&& c : changed) {
+            const fs::path rel = utf8_to_utf16(c.first);
+            dirs.insert((dir / "files" / rel).parent_path());
+        }
+
+        for (auto&& d : dirs)
+            op::create_directories(gcx(), d);
+
+        // diffing large binaries takes a while, they're done in parallel
+        std::vector<nlohmann::json> entries(changed.size());
+        std::atomic<bool> failed = false;
+
+        {
+            thread_pool tp;
+
+            for (std::size_t i = 0; i < changed.size(); ++i) {
+                tp.add([&, i] {
+                    try {
+                        entries[i] = add_to_delta(changed[i].first, dir, base,
+                                                  changed[i].second);
+                    }
+                    catch (bailed&) {
+                        // already logged
+                        failed = true;
+                    }
+                });
+            }
+        }
+
+        if (failed)
+            gcx().bail_out(context::generic, "failed to create the delta archive");
+
+        const nlohmann::json json = {{"from", old_version},
+                                     {"to", version_},
+                                     {"files", entries},
+                                     {"deleted", deleted}};
+
+        op::write_text_file(gcx(), encodings::utf8, dir / "delta.json", json.dump(2));
+
+        op::archive_from_glob(gcx(), dir / "*", out, {});
+        op::delete_directory(gcx(), dir);
+
+        const auto patched =
+            std::count_if(entries.begin(), entries.end(), [](auto&& e) {
+                return e.value("action", "") == "patch";
+            });
+
+        u8cout << "delta from " << old_version << ": " << changed.size()
+               << " files added or modified, " << patched << " of them patched, "
+               << deleted.size() << " deleted\n";
+    }
+
+    nlohmann::json release_command::add_to_delta(const std::string& name,
+                                                 const fs::path& dir,
+                                                 const fs::path& base,
+                                                 const manifest_file* old_file)
+    {
+        const auto& f  = bin_manifest().at(name);
+        const auto rel = fs::path(utf8_to_utf16(name));
+        const auto src = conf().path().install_bin() / rel;
+
+        nlohmann::json e = {{"path", name}, {"size", f.size}, {"hash", f.hash}};
+
+        if (!old_file) {
+            e["action"] = "add";
+            e["source"] = "files/" + name;
+
+            op::copy_file_to_file_if_better(gcx(), src, dir / "files" / rel);
+            return e;
+        }
+
+        e["action"]   = "replace";
+        e["old_hash"] = old_file->hash;
+        e["source"]   = "files/" + name;
+
+        const auto old_path = base / rel;
+
+        // the delta is made against the file from the base directory, which must
+        // be the one from the old manifest or the updater couldn't apply it
+        if (!base.empty() && f.size >= delta_min_size) {
+            if (fs::exists(old_path) && hash_file(old_path) == old_file->hash) {
+                mapped_file old_mf, new_mf;
+                DWORD err = 0;
+
+                if (!old_mf.open(old_path, err)) {
+                    gcx().bail_out(context::fs, "can't open {}, {}", old_path,
+                                   error_message(err));
+                }
+
+                if (!new_mf.open(src, err)) {
+                    gcx().bail_out(context::fs, "can't open {}, {}", src,
+                                   error_message(err));
+                }
+
+                const auto delta = make_delta(old_mf.bytes(), new_mf.bytes());
+
+                // makes sure the updater will get the same bytes back
+                const auto check = apply_delta(old_mf.bytes(), delta);
+
+                if (!check || *check != new_mf.bytes()) {
+                    gcx().bail_out(context::generic,
+                                   "delta for {} doesn't give back the same file",
+                                   name);
+                }
+
+                // not worth it when most of the file changed
+                if (delta.size() < new_mf.bytes().size() / 4 * 3) {
+                    e["action"] = "patch";
+                    e["source"] = "files/" + name + ".mobdelta";
+
+                    auto p = dir / "files" / rel;
+                    p += ".mobdelta";
+
+                    op::write_text_file(gcx(), encodings::dont_know, p, delta);
+                    return e;
+                }
+            }
+            else {
+                gcx().warning(context::generic,
+                              "{} is not the file from the previous release, "
+                              "copying the new one instead of patching it",
+                              old_path);
+            }
+        }
+
+        op::copy_file_to_file_if_better(gcx(), src, dir / "files" / rel);
+        return e;
+    }
+
+    std::string release_command::hash_file(const fs::path& p) const
+    {
+        mapped_file mf;
+        DWORD e = 0;
+
+        if (!mf.open(p, e))
+            gcx().bail_out(context::fs, "can't open {}, {}", p, error_message(e));
+
+        auto h = sha256(mf.bytes());
+        if (!h)
+            gcx().bail_out(context::generic, "failed to hash {}", p);
+
+        return std::move(*h);
+    }
+
+    const release_command::manifest& release_command::bin_manifest()
+    {
+        if (bin_manifest_)
+            return *bin_manifest_;
+
+        const auto bin = conf().path().install_bin();
+
+        if (!fs::exists(bin))
+            gcx().bail_out(context::generic, "{} not found", bin);
+
+        std::vector<fs::path> files;
+
+        for (auto itor = fs::recursive_directory_iterator(bin);
+             itor != fs::recursive_directory_iterator(); ++itor) {
+            const auto& e = *itor;
+
+            // same as the binary archive
+            if (e.is_directory()) {
+                if (e.path().filename() == "__pycache__")
+                    itor.disable_recursion_pending();
+
+                continue;
+            }
+
+            if (e.is_regular_file() && !install_staging::is_merge_file(e.path()))
+                files.push_back(e.path());
+        }
+
+        std::vector<manifest_file> hashed(files.size());
+        std::atomic<bool> failed = false;
+
+        {
+            thread_pool tp;
+
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                tp.add([&, i] {
+                    try {
+                        std::error_code ec;
+                        hashed[i].size = fs::file_size(files[i], ec);
+                        hashed[i].hash = hash_file(files[i]);
+                    }
+                    catch (bailed&) {
+                        // already logged
+                        failed = true;
+                    }
+                });
+            }
+        }
+
+        if (failed)
+            gcx().bail_out(context::generic, "failed to hash the files in {}", bin);
+
+        manifest m;
+
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            // forward slashes so manifests don't depend on the platform
+            auto name = path_to_utf8(fs::relative(files[i], bin));
+            std::replace(name.begin(), name.end(), '\\', '/');
+
+            m[name] = std::move(hashed[i]);
+        }
+
+        bin_manifest_ = std::move(m);
+        return *bin_manifest_;
+    }
+
+    release_command::manifest release_command::read_manifest(const fs::path& p,
+                                                             std::string& version) const
+    {
+        const std::string s = op::read_text_file(gcx(), encodings::utf8, p);
+
+        const auto json = nlohmann::json::parse(s, nullptr, false);
+
+        if (json.is_discarded() || !json.is_object() || !json.contains("files") ||
+            !json["files"].is_object()) {
+            gcx().bail_out(context::generic, "{} is not a valid manifest", p);
+        }
+
+        version = json.value("version", "");
+        if (version.empty())
+            gcx().bail_out(context::generic, "manifest {} has no version", p);
+
+        // the hashes are compared with the ones from bin_manifest()
+        if (json.value("hash_algorithm", "") != "sha256") {
+            gcx().bail_out(context::generic, "manifest {} doesn't use sha256 hashes",
+                           p);
+        }
+
+        manifest m;
+
+        for (auto&& [name, v] : json["files"].items()) {
+            if (!v.is_object())
+                gcx().bail_out(context::generic, "bad entry {} in {}", name, p);
+
+            m[name] = {v.value("size", std::uintmax_t(0)), v.value("hash", "")};
+        }
+
+        return m;
     }
 
     void release_command::make_pdbs()
@@ -35,7 +352,233 @@ namespace mob {
         u8cout << "making pdbs archive " << path_to_utf8(out) << "\n";
 
         op::archive_from_glob(gcx(), conf().path().install_pdbs() / "*", out,
-                              {"__pycache__"});
+                              release_ignore());
+    }
+
+    // case-insensitive ordering for paths in the symbol store, which is meant
+    // to be served from a case-insensitive filesystem
+    //
+    struct symbol_path_less {
+        bool operator()(const fs::path& a, const fs::path& b) const
+        {
+            return _wcsicmp(a.native().c_str(), b.native().c_str()) < 0;
+        }
+    };
+
+    void release_command::make_symbols()
+    {
+        const auto out = out_ / "symbols";
+        u8cout << "making symbol store " << path_to_utf8(out) << "\n";
+
+        std::vector<fs::path> files;
+        find_symbol_files(conf().path().install_bin(), files);
+        find_symbol_files(conf().path().install_pdbs(), files);
+
+        std::vector<std::optional<symbol_file>> read(files.size());
+        std::atomic<bool> failed = false;
+
+        // this is mostly reading headers and copying files, so it's worth
+        // spreading over all the cores when there are thousands of files
+        {
+            thread_pool tp;
+
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                tp.add([&, i] {
+                    try {
+                        read[i] = read_symbol_file(files[i]);
+                    }
+                    catch (bailed&) {
+                        // already logged
+                        failed = true;
+                    }
+                });
+            }
+        }
+
+        if (failed)
+            gcx().bail_out(context::generic, "failed to create the symbol store");
+
+        // the same file can be in more than one directory, like a dll that's
+        // shipped both in bin/ and in a plugin directory, they have the same
+        // name and key and would be written to the same entry concurrently;
+        // only the first one is kept
+        std::map<fs::path, fs::path, symbol_path_less> entries;
+        std::vector<symbol_file> valid;
+        std::size_t skipped = 0;
+
+        for (auto&& sf : read) {
+            if (!sf) {
+                ++skipped;
+                continue;
+            }
+
+            const auto dir = out / sf->file.filename() / sf->key;
+            const auto r   = entries.emplace(dir, sf->file);
+
+            if (!r.second) {
+                gcx().trace(context::bypass, "{} is the same as {}", sf->file,
+                            r.first->second);
+
+                ++skipped;
+                continue;
+            }
+
+            valid.push_back(std::move(*sf));
+        }
+
+        check_symbol_files(valid);
+
+        std::atomic<std::size_t> added = 0;
+
+        {
+            thread_pool tp;
+
+            for (auto&& e : entries) {
+                tp.add([&, e] {
+                    try {
+                        add_to_symbol_store(e.second, e.first);
+                        ++added;
+                    }
+                    catch (bailed&) {
+                        // already logged
+                        failed = true;
+                    }
+                });
+            }
+        }
+
+        if (failed)
+            gcx().bail_out(context::generic, "failed to create the symbol store");
+
+        u8cout << "added " << added.load() << " files to the symbol store, skipped "
+               << skipped << "\n";
+    }
+
+    void release_command::find_symbol_files(const fs::path& dir,
+                                            std::vector<fs::path>& files)
+    {
+        if (!fs::exists(dir))
+            return;
+
+        for (auto&& e : fs::recursive_directory_iterator(dir)) {
+            if (!e.is_regular_file())
+                continue;
+
+            const auto ext = path_to_utf8(e.path().extension());
+
+            for (auto&& wanted : {".exe", ".dll", ".pyd", ".pdb"}) {
+                if (_stricmp(ext.c_str(), wanted) == 0) {
+                    files.push_back(e.path());
+                    break;
+                }
+            }
+        }
+    }
+
+    std::optional<release_command::symbol_file>
+    release_command::read_symbol_file(const fs::path& file) const
+    {
+        mapped_file mf;
+        DWORD e = 0;
+
+        if (!mf.open(file, e)) {
+            gcx().bail_out(context::fs, "can't open {}, {}", file,
+                           error_message(e));
+        }
+
+        // the directory name depends on the type of file:
+        //   - pdbs use their guid and age, found in the msf streams;
+        //   - binaries use their timestamp and image size from the pe headers
+        symbol_file sf;
+        sf.file = file;
+
+        if (auto pdb = parse_pdb(mf.bytes())) {
+            sf.key    = pdb->key();
+            sf.is_pdb = true;
+        }
+        else if (auto pe = parse_pe(mf.bytes())) {
+            sf.key = pe->key();
+
+            if (pe->pdb) {
+                sf.pdb_name = fs::path(utf8_to_utf16(pe->pdb_path)).filename();
+                sf.pdb_key  = pe->pdb->key();
+            }
+        }
+        else {
+            gcx().warning(context::generic, "{} is not a valid binary or pdb",
+                          file);
+            return {};
+        }
+
+        return sf;
+    }
+
+    void release_command::check_symbol_files(
+        const std::vector<symbol_file>& files) const
+    {
+        // keys of all the pdbs, by filename
+        std::map<fs::path, std::set<std::string>, symbol_path_less> pdbs;
+
+        for (auto&& f : files) {
+            if (f.is_pdb)
+                pdbs[f.file.filename()].insert(f.key);
+        }
+
+        for (auto&& f : files) {
+            if (f.is_pdb || f.pdb_key.empty())
+                continue;
+
+            // binaries from third parties often reference pdbs that aren't
+            // shipped, there's nothing to check
+            auto itor = pdbs.find(f.pdb_name);
+            if (itor == pdbs.end())
+                continue;
+
+            if (!itor->second.contains(f.pdb_key)) {
+                gcx().warning(context::generic,
+                              "{} references {} with key {}, but no pdb with that "
+                              "name has this key, it's probably stale",
+                              f.file, f.pdb_name, f.pdb_key);
+            }
+        }
+    }
+
+    void release_command::add_to_symbol_store(const fs::path& file,
+                                              const fs::path& dir)
+    {
+        const auto filename = file.filename();
+
+        if (!compress_) {
+            op::copy_file_to_file_if_better(gcx(), file, dir / filename);
+            return;
+        }
+
+        // compressed files have the last character of their extension replaced
+        // by an underscore, like `ModOrganizer.pd_`, symbol servers look for
+        // those automatically
+        auto compressed   = filename.native();
+        compressed.back() = L'_';
+
+        const auto dest = dir / compressed;
+
+        // entries are keyed on the content of the file, so an existing one is
+        // the same file
+        if (fs::exists(dest)) {
+            gcx().trace(context::bypass, "{} already in symbol store", file);
+            return;
+        }
+
+        op::create_directories(gcx(), dir);
+
+        auto p = process()
+                     .binary(conf().tool().get("makecab"))
+                     .arg("/D", "CompressionType=LZX")
+                     .arg("/D", "CompressionMemory=21")
+                     .arg(file)
+                     .arg(dest);
+
+        p.run();
+        p.join();
     }
 
     void release_command::make_src()
@@ -130,7 +673,8 @@ namespace mob {
         }
     }
 
-    fs::path release_command::make_filename(const std::string& what) const
+    fs::path release_command::make_filename(const std::string& what,
+                                            const std::string& ext) const
     {
         std::string filename = "Mod.Organizer";
 
@@ -143,7 +687,7 @@ namespace mob {
         if (!what.empty())
             filename += "-" + what;
 
-        filename += ".7z";
+        filename += ext;
 
         return filename;
     }
@@ -165,6 +709,14 @@ namespace mob {
                       clipp::option("--no-pdbs").set(pdbs_, false)) %
                          "sets whether the PDBs archive is created [default: yes]",
 
+                     (clipp::option("--symbols").set(symbols_, true) |
+                      clipp::option("--no-symbols").set(symbols_, false)) %
+                         "sets whether a symbol store is created from the binaries "
+                         "and PDBs [default: no]",
+
+                     clipp::option("--compress-symbols").set(compress_) %
+                         "compresses the files in the symbol store with makecab",
+
                      (clipp::option("--src").set(src_, true) |
                       clipp::option("--no-src").set(src_, false)) %
                          "sets whether the source archive is created [default: yes]",
@@ -196,6 +748,17 @@ namespace mob {
                      (clipp::option("--suffix") & clipp::value("SUFFIX") >> suffix_) %
                          "optional suffix to add to the archive filenames",
 
+                     (clipp::option("--delta-from") &
+                      clipp::value("PATH") >> utf8_delta_from_) %
+                         "also creates a delta archive with the binaries that "
+                         "changed since the release of the given manifest",
+
+                     (clipp::option("--delta-base") &
+                      clipp::value("PATH") >> utf8_delta_base_) %
+                         "directory with the binaries of the release given to "
+                         "--delta-from, large modified files are patched instead "
+                         "of copied",
+
                      clipp::option("--force").set(force_) %
                          "ignores file size warnings and existing release directories")
 
@@ -251,9 +814,15 @@ namespace mob {
         if (bin_)
             make_bin();
 
+        if (!utf8_delta_from_.empty())
+            make_bin_delta();
+
         if (pdbs_)
             make_pdbs();
 
+        if (symbols_)
+            make_symbols();
+
         if (src_)
             make_src();
 
@@ -275,12 +844,17 @@ namespace mob {
         if (!check_clean_prefix())
             return 1;
 
-        task_manager::instance().run_all();
+        if (!task_manager::instance().run_all()) {
+            gcx().error(context::interruption, "interrupted");
+            return 1;
+        }
+
         build_command::terminate_msbuild();
 
         prepare();
         make_bin();
         make_pdbs();
+        make_symbols();
         make_src();
         make_installer();
 
@@ -392,6 +966,10 @@ namespace mob {
             out_ = prefix / "releases" / version_;
         else if (out_.is_relative())
             out_ = prefix / out_;
+
+        // so the garbage collector evicts older releases first
+        access_log::instance().touch(out_);
+        access_log::instance().save();
     }
 
     std::string release_command::do_doc()
@@ -410,13 +988,24 @@ namespace mob {
                "      or from --version;\n"
                "    - `suffix` is the optional `--suffix` argument;\n"
                "    - `what` is either nothing, `src` or `pdbs`.\n"
+               "  \n"
+               "  With --symbols, also creates a symbol store in `symbols/` that\n"
+               "  can be used as a symbol server: PDBs are in\n"
+               "  `name.pdb/<guid><age>/name.pdb` and binaries in\n"
+               "  `name.dll/<timestamp><size>/name.dll`.\n"
+               "  \n"
+               "  The binary archive comes with a manifest of its files. With\n"
+               "  --delta-from, also creates a `delta-<old version>` archive with\n"
+               "  the files that changed since the release of the given manifest;\n"
+               "  with --delta-base, large modified files are binary deltas\n"
+               "  against that release's files.\n"
                "\n"
                "official\n"
                "  Creates a new full build in the prefix. Requires that directory\n"
-               "  to be empty. Puts the binary archive, source, PDBs and installer\n"
-               "  in `$prefix/releases/version`. Forces all tasks to be enabled,\n"
-               "  including translations and installer. Make sure the transifex API\n"
-               "  key is in the INI or TX_TOKEN is set.";
+               "  to be empty. Puts the binary archive, source, PDBs, symbol store\n"
+               "  and installer in `$prefix/releases/version`. Forces all tasks to\n"
+               "  be enabled, including translations and installer. Make sure the\n"
+               "  transifex API key is in the INI or TX_TOKEN is set.";
     }
 
     std::string release_command::version_from_exe() const
@@ -492,16 +1081,14 @@ namespace mob {
         // matching: #define VER_FILEVERSION_STR "2.2.1\0"
         std::regex re(R"(#define VER_FILEVERSION_STR "(.+)\\0")");
 
-        const std::string rc = op::read_text_file(gcx(), encodings::utf8, rc_path_);
-
-        std::smatch m;
+        std::match_results<std::string_view::const_iterator> m;
         std::string v;
 
-        for_each_line(rc, [&](std::string_view line) {
-            std::string line_s(line);
-            if (std::regex_match(line_s, m, re))
-                v = m[1];
-        });
+        op::read_text_lines(gcx(), encodings::utf8, rc_path_,
+                            [&](std::string_view line) {
+                                if (std::regex_match(line.begin(), line.end(), m, re))
+                                    v = m[1];
+                            });
 
         if (v.empty()) {
             gcx().bail_out(context::generic, "can't find version string in {}",
@@ -169,6 +169,10 @@ namespace mob {
         for (auto&& w : ps.warnings())
             u8cerr << w << "\n";
 
+        // lrelease is found in PATH, qt's bin directory is only added to it once
+        // it's been resolved
+        conf().path().qt_bin();
+
         thread_pool tp;
 
         for (auto& p : ps.get()) {
@@ -0,0 +1,155 @@
+#include "pch.h"
+#include "checkpoint.h"
+#include "conf.h"
+#include "context.h"
+#include "op.h"
+
+namespace mob {
+
+    checkpoints& checkpoints::instance()
+    {
+        static checkpoints c;
+        return c;
+    }
+
+    fs::path checkpoints::file()
+    {
+        return conf().path().prefix() / "mob_checkpoints.json";
+    }
+
+    void checkpoints::begin(const std::string& inputs)
+    {
+        std::scoped_lock lock(mutex_);
+
+        enabled_ = true;
+        inputs_  = inputs;
+        tasks_.clear();
+
+        const auto p = file();
+        if (!fs::exists(p))
+            return;
+
+        const std::string s =
+            op::read_text_file(gcx(), encodings::utf8, p, op::optional);
+
+        // a broken file just means everything runs again
+        const auto json = nlohmann::json::parse(s, nullptr, false);
+        if (json.is_discarded() || !json.is_object()) {
+            gcx().warning(context::generic, "bad checkpoint file {}, ignoring", p);
+            return;
+        }
+
+        if (json.value("inputs", "") != inputs_) {
+            gcx().info(context::generic,
+                       "options changed since the last interrupted build, "
+                       "not resuming");
+            return;
+        }
+
+        const auto& tasks = json["tasks"];
+        if (!tasks.is_object())
+            return;
+
+        for (auto&& [task, v] : tasks.items()) {
+            if (!v.is_object() || !v.contains("phases") || !v["phases"].is_array())
+                continue;
+
+            task_checkpoint tc;
+            tc.fingerprint = v.value("fingerprint", "");
+
+            for (auto&& phase : v["phases"]) {
+                if (phase.is_string())
+                    tc.phases.insert(phase.get<std::string>());
+            }
+
+            tasks_[task] = std::move(tc);
+        }
+
+        if (!tasks_.empty()) {
+            gcx().info(context::generic,
+                       "resuming the last interrupted build, {} tasks have "
+                       "completed phases",
+                       tasks_.size());
+        }
+    }
+
+    bool checkpoints::enabled()
+    {
+        std::scoped_lock lock(mutex_);
+        return enabled_;
+    }
+
+    bool checkpoints::recorded(const std::string& task, std::string_view phase)
+    {
+        std::scoped_lock lock(mutex_);
+
+        if (!enabled_)
+            return false;
+
+        auto itor = tasks_.find(task);
+        return (itor != tasks_.end() && itor->second.phases.contains(phase));
+    }
+
+    bool checkpoints::completed(const std::string& task, std::string_view phase,
+                                const std::string& fp)
+    {
+        std::scoped_lock lock(mutex_);
+
+        if (!enabled_)
+            return false;
+
+        auto itor = tasks_.find(task);
+        if (itor == tasks_.end())
+            return false;
+
+        const auto& tc = itor->second;
+        return (tc.fingerprint == fp && tc.phases.contains(phase));
+    }
+
+    void checkpoints::complete(const std::string& task, std::string_view phase,
+                               const std::string& fp)
+    {
+        std::scoped_lock lock(mutex_);
+
+        if (!enabled_)
+            return;
+
+        auto& tc       = tasks_[task];
+        tc.fingerprint = fp;
+        tc.phases.insert(std::string(phase));
+
+        save();
+    }
+
+    void checkpoints::finish()
+    {
+        std::scoped_lock lock(mutex_);
+
+        if (!enabled_)
+            return;
+
+        enabled_ = false;
+        tasks_.clear();
+
+        op::delete_file(gcx(), file(), op::optional);
+    }
+
+    void checkpoints::save()
+    {
+        if (conf().global().dry())
+            return;
+
+        nlohmann::json json;
+        json["inputs"] = inputs_;
+        json["tasks"]  = nlohmann::json::object();
+
+        for (auto&& [task, tc] : tasks_) {
+            json["tasks"][task] = {{"fingerprint", tc.fingerprint},
+                                   {"phases", tc.phases}};
+        }
+
+        op::write_text_file(gcx(), encodings::utf8, file(), json.dump(2),
+                            op::optional);
+    }
+
+}  // namespace mob
@@ -0,0 +1,76 @@
+#pragma once
+
+namespace mob {
+
+    // remembers which phases of which tasks completed during a build that
+    // didn't finish, so the next build can skip them instead of running every
+    // task from the start; singleton
+    //
+    // the checkpoints are a json file in the prefix, rewritten (atomically, see
+    // op::write_text_file()) every time a phase completes and deleted once all
+    // the tasks have run successfully, so it only exists after a build was
+    // interrupted, crashed or failed
+    //
+    // the file is only used if it was written for the same options, see begin();
+    // each task also has a fingerprint of its inputs taken when its last phase
+    // completed, so the task runs again if the source directory was deleted or
+    // replaced, or its checkout or files changed since, see
+    // task::checkpoint_fingerprint()
+    //
+    class checkpoints {
+    public:
+        static checkpoints& instance();
+
+        // enables checkpoints for this run; loads the file and discards it if
+        // `inputs` is different from the one it was written with
+        //
+        void begin(const std::string& inputs);
+
+        // whether begin() was called
+        //
+        bool enabled();
+
+        // whether the given phase completed in the previous run, regardless of
+        // the task's fingerprint; used to avoid computing fingerprints for
+        // nothing
+        //
+        bool recorded(const std::string& task, std::string_view phase);
+
+        // whether the given phase completed in the previous run and the task's
+        // fingerprint is still the same; always false if begin() wasn't called
+        //
+        bool completed(const std::string& task, std::string_view phase,
+                       const std::string& fp);
+
+        // remembers that the given phase completed, updates the task's
+        // fingerprint and writes the file; does nothing if begin() wasn't called
+        //
+        void complete(const std::string& task, std::string_view phase,
+                      const std::string& fp);
+
+        // deletes the file, called when all the tasks ran successfully
+        //
+        void finish();
+
+        // path to the checkpoint file, prefix/mob_checkpoints.json
+        //
+        static fs::path file();
+
+    private:
+        // completed phases of a task
+        struct task_checkpoint {
+            std::string fingerprint;
+            std::set<std::string, std::less<>> phases;
+        };
+
+        bool enabled_ = false;
+        std::string inputs_;
+        std::map<std::string, task_checkpoint, std::less<>> tasks_;
+        std::mutex mutex_;
+
+        // writes the file; mutex must be locked
+        //
+        void save();
+    };
+
+}  // namespace mob
@@ -27,6 +27,16 @@ namespace mob::details {
     // for overrides
     static section_map g_tasks;
 
+    // options that are only resolved the first time they're read, keyed on
+    // "section/key", see set_lazy()
+    //
+    // the mutex is recursive because resolving an option reads others, some of
+    // which can be lazy too; g_has_lazy avoids locking for every read once
+    // everything has been resolved
+    static std::map<std::string, std::function<void()>, std::less<>> g_lazy;
+    static std::recursive_mutex g_lazy_mutex;
+    static std::atomic<bool> g_has_lazy = false;
+
     // special cases to avoid string manipulations
     static int g_output_log_level = 3;
     static int g_file_log_level   = 5;
@@ -49,10 +59,64 @@ namespace mob::details {
         return (s == "true" || s == "yes" || s == "1");
     }
 
+    // calls the resolver for the given option if it hasn't been resolved yet
+    //
+    void resolve_lazy(std::string_view section, std::string_view key)
+    {
+        std::scoped_lock lock(g_lazy_mutex);
+
+        auto itor = g_lazy.find(std::format("{}/{}", section, key));
+        if (itor == g_lazy.end())
+            return;
+
+        // removed before calling it because the resolver reads the current value
+        // of the option
+        auto f = std::move(itor->second);
+        g_lazy.erase(itor);
+
+        const auto start = hr_clock::now();
+
+        try {
+            f();
+        }
+        catch (...) {
+            // put it back so the next read fails the same way instead of getting
+            // an unresolved value
+            g_lazy.emplace(std::format("{}/{}", section, key), std::move(f));
+            throw;
+        }
+
+        // only cleared once the value is set, another thread reading this
+        // option in the meantime waits on the mutex
+        g_has_lazy = !g_lazy.empty();
+
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            hr_clock::now() - start);
+
+        gcx().debug(context::conf, "resolved {}/{} in {}ms", section, key,
+                    ms.count());
+    }
+
+    // `f` will be called to resolve the given option the first time it's read
+    //
+    void set_lazy(std::string_view section, std::string_view key,
+                  std::function<void()> f)
+    {
+        std::scoped_lock lock(g_lazy_mutex);
+
+        g_lazy[std::format("{}/{}", section, key)] = std::move(f);
+        g_has_lazy = true;
+    }
+
     // returns a string from conf, bails out if it doesn't exist
     //
     std::string get_string(std::string_view section, std::string_view key)
     {
+        alloc_scope scope(alloc_tag::conf);
+
+        if (g_has_lazy)
+            resolve_lazy(section, key);
+
         auto sitor = g_conf.find(section);
         if (sitor == g_conf.end())
             gcx().bail_out(context::conf, "[{}] doesn't exist", section);
@@ -160,6 +224,8 @@ namespace mob::details {
     std::string get_string_for_task(const std::vector<std::string>& task_names,
                                     std::string_view key)
     {
+        alloc_scope scope(alloc_tag::conf);
+
         // some command line options will override any user settings, like
         // --no-pull, those are stored in a special _override task name
         auto v = find_string_for_task("_override", key);
@@ -357,6 +423,16 @@ namespace mob {
         details::set_string("paths", key, path_to_utf8(p));
     }
 
+    // same as set_path_if_empty(), but only the first time the path is read
+    //
+    template <class F>
+    void lazy_path_if_empty(std::string_view key, F&& f)
+    {
+        details::set_lazy("paths", key, [key = std::string(key), f] {
+            set_path_if_empty(key, f);
+        });
+    }
+
     // sets an option `key` in the `paths` section:
     //   - if the path is empty, sets it as default_parent/default_dir,
     //   - if the path is not empty but is relative, resolves it against
@@ -448,7 +524,8 @@ namespace mob {
         else {
             // not a task option, goes into g_conf
 
-            if (master)
+            // profiles are user-defined, any ini can add them
+            if (master || section == "build-profiles")
                 details::add_string(section, key, value);
             else
                 details::set_string(section, key, value);
@@ -508,13 +585,28 @@ namespace mob {
 
         set_path_if_empty("pf_x86", find_program_files_x86);
         set_path_if_empty("pf_x64", find_program_files_x64);
-        set_path_if_empty("vs", find_vs);
-        set_path_if_empty("vcpkg", find_vcpkg);  // set after vs as it will use the VS
-        set_path_if_empty("qt_install", find_qt);
         set_path_if_empty("temp_dir", find_temp_dir);
         set_path_if_empty("licenses", find_in_root("licenses"));
-        set_path_if_empty("qt_bin", qt::installation_path() / "bin");
-        set_path_if_empty("qt_translations", qt::installation_path() / "translations");
+
+        // these run external programs or go through many directories, they're
+        // only resolved when first read; vcpkg reads vs and qt_bin reads
+        // qt_install, which resolves them first if needed
+        lazy_path_if_empty("vs", find_vs);
+        lazy_path_if_empty("vcpkg", find_vcpkg);
+        lazy_path_if_empty("qt_install", find_qt);
+
+        // qt's bin directory is also put in PATH once it's known
+        details::set_lazy("paths", "qt_bin", [] {
+            set_path_if_empty("qt_bin", [] {
+                return qt::installation_path() / "bin";
+            });
+
+            this_env::append_to_path(conf().path().get("qt_bin"));
+        });
+
+        lazy_path_if_empty("qt_translations", [] {
+            return qt::installation_path() / "translations";
+        });
 
         // second, if any of these paths are relative, they use the second argument
         // as the root; if they're empty, they combine the second and third
@@ -542,8 +634,32 @@ namespace mob {
         // other tools (7z, jom, patch, etc.) are assumed to be in PATH (which
         // now contains third-party) or have valid absolute paths in the ini
 
-        details::set_string("tools", "vcvars", path_to_utf8(find_vcvars()));
-        details::set_string("tools", "iscc", path_to_utf8(find_iscc()));
+        details::set_lazy("tools", "vcvars", [] {
+            details::set_string("tools", "vcvars", path_to_utf8(find_vcvars()));
+        });
+
+        details::set_lazy("tools", "iscc", [] {
+            details::set_string("tools", "iscc", path_to_utf8(find_iscc()));
+        });
+    }
+
+    void resolve_lazy_options()
+    {
+        for (;;) {
+            std::string name;
+
+            {
+                std::scoped_lock lock(details::g_lazy_mutex);
+                if (details::g_lazy.empty())
+                    break;
+
+                name = details::g_lazy.begin()->first;
+            }
+
+            // reading the option resolves it
+            const auto slash = name.find('/');
+            details::get_string(name.substr(0, slash), name.substr(slash + 1));
+        }
     }
 
     void conf::set_log_file()
@@ -561,6 +677,8 @@ namespace mob {
     {
         MOB_ASSERT(!inis.empty());
 
+        const auto start = hr_clock::now();
+
         // some logging
         gcx().debug(context::conf, "cl: {}", std::wstring(GetCommandLineW()));
         gcx().debug(context::conf, "using inis in order:");
@@ -626,12 +744,19 @@ namespace mob {
         // set up the log file, resolve against prefix if relative
         conf().set_log_file();
 
+        const auto loaded = hr_clock::now();
+
         // goes through all paths and tools, finds missing or relative stuff, bails
-        // out of stuff can't be found
+        // out of stuff can't be found; some of them are only resolved when read
         resolve_paths();
 
-        // make sure qt's bin directory is in the path
-        this_env::append_to_path(conf().path().get("qt_bin"));
+        using namespace std::chrono;
+
+        gcx().debug(context::conf,
+                    "options loaded in {}ms, paths resolved in {}ms, {} deferred",
+                    duration_cast<milliseconds>(loaded - start).count(),
+                    duration_cast<milliseconds>(hr_clock::now() - loaded).count(),
+                    details::g_lazy.size());
     }
 
     bool verify_options()
@@ -682,11 +807,21 @@ namespace mob {
         return {};
     }
 
+    conf_gc conf::gc()
+    {
+        return {};
+    }
+
     conf_versions conf::version()
     {
         return {};
     }
 
+    conf_build_profiles conf::build_profiles()
+    {
+        return {};
+    }
+
     conf_build_types conf::build_types()
     {
         return {};
@@ -749,6 +884,11 @@ namespace mob {
         return details::get_string_for_task(names_, key);
     }
 
+    void conf_task::set(std::string_view key, std::string_view value)
+    {
+        details::set_string_for_task(names_[0], std::string(key), std::string(value));
+    }
+
     bool conf_task::get_bool(std::string_view key) const
     {
         return details::get_bool_for_task(names_, key);
@@ -762,14 +902,96 @@ namespace mob {
             details::s_configuration_values);
     }
 
+    std::vector<mob::config> conf_task::configurations() const
+    {
+        const auto main = configuration();
+        const auto s    = details::get_string_for_task(names_, "configurations");
+
+        std::vector<mob::config> v;
+
+        for (auto&& part : split(s, ",;")) {
+            const auto name = trim_copy(part);
+            if (name.empty())
+                continue;
+
+            const auto c = details::parse_cmake_value(
+                names_[0], "configurations", name, details::s_configuration_values);
+
+            if (std::find(v.begin(), v.end(), c) == v.end())
+                v.push_back(c);
+        }
+
+        if (v.empty())
+            return {main};
+
+        // the main configuration goes first, it's installed in the regular
+        // install directory
+        auto itor = std::find(v.begin(), v.end(), main);
+        if (itor != v.end())
+            std::rotate(v.begin(), itor, itor + 1);
+
+        return v;
+    }
+
+    std::vector<std::string> conf_task::compare_profiles() const
+    {
+        const auto s = details::get_string_for_task(names_, "compare_profiles");
+
+        std::vector<std::string> v;
+
+        for (auto&& part : split(s, ",;")) {
+            auto name = trim_copy(part);
+            if (!name.empty())
+                v.push_back(std::move(name));
+        }
+
+        return v;
+    }
+
     conf_tools::conf_tools() : conf_section("tools") {}
 
     conf_transifex::conf_transifex() : conf_section("transifex") {}
 
+    conf_gc::conf_gc() : conf_section("gc") {}
+
     conf_versions::conf_versions() : conf_section("versions") {}
 
     conf_build_types::conf_build_types() : conf_section("build-types") {}
 
+    conf_build_profiles::conf_build_profiles() : conf_section("build-profiles") {}
+
+    std::vector<std::pair<std::string, std::string>>
+    conf_build_profiles::defs(std::string_view profile) const
+    {
+        const auto sitor = details::g_conf.find("build-profiles");
+
+        if (sitor == details::g_conf.end() || !sitor->second.contains(profile)) {
+            gcx().bail_out(context::conf,
+                           "build profile '{}' not found in [build-profiles]",
+                           profile);
+        }
+
+        std::vector<std::pair<std::string, std::string>> v;
+
+        for (auto&& part : split(get(profile), " \t")) {
+            const auto def = trim_copy(part);
+            if (def.empty())
+                continue;
+
+            const auto eq = def.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                gcx().bail_out(context::conf,
+                               "bad definition '{}' in build profile '{}', must be "
+                               "NAME=VALUE",
+                               def, profile);
+            }
+
+            v.emplace_back(def.substr(0, eq), def.substr(eq + 1));
+        }
+
+        return v;
+    }
+
     conf_prebuilt::conf_prebuilt() : conf_section("prebuilt") {}
 
     conf_paths::conf_paths() : conf_section("paths") {}
@@ -43,9 +43,19 @@ namespace mob {
     // reads options from the given inis and option strings, resolves all the paths
     // and necessary tools, also adds a couple of things to PATH
     //
+    // paths and tools that need to be searched for, like visual studio or qt, are
+    // only resolved the first time they're read, so commands that don't use them
+    // don't pay for the search and don't fail when they're missing
+    //
     void init_options(const std::vector<fs::path>& inis,
                       const std::vector<std::string>& opts);
 
+    // resolves all the paths and tools that haven't been read yet, bails out if
+    // any of them can't be found; called before running tasks so a missing tool
+    // fails the build right away instead of in the middle of it
+    //
+    void resolve_lazy_options();
+
     // checks some of the options once everything is loaded, returns false if
     // something's wrong
     //
@@ -121,6 +131,7 @@ namespace mob {
         bool clean() const { return get<bool>("clean_task"); }
         bool fetch() const { return get<bool>("fetch_task"); }
         bool build() const { return get<bool>("build_task"); }
+        bool offline() const { return get<bool>("offline"); }
     };
 
     // options in [cmake]
@@ -157,6 +168,11 @@ namespace mob {
         template <class T>
         T get(std::string_view key) const;
 
+        // sets the option for the first task name, bails out if the option
+        // doesn't exist
+        //
+        void set(std::string_view key, std::string_view value);
+
         template <>
         bool get<bool>(std::string_view key) const
         {
@@ -166,6 +182,10 @@ namespace mob {
         std::string mo_org() const { return get("mo_org"); }
         std::string mo_branch() const { return get("mo_branch"); }
         std::string mo_fallback_branch() const { return get("mo_fallback"); }
+        std::string mo_worktree() const { return get("mo_worktree"); }
+        std::string mo_install() const { return get("mo_install"); }
+        std::string mo_build() const { return get("mo_build"); }
+        std::string profile() const { return get("profile"); }
         bool no_pull() const { return get<bool>("no_pull"); }
         bool revert_ts() const { return get<bool>("revert_ts"); }
         bool ignore_ts() const { return get<bool>("ignore_ts"); }
@@ -189,6 +209,16 @@ namespace mob {
         //
         mob::config configuration() const;
 
+        // every configuration to build from `configurations`, or just
+        // configuration() if it's empty; the main configuration is first, it's
+        // configuration() if it's in the list, or the first one given otherwise
+        //
+        std::vector<mob::config> configurations() const;
+
+        // profiles from `compare_profiles`, empty if none were given
+        //
+        std::vector<std::string> compare_profiles() const;
+
     private:
         std::vector<std::string> names_;
 
@@ -209,6 +239,13 @@ namespace mob {
         conf_transifex();
     };
 
+    // options in [gc]
+    //
+    class conf_gc : public conf_section<std::string> {
+    public:
+        conf_gc();
+    };
+
     // options in [versions]
     //
     class conf_versions : public conf_section<std::string> {
@@ -223,6 +260,23 @@ namespace mob {
         conf_build_types();
     };
 
+    // options in [build-profiles]; every key is the name of a profile and its
+    // value is a list of cmake definitions, like `CMAKE_UNITY_BUILD=ON`,
+    // separated by spaces
+    //
+    // keys can be added by any ini, not just the master one
+    //
+    class conf_build_profiles : public conf_section<std::string> {
+    public:
+        conf_build_profiles();
+
+        // name and value of every definition in the given profile, bails out if
+        // the profile doesn't exist
+        //
+        std::vector<std::pair<std::string, std::string>>
+        defs(std::string_view profile) const;
+    };
+
     // options in [prebuilt]
     //
     class conf_prebuilt : public conf_section<std::string> {
@@ -283,6 +337,8 @@ namespace mob {
         conf_cmake cmake();
         conf_tools tool();
         conf_transifex transifex();
+        conf_gc gc();
+        conf_build_profiles build_profiles();
         conf_prebuilt prebuilt();
         conf_versions version();
         conf_build_types build_types();
@@ -4,6 +4,7 @@
 #include "../tools/tools.h"
 #include "../utility.h"
 #include "conf.h"
+#include "metrics.h"
 
 namespace mob {
 
@@ -188,6 +189,11 @@ namespace mob {
         tool_ = t;
     }
 
+    const std::string& context::task_name() const
+    {
+        return task_;
+    }
+
     const context* context::global()
     {
         static thread_local context c("");
@@ -240,6 +246,8 @@ namespace mob {
     void context::do_log_impl(bool bail, reason r, level lv,
                               std::string_view utf8) const
     {
+        alloc_scope scope(alloc_tag::log);
+
         std::string_view sv = make_log_string(r, lv, utf8);
 
         if (bail) {
@@ -263,6 +271,7 @@ namespace mob {
             // will revert color in dtor
             console_color c = level_color(lv);
             u8cout.write_ln(utf8);
+            run_metrics::instance().add_log_bytes(utf8.size() + 1);
         }
 
         // log file
@@ -273,6 +282,7 @@ namespace mob {
                         &written, nullptr);
 
             ::WriteFile(g_log_file.get(), "\r\n", 2, &written, nullptr);
+            run_metrics::instance().add_log_bytes(utf8.size() + 2);
         }
 
         // remember warnings and errors
@@ -108,6 +108,10 @@ namespace mob {
         //
         void set_tool(tool* t);
 
+        // name of the task given in the constructor, empty for the global context
+        //
+        const std::string& task_name() const;
+
         // logs a simple string with the given level
         //
         void log_string(reason r, level lv, std::string_view s) const;
@@ -197,6 +201,8 @@ namespace mob {
             if (!bail && !enabled(lv))
                 return;
 
+            alloc_scope scope(alloc_tag::log);
+
             try {
                 // formatting string
                 const std::string s = std::format(f, std::forward<Args>(args)...);
@@ -6,12 +6,13 @@
 #include "context.h"
 #include "op.h"
 #include "process.h"
+#include "single_flight.h"
 
 namespace mob {
 
     // retrieves the Visual Studio environment variables for the given architecture;
     // this is pretty expensive, so it's called on demand and only once, and is
-    // stored as a static variable in vs_x86() and vs_x64() below
+    // cached by vcvars_env() below
     //
     env get_vcvars_env(arch a)
     {
@@ -55,47 +56,70 @@ namespace mob {
 
         gcx().trace(context::generic, "reading from {}", tmp);
 
-        // reads the file, converting utf16 to utf8
-        std::stringstream ss(op::read_text_file(gcx(), encodings::utf16, tmp));
-        op::delete_file(gcx(), tmp);
-
-        // `ss` contains all the variables in utf8
-
         env e;
 
         gcx().trace(context::generic, "parsing variables");
 
-        for (;;) {
-            std::string line;
-            std::getline(ss, line);
-            if (!ss)
-                break;
-
+        // reads the file, converting utf16 to utf8
+        op::read_text_lines(gcx(), encodings::utf16, tmp, [&](std::string_view line) {
             const auto sep = line.find('=');
 
             if (sep == std::string::npos)
-                continue;
+                return;
 
-            std::string name  = line.substr(0, sep);
-            std::string value = line.substr(sep + 1);
+            std::string name(line.substr(0, sep));
+            std::string value(line.substr(sep + 1));
 
             gcx().trace(context::generic, "{} = {}", name, value);
             e.set(std::move(name), std::move(value));
-        }
+        });
+
+        op::delete_file(gcx(), tmp);
 
         return e;
     }
 
+    // environments returned by get_vcvars_env(), by architecture
+    //
+    static std::map<arch, env> g_vcvars_envs;
+    static std::mutex g_vcvars_envs_mutex;
+
+    // tasks that need the same environment at the same time wait on the first
+    // one
+    //
+    static single_flight<env> g_vcvars_flights("vcvars");
+
+    // returns the cached environment for the given architecture, runs vcvars if
+    // it's not cached yet
+    //
+    env vcvars_env(arch a, const std::string& name)
+    {
+        return g_vcvars_flights.run(gcx(), name, [&] {
+            {
+                std::scoped_lock lock(g_vcvars_envs_mutex);
+
+                auto itor = g_vcvars_envs.find(a);
+                if (itor != g_vcvars_envs.end())
+                    return itor->second;
+            }
+
+            env e = get_vcvars_env(a);
+
+            std::scoped_lock lock(g_vcvars_envs_mutex);
+            g_vcvars_envs.emplace(a, e);
+
+            return e;
+        });
+    }
+
     env env::vs_x86()
     {
-        static env e = get_vcvars_env(arch::x86);
-        return e;
+        return vcvars_env(arch::x86, "x86");
     }
 
     env env::vs_x64()
     {
-        static env e = get_vcvars_env(arch::x64);
-        return e;
+        return vcvars_env(arch::x64, "x64");
     }
 
     env env::vs(arch a)
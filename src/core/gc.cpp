@@ -0,0 +1,521 @@
+#include "pch.h"
+#include "gc.h"
+#include "../tasks/task.h"
+#include "../tasks/task_manager.h"
+#include "../tools/tools.h"
+#include "conf.h"
+#include "context.h"
+#include "op.h"
+
+namespace mob {
+
+    constexpr std::uintmax_t megabyte = 1024 * 1024;
+
+    // absolute, normalized and lowercase so paths can be compared as strings
+    //
+    std::string normalize_path(const fs::path& p)
+    {
+        std::string s = path_to_utf8(fs::absolute(p).lexically_normal());
+
+        for (auto& c : s) {
+            if (c == '/')
+                c = '\\';
+            else if (c >= 'A' && c <= 'Z')
+                c = static_cast<char>(c - 'A' + 'a');
+        }
+
+        while (s.size() > 1 && s.back() == '\\')
+            s.pop_back();
+
+        return s;
+    }
+
+    // GetTempFileName() creates "mobXXXX.tmp", used by make_temp_file() and
+    // write_text_file()
+    //
+    bool is_temp_file(const fs::directory_entry& e)
+    {
+        const auto name = path_to_utf8(e.path().filename());
+        return e.is_regular_file() && name.starts_with("mob") && name.ends_with(".tmp");
+    }
+
+    // whether `p` is `dir` or is inside it, both must be normalized
+    //
+    bool is_inside(std::string_view p, std::string_view dir)
+    {
+        if (!p.starts_with(dir))
+            return false;
+
+        // either the same or the next character is a separator, so c:\a\bc is
+        // not inside c:\a\b
+        return (p.size() == dir.size() || p[dir.size()] == '\\');
+    }
+
+    std::int64_t to_seconds(access_log::time_point t)
+    {
+        using namespace std::chrono;
+        return duration_cast<seconds>(t.time_since_epoch()).count();
+    }
+
+    access_log::time_point from_seconds(std::int64_t s)
+    {
+        return access_log::time_point(std::chrono::seconds(s));
+    }
+
+    access_log& access_log::instance()
+    {
+        static access_log log;
+        return log;
+    }
+
+    fs::path access_log::file()
+    {
+        return conf().path().prefix() / "mob_access.json";
+    }
+
+    void access_log::touch(const fs::path& p)
+    {
+        std::scoped_lock lock(mutex_);
+        load();
+
+        entries_[normalize_path(p)] = to_seconds(std::chrono::system_clock::now());
+        dirty_                      = true;
+    }
+
+    std::optional<access_log::time_point> access_log::last_used(const fs::path& p)
+    {
+        std::scoped_lock lock(mutex_);
+        load();
+
+        const auto k = normalize_path(p);
+        std::optional<std::int64_t> latest;
+
+        // entries are sorted, so everything inside `p` comes right after it
+        for (auto itor = entries_.lower_bound(k); itor != entries_.end(); ++itor) {
+            if (!itor->first.starts_with(k))
+                break;
+
+            if (!is_inside(itor->first, k))
+                continue;
+
+            latest = std::max(latest.value_or(itor->second), itor->second);
+        }
+
+        if (!latest)
+            return {};
+
+        return from_seconds(*latest);
+    }
+
+    void access_log::forget(const fs::path& p)
+    {
+        std::scoped_lock lock(mutex_);
+        load();
+
+        const auto k = normalize_path(p);
+
+        for (auto itor = entries_.lower_bound(k); itor != entries_.end();) {
+            if (!itor->first.starts_with(k))
+                break;
+
+            if (is_inside(itor->first, k)) {
+                itor   = entries_.erase(itor);
+                dirty_ = true;
+            }
+            else {
+                ++itor;
+            }
+        }
+    }
+
+    void access_log::load()
+    {
+        if (loaded_)
+            return;
+
+        loaded_ = true;
+
+        const auto p = file();
+        if (!fs::exists(p))
+            return;
+
+        const std::string s =
+            op::read_text_file(gcx(), encodings::utf8, p, op::optional);
+
+        // a broken file is not worth failing over, things will just look older
+        // than they are until they're used again
+        const auto json = nlohmann::json::parse(s, nullptr, false);
+        if (json.is_discarded() || !json.is_object()) {
+            gcx().warning(context::generic, "bad access log {}, ignoring", p);
+            return;
+        }
+
+        for (auto&& [path, seconds] : json.items()) {
+            if (seconds.is_number_integer())
+                entries_[path] = seconds.get<std::int64_t>();
+        }
+    }
+
+    void access_log::save()
+    {
+        std::scoped_lock lock(mutex_);
+
+        if (!dirty_ || conf().global().dry())
+            return;
+
+        nlohmann::json json = nlohmann::json::object();
+
+        for (auto&& [path, seconds] : entries_)
+            json[path] = seconds;
+
+        op::write_text_file(gcx(), encodings::utf8, file(), json.dump(2),
+                            op::optional);
+
+        dirty_ = false;
+    }
+
+    garbage_collector::garbage_collector() = default;
+
+    std::uintmax_t garbage_collector::freed() const
+    {
+        return freed_;
+    }
+
+    void garbage_collector::run()
+    {
+        find_kept();
+
+        std::vector<category> cs = {downloads(), builds(), releases(), temp()};
+
+        for (auto& c : cs)
+            collect(c);
+
+        access_log::instance().save();
+
+        gcx().info(context::generic, "gc: {} {} MB",
+                   (conf().global().dry() ? "would have freed" : "freed"),
+                   freed_ / megabyte);
+    }
+
+    void garbage_collector::find_kept()
+    {
+        kept_.clear();
+
+        // disabled tasks too, they're only disabled for this run, like with
+        // `mob build uibase`
+        for (auto* t : task_manager::instance().all()) {
+            for (auto&& p : t->get_kept_paths()) {
+                if (!p.empty())
+                    kept_.push_back(p);
+            }
+        }
+
+        // worktrees created by `mob pr pull --worktree` for all prs, see
+        // pr_command::worktrees_root(); they're deleted by `mob pr revert`
+        kept_.push_back(conf().path().build() / "pr");
+
+        for (auto&& p : kept_)
+            gcx().trace(context::generic, "gc: keeping {}", p);
+    }
+
+    bool garbage_collector::is_kept(const fs::path& p) const
+    {
+        const auto np = normalize_path(p);
+
+        for (auto&& k : kept_) {
+            const auto nk = normalize_path(k);
+
+            // either the entry is something like build/ and contains a source
+            // directory, or it's inside a kept directory
+            if (is_inside(nk, np) || is_inside(np, nk))
+                return true;
+        }
+
+        return false;
+    }
+
+    garbage_collector::entry garbage_collector::make_entry(const fs::path& p) const
+    {
+        entry e;
+        e.path = p;
+        e.kept = is_kept(p);
+
+        std::error_code ec;
+
+        if (fs::is_directory(p, ec)) {
+            const auto opts = fs::directory_options::skip_permission_denied;
+
+            for (auto itor = fs::recursive_directory_iterator(p, opts, ec);
+                 itor != fs::recursive_directory_iterator(); itor.increment(ec)) {
+                if (ec)
+                    break;
+
+                // working trees must be checked for changes before deleting
+                // them, see evict()
+                if (itor->path().filename() == ".git")
+                    e.working_trees.push_back(itor->path().parent_path());
+
+                if (itor->is_regular_file(ec))
+                    e.size += itor->file_size(ec);
+            }
+        }
+        else {
+            e.size = fs::file_size(p, ec);
+        }
+
+        if (auto t = access_log::instance().last_used(p)) {
+            e.last_used = *t;
+        }
+        else {
+            // never recorded, probably predates the access log; write times are
+            // not a good indication of use, especially for directories, so it
+            // starts aging now
+            e.last_used = std::chrono::system_clock::now();
+            access_log::instance().touch(p);
+        }
+
+        return e;
+    }
+
+    garbage_collector::category garbage_collector::downloads() const
+    {
+        category c;
+        c.name     = "downloads";
+        c.max_size = conf().gc().get<int>("downloads_size") * megabyte;
+        c.max_age  = std::chrono::days(conf().gc().get<int>("downloads_age"));
+
+        // the cache can be configured outside the prefix
+        c.unsafe = true;
+
+        const auto dir = conf().path().cache();
+        if (!fs::exists(dir))
+            return c;
+
+        for (auto&& e : fs::directory_iterator(dir)) {
+            // leftovers from write_text_file() are handled by temp()
+            if (e.is_regular_file() && !is_temp_file(e))
+                c.entries.push_back(make_entry(e.path()));
+        }
+
+        return c;
+    }
+
+    garbage_collector::category garbage_collector::builds() const
+    {
+        category c;
+        c.name     = "builds";
+        c.max_size = conf().gc().get<int>("builds_size") * megabyte;
+        c.max_age  = std::chrono::days(conf().gc().get<int>("builds_age"));
+
+        const auto dir   = conf().path().build();
+        const auto cache = normalize_path(conf().path().cache());
+
+        if (!fs::exists(dir))
+            return c;
+
+        for (auto&& e : fs::directory_iterator(dir)) {
+            if (!e.is_directory())
+                continue;
+
+            // the cache could be in the build directory, that's downloads()
+            const auto np = normalize_path(e.path());
+            if (is_inside(np, cache) || is_inside(cache, np))
+                continue;
+
+            c.entries.push_back(make_entry(e.path()));
+        }
+
+        return c;
+    }
+
+    garbage_collector::category garbage_collector::releases() const
+    {
+        category c;
+        c.name     = "releases";
+        c.max_size = conf().gc().get<int>("releases_size") * megabyte;
+        c.max_age  = std::chrono::days(conf().gc().get<int>("releases_age"));
+
+        // see release_command::prepare()
+        const auto dir = conf().path().prefix() / "releases";
+        if (!fs::exists(dir))
+            return c;
+
+        for (auto&& e : fs::directory_iterator(dir)) {
+            if (e.is_directory())
+                c.entries.push_back(make_entry(e.path()));
+        }
+
+        return c;
+    }
+
+    garbage_collector::category garbage_collector::temp() const
+    {
+        category c;
+        c.name    = "temp";
+        c.max_age = std::chrono::days(conf().gc().get<int>("temp_age"));
+        c.unsafe  = true;
+
+        // files from make_temp_file() and interrupted write_text_file(), which
+        // writes mostly ini and json files in the prefix; the directories can be
+        // the same
+        std::set<std::string> seen;
+
+        for (auto&& dir : {conf().path().temp_dir(), conf().path().prefix(),
+                           conf().path().cache()}) {
+            if (!fs::exists(dir) || !seen.insert(normalize_path(dir)).second)
+                continue;
+
+            for (auto&& e : fs::directory_iterator(dir)) {
+                if (is_temp_file(e))
+                    c.entries.push_back(make_entry(e.path()));
+            }
+        }
+
+        return c;
+    }
+
+    void garbage_collector::collect(category& c)
+    {
+        using namespace std::chrono;
+
+        std::uintmax_t total = 0;
+        for (auto&& e : c.entries)
+            total += e.size;
+
+        gcx().debug(context::generic, "gc: {} has {} entries, {} MB", c.name,
+                    c.entries.size(), total / megabyte);
+
+        // least recently used first
+        std::sort(c.entries.begin(), c.entries.end(), [](auto&& a, auto&& b) {
+            return a.last_used < b.last_used;
+        });
+
+        const auto now = system_clock::now();
+        std::vector<entry> remaining;
+
+        // age
+        for (auto&& e : c.entries) {
+            const auto age = duration_cast<days>(now - e.last_used);
+
+            if (!e.kept && c.max_age.count() > 0 && now - e.last_used > c.max_age &&
+                evict(c, e, std::format("unused for {} days", age.count()))) {
+                total -= e.size;
+            }
+            else {
+                remaining.push_back(e);
+            }
+        }
+
+        if (c.max_size == 0 || total <= c.max_size)
+            return;
+
+        // size
+        for (auto&& e : remaining) {
+            if (total <= c.max_size)
+                break;
+
+            if (e.kept)
+                continue;
+
+            if (evict(c, e, std::format("{} over budget", c.name)))
+                total -= e.size;
+        }
+
+        if (total > c.max_size) {
+            gcx().warning(context::generic,
+                          "gc: {} is still {} MB over budget, the rest is in use by "
+                          "tasks or has changes",
+                          c.name, (total - c.max_size) / megabyte);
+        }
+    }
+
+    bool garbage_collector::evict(const category& c, const entry& e,
+                                  std::string_view why)
+    {
+        for (auto&& wt : e.working_trees) {
+            if (!can_delete_working_tree(wt)) {
+                gcx().warning(context::fs, "gc: not deleting {}, {}", e.path, why);
+                return false;
+            }
+        }
+
+        gcx().info(context::fs, "gc: deleting {} ({} MB), {}", e.path,
+                   e.size / megabyte, why);
+
+        // worktrees are removed through git so their repo forgets about them
+        for (auto&& wt : e.working_trees)
+            remove_worktree(wt);
+
+        const auto flags = (c.unsafe ? op::unsafe : op::noflags) | op::optional;
+
+        if (fs::is_directory(e.path))
+            op::delete_directory(gcx(), e.path, flags);
+        else
+            op::delete_file(gcx(), e.path, flags);
+
+        if (!conf().global().dry())
+            access_log::instance().forget(e.path);
+
+        freed_ += e.size;
+        return true;
+    }
+
+    bool garbage_collector::can_delete_working_tree(const fs::path& wt) const
+    {
+        git_wrap g(wt);
+
+        if (g.has_uncommitted_changes()) {
+            gcx().warning(context::fs, "gc: {} has uncommitted changes", wt);
+            return false;
+        }
+
+        if (g.has_stashed_changes()) {
+            gcx().warning(context::fs, "gc: {} has stashed changes", wt);
+            return false;
+        }
+
+        // other worktrees of this repo would be left without their objects
+        std::error_code ec;
+        const auto worktrees = wt / ".git" / "worktrees";
+
+        if (fs::is_directory(worktrees, ec) && !fs::is_empty(worktrees, ec)) {
+            gcx().warning(context::fs, "gc: {} has worktrees", wt);
+            return false;
+        }
+
+        return true;
+    }
+
+    void garbage_collector::remove_worktree(const fs::path& wt) const
+    {
+        // a worktree has a .git file with "gitdir: repo/.git/worktrees/name"
+        const auto dot_git = wt / ".git";
+        if (!fs::is_regular_file(dot_git))
+            return;
+
+        const std::string s =
+            op::read_text_file(gcx(), encodings::utf8, dot_git, op::optional);
+
+        constexpr std::string_view prefix = "gitdir:";
+        if (!s.starts_with(prefix))
+            return;
+
+        auto gitdir = fs::path(utf8_to_utf16(trim_copy(s.substr(prefix.size()))));
+        if (gitdir.is_relative())
+            gitdir = (wt / gitdir).lexically_normal();
+
+        // submodules also have a .git file, but it points to .git/modules
+        if (gitdir.parent_path().filename() != "worktrees")
+            return;
+
+        const auto repo = gitdir.parent_path().parent_path().parent_path();
+
+        // the repo is gone, the directory is deleted normally
+        if (!fs::exists(repo / ".git"))
+            return;
+
+        gcx().trace(context::fs, "gc: removing worktree {} from {}", wt, repo);
+        git_wrap(repo).remove_worktree(wt);
+    }
+
+}  // namespace mob
@@ -0,0 +1,149 @@
+#pragma once
+
+namespace mob {
+
+    // remembers when mob last used cached downloads, build trees and releases,
+    // used by the garbage collector to evict the least recently used ones;
+    // singleton
+    //
+    // file access times are unreliable on windows, they're often disabled, and
+    // anything that walks the prefix (antivirus, indexers) updates them anyway,
+    // so mob records uses itself in a json file in the prefix, which is loaded on
+    // demand and saved by the commands that touch things
+    //
+    class access_log {
+    public:
+        using time_point = std::chrono::system_clock::time_point;
+
+        static access_log& instance();
+
+        // records that the given file or directory was used now
+        //
+        void touch(const fs::path& p);
+
+        // returns the last time the given path, or anything inside it, was used;
+        // returns an empty optional if it was never recorded
+        //
+        std::optional<time_point> last_used(const fs::path& p);
+
+        // forgets about the given path and everything inside it, called when
+        // it's deleted
+        //
+        void forget(const fs::path& p);
+
+        // writes the log to the prefix if anything changed; does nothing in dry
+        // mode
+        //
+        void save();
+
+        // path to the log file, prefix/mob_access.json
+        //
+        static fs::path file();
+
+    private:
+        // normalized path -> seconds since epoch
+        std::map<std::string, std::int64_t, std::less<>> entries_;
+        bool loaded_ = false;
+        bool dirty_  = false;
+        std::mutex mutex_;
+
+        // reads the log file if it hasn't been loaded yet; mutex must be locked
+        //
+        void load();
+    };
+
+    // deletes old and unused downloads, build trees, releases and temporary
+    // files depending on the budgets in [gc]
+    //
+    // within each category, entries older than the age budget are deleted first,
+    // then the least recently used ones until the total size is within the size
+    // budget; the age comes from the access log, entries that were never
+    // recorded are recorded as used now
+    //
+    // anything still referenced by a task, enabled or not (see
+    // task::get_kept_paths()), is never deleted, but still counts towards the
+    // size budget; neither are git working trees with uncommitted or stashed
+    // changes, and worktrees are removed with `git worktree remove`
+    //
+    class garbage_collector {
+    public:
+        garbage_collector();
+
+        // checks all the categories and deletes what's over budget
+        //
+        void run();
+
+        // total size of what was deleted, or would have been in dry mode
+        //
+        std::uintmax_t freed() const;
+
+    private:
+        // a file or directory that can be deleted
+        struct entry {
+            fs::path path;
+            std::uintmax_t size = 0;
+            access_log::time_point last_used;
+            bool kept = false;
+
+            // directories with a .git inside the entry, or the entry itself
+            std::vector<fs::path> working_trees;
+        };
+
+        // a set of entries with the same budgets
+        struct category {
+            std::string name;
+            std::vector<entry> entries;
+
+            // in bytes, 0 for no limit
+            std::uintmax_t max_size = 0;
+
+            // 0 for no limit
+            std::chrono::hours max_age{0};
+
+            // needed to delete things in the cache if it's outside the prefix
+            bool unsafe = false;
+        };
+
+        // paths that must not be deleted
+        std::vector<fs::path> kept_;
+
+        std::uintmax_t freed_ = 0;
+
+        // fills kept_ with the paths of all tasks
+        //
+        void find_kept();
+
+        // whether the given path is or contains a kept path, or is inside one
+        //
+        bool is_kept(const fs::path& p) const;
+
+        // creates an entry for the given path, calculating its size
+        //
+        entry make_entry(const fs::path& p) const;
+
+        category downloads() const;
+        category builds() const;
+        category releases() const;
+        category temp() const;
+
+        // deletes what's over budget in the given category
+        //
+        void collect(category& c);
+
+        // deletes the given entry and removes it from the access log; returns
+        // false if one of its working trees can't be deleted
+        //
+        bool evict(const category& c, const entry& e, std::string_view why);
+
+        // whether the given working tree has no uncommitted or stashed changes
+        // and no worktrees that depend on it
+        //
+        bool can_delete_working_tree(const fs::path& wt) const;
+
+        // runs `git worktree remove` in the repo of the given working tree if
+        // it's a worktree and the repo still exists
+        //
+        void remove_worktree(const fs::path& wt) const;
+    };
+
+}  // namespace mob
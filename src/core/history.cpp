@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "history.h"
+#include "conf.h"
+#include "context.h"
+#include "op.h"
+
+namespace mob {
+
+    // weight of the newest run in the moving average, older runs fade out
+    // quickly because build times change a lot when projects are added or when
+    // the machine changes
+    //
+    constexpr double history_weight = 0.3;
+
+    phase_history& phase_history::instance()
+    {
+        static phase_history h;
+        return h;
+    }
+
+    fs::path phase_history::file()
+    {
+        return conf().path().prefix() / "mob_history.json";
+    }
+
+    void phase_history::record(const std::string& task, std::string_view phase,
+                               std::chrono::nanoseconds d)
+    {
+        using namespace std::chrono;
+
+        std::scoped_lock lock(mutex_);
+        load();
+
+        const auto ms = duration_cast<milliseconds>(d);
+
+        auto& phases = entries_[task];
+        auto itor    = phases.find(phase);
+
+        if (itor == phases.end())
+            itor = phases.emplace(std::string(phase), entry()).first;
+
+        auto& e = itor->second;
+
+        if (e.runs == 0) {
+            e.average = ms;
+        }
+        else {
+            e.average = milliseconds(static_cast<milliseconds::rep>(
+                history_weight * static_cast<double>(ms.count()) +
+                (1.0 - history_weight) * static_cast<double>(e.average.count())));
+        }
+
+        e.last = ms;
+        ++e.runs;
+
+        dirty_ = true;
+    }
+
+    std::optional<std::chrono::milliseconds>
+    phase_history::estimate(const std::string& task, std::string_view phase)
+    {
+        std::scoped_lock lock(mutex_);
+        load();
+
+        auto titor = entries_.find(task);
+        if (titor == entries_.end())
+            return {};
+
+        auto pitor = titor->second.find(phase);
+        if (pitor == titor->second.end())
+            return {};
+
+        return pitor->second.average;
+    }
+
+    void phase_history::load()
+    {
+        if (loaded_)
+            return;
+
+        loaded_ = true;
+
+        const auto p = file();
+        if (!fs::exists(p))
+            return;
+
+        const std::string s =
+            op::read_text_file(gcx(), encodings::utf8, p, op::optional);
+
+        // a broken history file is not worth failing over, it'll be overwritten
+        // next time
+        const auto json = nlohmann::json::parse(s, nullptr, false);
+        if (json.is_discarded() || !json.is_object()) {
+            gcx().warning(context::generic, "bad history file {}, ignoring", p);
+            return;
+        }
+
+        for (auto&& [task, phases] : json.items()) {
+            if (!phases.is_object())
+                continue;
+
+            for (auto&& [phase, v] : phases.items()) {
+                if (!v.is_object())
+                    continue;
+
+                entry e;
+                e.last    = std::chrono::milliseconds(v.value("last_ms", 0ll));
+                e.average = std::chrono::milliseconds(v.value("average_ms", 0ll));
+                e.runs    = v.value("runs", std::size_t(0));
+
+                entries_[task][phase] = e;
+            }
+        }
+    }
+
+    void phase_history::save()
+    {
+        std::scoped_lock lock(mutex_);
+
+        if (!dirty_ || conf().global().dry())
+            return;
+
+        nlohmann::json json = nlohmann::json::object();
+
+        for (auto&& [task, phases] : entries_) {
+            for (auto&& [phase, e] : phases) {
+                json[task][phase] = {{"last_ms", e.last.count()},
+                                     {"average_ms", e.average.count()},
+                                     {"runs", e.runs}};
+            }
+        }
+
+        op::write_text_file(gcx(), encodings::utf8, file(), json.dump(2),
+                            op::optional);
+
+        dirty_ = false;
+    }
+
+}  // namespace mob
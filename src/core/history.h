@@ -0,0 +1,64 @@
+#pragma once
+
+namespace mob {
+
+    // remembers how long each phase of each task took in previous runs, used to
+    // estimate durations in `build --plan`; singleton
+    //
+    // the history is a json file in the prefix, it's loaded on demand and saved
+    // by the build command once all tasks have run
+    //
+    class phase_history {
+    public:
+        static phase_history& instance();
+
+        // records the duration of a phase for the given task; phases that were
+        // skipped should not be recorded
+        //
+        void record(const std::string& task, std::string_view phase,
+                    std::chrono::nanoseconds d);
+
+        // returns the estimated duration of the given phase for the task, or an
+        // empty optional if the phase never ran
+        //
+        std::optional<std::chrono::milliseconds>
+        estimate(const std::string& task, std::string_view phase);
+
+        // writes the history to the prefix if anything was recorded; does nothing
+        // in dry mode
+        //
+        void save();
+
+        // path to the history file, prefix/mob_history.json
+        //
+        static fs::path file();
+
+    private:
+        // stats for one phase
+        struct entry {
+            // duration of the last run
+            std::chrono::milliseconds last{0};
+
+            // exponential moving average of all the runs, used for estimates
+            std::chrono::milliseconds average{0};
+
+            // number of times this phase was recorded
+            std::size_t runs = 0;
+        };
+
+        // task name -> phase name -> stats
+        using map = std::map<std::string, std::map<std::string, entry, std::less<>>,
+                             std::less<>>;
+
+        map entries_;
+        bool loaded_ = false;
+        bool dirty_  = false;
+        mutable std::mutex mutex_;
+
+        // reads the history file if it hasn't been loaded yet; mutex must be
+        // locked
+        //
+        void load();
+    };
+
+}  // namespace mob
@@ -39,6 +39,11 @@ namespace mob {
         return "mob.ini";
     }
 
+    std::string bench_ini_filename()
+    {
+        return "mob-bench.ini";
+    }
+
     std::vector<fs::path>
     find_inis(bool auto_detect, const std::vector<std::string>& from_cl, bool verbose)
     {
@@ -115,15 +120,26 @@ namespace mob {
             auto cwd = fs::current_path();
 
             while (!cwd.empty()) {
-                const auto in_cwd = cwd / default_ini_filename();
-
-                if (fs::exists(in_cwd) && !ini_already_found(in_cwd)) {
-                    if (verbose)
-                        u8cout << "also found in cwd " << path_to_utf8(in_cwd) << "\n";
+                bool found = false;
+
+                // the ini written by `bench-env` goes next to the one in the
+                // current directory, like the prefix ini, and overrides it
+                for (auto&& name : {default_ini_filename(), bench_ini_filename()}) {
+                    const auto in_cwd = cwd / name;
+
+                    if (fs::exists(in_cwd) && !ini_already_found(in_cwd)) {
+                        if (verbose) {
+                            u8cout << "also found in cwd " << path_to_utf8(in_cwd)
+                                   << "\n";
+                        }
+
+                        v.push_back({"cwd", fs::canonical(in_cwd)});
+                        found = true;
+                    }
+                }
 
-                    v.push_back({"cwd", fs::canonical(in_cwd)});
+                if (found)
                     break;
-                }
 
                 const auto parent = cwd.parent_path();
                 if (cwd == parent)
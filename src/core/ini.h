@@ -4,6 +4,11 @@ namespace mob {
 
     std::string default_ini_filename();
 
+    // the ini written by `bench-env`, picked up from the current directory
+    // after default_ini_filename()
+    //
+    std::string bench_ini_filename();
+
     std::vector<fs::path>
     find_inis(bool auto_detect, const std::vector<std::string>& from_cl, bool verbose);
 
@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "metrics.h"
+#include "../utility.h"
+#include "../utility/threading.h"
+#include "conf.h"
+#include "context.h"
+#include "op.h"
+
+namespace mob {
+
+    // a metric that can be given to run_metrics::add() or set()
+    //
+    struct metric_info {
+        const char* name;
+        const char* type;
+        const char* help;
+    };
+
+    // every metric in the textfile, in this order
+    //
+    // counters end with _total, as expected by prometheus
+    //
+    constexpr metric_info known_metrics[] = {
+        {"mob_phase_duration_seconds", "gauge",
+         "duration of the last run of a task phase"},
+
+        {"mob_processes_total", "counter", "processes created by a task"},
+
+        {"mob_process_cpu_seconds_total", "counter",
+         "cpu time used by the processes of a task and all their children"},
+
+        {"mob_cache_lookups_total", "counter",
+         "lookups in a cache, by result; downloads are archives found in the "
+         "download cache, git_pull are pulls skipped because the repo was "
+         "already up to date and configure are cmake runs skipped because "
+         "nothing changed"},
+
+        {"mob_download_bytes_total", "counter", "bytes downloaded from a host"},
+
+        {"mob_downloads_total", "counter", "transfers from a host, by result"},
+
+        {"mob_download_retries_total", "counter",
+         "downloads that had to fall back to another mirror"},
+
+        {"mob_task_failures_total", "counter", "tasks that bailed out"},
+
+        {"mob_cancel_latency_seconds", "gauge",
+         "time between an interruption and all tasks having stopped"},
+
+        {"mob_startup_seconds", "gauge",
+         "time between mob starting and the command running, mostly loading "
+         "options"}};
+
+    // returns the metric with the given name, bails out if it's not known
+    //
+    const metric_info& find_metric(std::string_view name)
+    {
+        for (auto&& m : known_metrics) {
+            if (name == m.name)
+                return m;
+        }
+
+        gcx().bail_out(context::generic, "unknown metric {}", name);
+    }
+
+    // formats the given labels as {a="b",c="d"}, escaping values
+    //
+    std::string format_labels(const run_metrics::labels& ls)
+    {
+        if (ls.empty())
+            return {};
+
+        std::string s = "{";
+
+        for (auto&& [name, value] : ls) {
+            if (s.size() > 1)
+                s += ",";
+
+            s += name + "=\"";
+
+            for (const char c : value) {
+                if (c == '\\')
+                    s += "\\\\";
+                else if (c == '"')
+                    s += "\\\"";
+                else if (c == '\n')
+                    s += "\\n";
+                else
+                    s += c;
+            }
+
+            s += "\"";
+        }
+
+        return s + "}";
+    }
+
+    // metrics files are relative to the prefix, like the log file
+    //
+    fs::path metrics_path(std::string_view key)
+    {
+        fs::path p = conf().global().get(key);
+
+        if (!p.empty() && p.is_relative())
+            p = conf().path().prefix() / p;
+
+        return p;
+    }
+
+    run_metrics& run_metrics::instance()
+    {
+        static run_metrics m;
+        return m;
+    }
+
+    void run_metrics::add_process()
+    {
+        ++processes_;
+    }
+
+    void run_metrics::add_log_bytes(std::size_t n)
+    {
+        log_bytes_ += n;
+    }
+
+    std::size_t run_metrics::processes() const
+    {
+        return processes_;
+    }
+
+    std::uint64_t run_metrics::log_bytes() const
+    {
+        return log_bytes_;
+    }
+
+    std::uint64_t run_metrics::peak_memory()
+    {
+        PROCESS_MEMORY_COUNTERS pmc = {};
+        pmc.cb                      = sizeof(pmc);
+
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+            return 0;
+
+        return pmc.PeakWorkingSetSize;
+    }
+
+    void run_metrics::add(std::string_view name, const labels& ls, double v)
+    {
+        update(name, ls, v, false);
+    }
+
+    void run_metrics::set(std::string_view name, const labels& ls, double v)
+    {
+        update(name, ls, v, true);
+    }
+
+    void run_metrics::update(std::string_view name, const labels& ls, double v,
+                             bool replace)
+    {
+        const auto& m = find_metric(name);
+        const auto k  = format_labels(ls);
+
+        std::scoped_lock lock(mutex_);
+
+        auto& values = metrics_[m.name];
+
+        if (replace)
+            values[k] = v;
+        else
+            values[k] += v;
+    }
+
+    void run_metrics::start()
+    {
+        const auto interval = conf().global().get<int>("metrics_interval");
+
+        if (interval <= 0 || metrics_path("metrics_textfile").empty())
+            return;
+
+        thread_ = start_thread([this, interval] {
+            std::unique_lock lock(thread_mutex_);
+
+            for (;;) {
+                cv_.wait_for(lock, std::chrono::seconds(interval), [&] {
+                    return stop_;
+                });
+
+                if (stop_)
+                    break;
+
+                write_textfile({});
+            }
+        });
+    }
+
+    void run_metrics::save(int exit_code)
+    {
+        if (thread_.joinable()) {
+            {
+                std::scoped_lock lock(thread_mutex_);
+                stop_ = true;
+            }
+
+            cv_.notify_one();
+            thread_.join();
+        }
+
+        write_json(exit_code);
+        write_textfile(exit_code);
+    }
+
+    std::string run_metrics::make_textfile(std::optional<int> exit_code) const
+    {
+        using namespace std::chrono;
+
+        std::string s;
+
+        auto add_metric = [&](const char* name, const char* type, const char* help,
+                              const values& vs) {
+            s += std::format("# HELP {} {}\n", name, help);
+            s += std::format("# TYPE {} {}\n", name, type);
+
+            for (auto&& [ls, v] : vs)
+                s += std::format("{}{} {}\n", name, ls, v);
+        };
+
+        // about mob itself, always there
+        const double elapsed = duration_cast<duration<double>>(timestamp()).count();
+
+        add_metric("mob_run_duration_seconds", "gauge",
+                   "time since mob started", {{"", elapsed}});
+
+        add_metric("mob_peak_memory_bytes", "gauge",
+                   "peak working set of mob itself",
+                   {{"", static_cast<double>(peak_memory())}});
+
+        add_metric("mob_log_bytes_total", "counter",
+                   "bytes written to the console and the log file",
+                   {{"", static_cast<double>(log_bytes())}});
+
+        if (exit_code) {
+            add_metric("mob_exit_code", "gauge", "exit code of the last command",
+                       {{"", static_cast<double>(*exit_code)}});
+        }
+
+        std::scoped_lock lock(mutex_);
+
+        for (auto&& m : known_metrics) {
+            auto itor = metrics_.find(m.name);
+            if (itor != metrics_.end())
+                add_metric(m.name, m.type, m.help, itor->second);
+        }
+
+        return s;
+    }
+
+    void run_metrics::write_textfile(std::optional<int> exit_code)
+    {
+        const auto p = metrics_path("metrics_textfile");
+        if (p.empty())
+            return;
+
+        // write_text_file() renames a temporary file, so the collector never
+        // sees a partial file
+        try {
+            op::write_text_file(gcx(), encodings::utf8, p, make_textfile(exit_code),
+                                op::unsafe);
+        }
+        catch (bailed&) {
+            // already logged, and the command's result is more important
+            gcx().warning(context::generic, "failed to write metrics to {}", p);
+        }
+    }
+
+    void run_metrics::write_json(int exit_code)
+    {
+        const auto p = metrics_path("metrics_file");
+        if (p.empty())
+            return;
+
+        using namespace std::chrono;
+
+        nlohmann::json json;
+
+        json["version"]     = mob_version();
+        json["exit_code"]   = exit_code;
+        json["wall_ms"]     = duration_cast<milliseconds>(timestamp()).count();
+        json["processes"]   = processes();
+        json["log_bytes"]   = log_bytes();
+        json["peak_memory"] = peak_memory();
+
+        try {
+            op::write_text_file(gcx(), encodings::utf8, p, json.dump(2), op::unsafe);
+        }
+        catch (bailed&) {
+            // already logged, and the command's result is more important
+            gcx().warning(context::generic, "failed to write metrics to {}", p);
+        }
+    }
+
+}  // namespace mob
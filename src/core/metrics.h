@@ -0,0 +1,105 @@
+#pragma once
+
+namespace mob {
+
+    // counters about mob itself for the whole run
+    //
+    // they're written as json to `[global] metrics_file` when the command
+    // finishes, which is meant to compare mob's own overhead between versions by
+    // running the same builds (cold, no-op, a single task changed, etc.) and
+    // diffing the files
+    //
+    // build metrics (phase durations, processes, cache hits, downloads,
+    // failures) are also kept in a small registry and written in the prometheus
+    // text format to `[global] metrics_textfile`, which can be picked up by
+    // node_exporter's textfile collector; it's written when the command finishes
+    // and every `metrics_interval` seconds while it runs
+    //
+    // singleton
+    //
+    class run_metrics {
+    public:
+        // label names and values
+        using labels = std::vector<std::pair<std::string, std::string>>;
+
+        static run_metrics& instance();
+
+        // called every time a process is created, see process::do_run()
+        //
+        void add_process();
+
+        // called with the number of bytes written to the console or the log
+        // file, see context::emit_log()
+        //
+        void add_log_bytes(std::size_t n);
+
+        // number of processes created so far
+        //
+        std::size_t processes() const;
+
+        // bytes logged so far
+        //
+        std::uint64_t log_bytes() const;
+
+        // peak working set of mob itself, 0 on error
+        //
+        static std::uint64_t peak_memory();
+
+        // adds `v` to a counter, `name` must be one of the metrics in
+        // metrics.cpp; thread-safe
+        //
+        void add(std::string_view name, const labels& ls = {}, double v = 1);
+
+        // sets a gauge, `name` must be one of the metrics in metrics.cpp;
+        // thread-safe
+        //
+        void set(std::string_view name, const labels& ls, double v);
+
+        // starts a thread that writes the textfile every `metrics_interval`
+        // seconds, does nothing if it's 0 or if there's no textfile
+        //
+        void start();
+
+        // stops the thread, writes the metrics to `metrics_file` and
+        // `metrics_textfile` if they're not empty; never throws, failing to
+        // write the files is only a warning
+        //
+        void save(int exit_code);
+
+    private:
+        // values of one metric, keyed on the formatted labels
+        using values = std::map<std::string, double, std::less<>>;
+
+        std::atomic<std::size_t> processes_{0};
+        std::atomic<std::uint64_t> log_bytes_{0};
+
+        // metric name -> values
+        std::map<std::string, values, std::less<>> metrics_;
+        mutable std::mutex mutex_;
+
+        // periodic writes
+        std::thread thread_;
+        std::condition_variable cv_;
+        std::mutex thread_mutex_;
+        bool stop_ = false;
+
+        // adds or sets the value depending on `replace`
+        //
+        void update(std::string_view name, const labels& ls, double v,
+                    bool replace);
+
+        // formats the registry in the prometheus text format, `exit_code` is
+        // only included if it's set
+        //
+        std::string make_textfile(std::optional<int> exit_code) const;
+
+        // writes the textfile, if any
+        //
+        void write_textfile(std::optional<int> exit_code);
+
+        // writes the json file, if any
+        //
+        void write_json(int exit_code);
+    };
+
+}  // namespace mob
@@ -383,44 +383,129 @@ namespace mob::op {
         op::rename(cx, dest, src);
     }
 
-    std::string read_text_file_impl(const context& cx, const fs::path& p, flags f)
+    // maps the file, returns false if it couldn't be mapped and `f` is optional,
+    // bails out otherwise
+    //
+    bool map_text_file(const context& cx, const fs::path& p, mapped_file& mf,
+                       flags f)
     {
         cx.trace(context::fs, "reading {}", p);
 
-        std::string s;
-        std::ifstream in(p, std::ios::binary);
+        DWORD e = 0;
+        if (!mf.open(p, e)) {
+            if (f & optional) {
+                cx.debug(context::fs, "can't read from {} (optional), {}", p,
+                         error_message(e));
 
-        in.seekg(0, std::ios::end);
-        s.resize(static_cast<std::size_t>(in.tellg()));
-        in.seekg(0, std::ios::beg);
-        in.read(&s[0], static_cast<std::streamsize>(s.size()));
+                return false;
+            }
 
-        if (in.bad()) {
-            if (f & optional)
-                cx.debug(context::fs, "can't read from {} (optional)", p);
-            else
-                cx.bail_out(context::fs, "can't read from {}", p);
+            cx.bail_out(context::fs, "can't read from {}, {}", p, error_message(e));
         }
-        else {
-            cx.trace(context::fs, "finished reading {}, {} bytes", p, s.size());
+
+        cx.trace(context::fs, "mapped {}, {} bytes", p, mf.bytes().size());
+        return true;
+    }
+
+    // appends `s` to `out`, dropping the \r of every \r\n
+    //
+    void append_without_cr(std::string& out, std::string_view s)
+    {
+        out.reserve(out.size() + s.size());
+
+        std::size_t start = 0;
+
+        for (;;) {
+            const auto cr = s.find("\r\n", start);
+
+            if (cr == std::string_view::npos) {
+                out.append(s.substr(start));
+                break;
+            }
+
+            out.append(s.substr(start, cr - start));
+            start = cr + 1;
+        }
+    }
+
+    // removes the \r of every \r\n in place
+    //
+    void remove_cr(std::string& s)
+    {
+        std::size_t out = 0;
+
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            if (s[i] == '\r' && i + 1 < s.size() && s[i + 1] == '\n')
+                continue;
+
+            s[out++] = s[i];
         }
 
-        return s;
+        s.resize(out);
     }
 
     std::string read_text_file(const context& cx, encodings e, const fs::path& p,
                                flags f)
     {
-        std::string bytes = read_text_file_impl(cx, p, f);
+        mapped_file mf;
+        if (!map_text_file(cx, p, mf, f))
+            return {};
+
+        const std::string_view bytes = mf.bytes();
         if (bytes.empty())
-            return bytes;
+            return {};
+
+        std::string utf8;
+
+        switch (e) {
+        case encodings::utf8:
+        case encodings::dont_know: {
+            // straight from the mapped view
+            append_without_cr(utf8, bytes);
+            break;
+        }
 
-        std::string utf8 = bytes_to_utf8(e, bytes);
-        utf8             = replace_all(utf8, "\r\n", "\n");
+        case encodings::utf16:
+        case encodings::acp:
+        case encodings::oem:
+        default: {
+            // the conversion needs its own buffer anyway, newlines are fixed
+            // in place
+            utf8 = bytes_to_utf8(e, bytes);
+            remove_cr(utf8);
+            break;
+        }
+        }
 
         return utf8;
     }
 
+    void read_text_lines(const context& cx, encodings e, const fs::path& p,
+                         const std::function<void(std::string_view)>& line_fun,
+                         flags f)
+    {
+        mapped_file mf;
+        if (!map_text_file(cx, p, mf, f))
+            return;
+
+        switch (e) {
+        case encodings::utf8:
+        case encodings::dont_know: {
+            for_each_line(mf.bytes(), line_fun);
+            break;
+        }
+
+        case encodings::utf16:
+        case encodings::acp:
+        case encodings::oem:
+        default: {
+            const std::string utf8 = bytes_to_utf8(e, mf.bytes());
+            for_each_line(utf8, line_fun);
+            break;
+        }
+        }
+    }
+
     void write_text_file(const context& cx, encodings e, const fs::path& p,
                          std::string_view utf8, flags f)
     {
@@ -432,21 +517,68 @@ namespace mob::op {
         if (conf().global().dry())
             return;
 
+        // written next to the file so the rename below stays on the same volume;
+        // GetTempFileName() creates an empty file with a unique name, so
+        // concurrent writes to the same file don't share a temporary file
+        const auto dir = (p.has_parent_path() ? p.parent_path() : fs::path("."));
+        wchar_t tmp_name[MAX_PATH + 1] = {};
+
+        if (::GetTempFileNameW(dir.native().c_str(), L"mob", 0, tmp_name) == 0) {
+            const auto e = GetLastError();
+
+            if (f & optional) {
+                cx.debug(context::fs, "can't create temp file for {} (optional), {}",
+                         p, error_message(e));
+                return;
+            }
+
+            cx.bail_out(context::fs, "can't create temp file for {}, {}", p,
+                        error_message(e));
+        }
+
+        const fs::path tmp = tmp_name;
+
+        auto failed = [&](std::string_view what, DWORD err) {
+            ::DeleteFileW(tmp.native().c_str());
+
+            if (f & optional)
+                cx.debug(context::fs, "can't {} {} (optional), {}", what, p,
+                         error_message(err));
+            else
+                cx.bail_out(context::fs, "can't {} {}, {}", what, p,
+                            error_message(err));
+        };
+
         {
-            std::ofstream out(p, std::ios::binary);
-            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
-            out.close();
+            handle_ptr h(::CreateFileW(tmp.native().c_str(), GENERIC_WRITE, 0,
+                                       nullptr, CREATE_ALWAYS,
+                                       FILE_ATTRIBUTE_NORMAL, nullptr));
 
-            if (out.bad()) {
-                if (f & optional) {
-                    cx.debug(context::fs, "can't write to {} (optional)", p);
-                }
-                else {
-                    cx.bail_out(context::fs, "can't write to {}", p);
-                }
+            if (h.get() == INVALID_HANDLE_VALUE)
+                return failed("write to", GetLastError());
+
+            DWORD written = 0;
+            const auto r  = ::WriteFile(h.get(), bytes.data(),
+                                        static_cast<DWORD>(bytes.size()), &written,
+                                        nullptr);
+
+            if (!r || written != bytes.size()) {
+                const auto err = GetLastError();
+
+                // the temporary file can't be deleted while it's still open
+                h.reset();
+
+                return failed("write to", err);
             }
         }
 
+        const auto r =
+            ::MoveFileExW(tmp.native().c_str(), p.native().c_str(),
+                          MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+
+        if (!r)
+            return failed("replace", GetLastError());
+
         cx.trace(context::fs, "finished writing {} bytes to {}", bytes.size(), p);
     }
 
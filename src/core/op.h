@@ -109,14 +109,30 @@ namespace mob::op {
                       const fs::path& backup = {}, flags f = noflags);
 
     // reads the given file, converts it to utf8 from the given encoding, returns
-    // the utf8 string; if `e` is `dont_know`, returns the bytes as-is
+    // the utf8 string with \r\n converted to \n; if `e` is `dont_know`, the
+    // bytes are not converted
+    //
+    // the file is mapped in memory and converted in a single pass
     //
     std::string read_text_file(const context& cx, encodings e, const fs::path& p,
                                flags f = noflags);
 
+    // maps the given file in memory and calls `line_fun` for every non-empty line,
+    // see for_each_line()
+    //
+    // for utf8 and dont_know, the lines point directly into the mapped file and
+    // nothing is copied; other encodings are converted to utf8 first
+    //
+    void read_text_lines(const context& cx, encodings e, const fs::path& p,
+                         const std::function<void(std::string_view)>& line_fun,
+                         flags f = noflags);
+
     // creates file `p`, writes the given utf8 string into it, converting the string
     // to the given encoding; if `e` is dont_know, the bytes are written as-is
     //
+    // the string is written to a uniquely named temporary file next to `p`, which
+    // then replaces `p`, so readers never see a partially written file
+    //
     void write_text_file(const context& cx, encodings e, const fs::path& p,
                          std::string_view utf8, flags f = noflags);
 
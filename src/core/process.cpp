@@ -1,8 +1,11 @@
 #include "pch.h"
 #include "process.h"
 #include "../net.h"
+#include "../tasks/plan.h"
+#include "../tasks/task_manager.h"
 #include "conf.h"
 #include "context.h"
+#include "metrics.h"
 #include "op.h"
 #include "pipe.h"
 
@@ -60,7 +63,12 @@ namespace mob {
 
     process::~process()
     {
-        join();
+        try {
+            join();
+        }
+        catch (interrupted&) {
+            // the process is gone, whoever owned it is already unwinding
+        }
     }
 
     process process::raw(const context& cx, const std::string& cmd)
@@ -245,8 +253,12 @@ namespace mob {
         const auto what = make_cmd();
         cx_->debug(context::cmd, "> {}", what);
 
-        if (conf().global().dry())
+        if (conf().global().dry()) {
+            if (build_plan::instance().enabled())
+                build_plan::instance().add_process(cx_->task_name(), what);
+
             return;
+        }
 
         // shouldn't happen
         if (exec_.raw.empty() && exec_.bin.empty())
@@ -424,6 +436,10 @@ namespace mob {
 
         cx_->trace(context::cmd, "pid {}", pi.dwProcessId);
 
+        run_metrics::instance().add_process();
+        run_metrics::instance().add("mob_processes_total",
+                                    {{"task", cx_->task_name()}});
+
         // not needed
         ::CloseHandle(pi.hThread);
 
@@ -471,6 +487,9 @@ namespace mob {
         // remembers if the process was already interrupted
         bool interrupted = false;
 
+        // remembers if the process was killed because it ignored the interruption
+        bool killed = false;
+
         // close the handle quickly after termination
         guard g([&] {
             impl_.handle = {};
@@ -478,16 +497,37 @@ namespace mob {
 
         cx_->trace(context::cmd, "joining");
 
+        // the global cancellation is waited on with the process so interruptions
+        // are handled right away instead of on the next timeout; the event is
+        // never reset, so it's dropped from the wait once it's been seen
+        //
+        // only processes started by tasks are cancelled, anything else runs
+        // outside of the build, possibly after an interruption, and must not be
+        // stopped by it
+        const auto& c         = cancellation::global();
+        const HANDLE events[] = {impl_.handle.get(), c.event()};
+        DWORD event_count     = (cancellable() && c.event() ? 2 : 1);
+
         for (;;) {
-            // returns if the process is done or after the timeout
-            const auto r = WaitForSingleObject(impl_.handle.get(), wait_timeout);
+            // returns if the process is done, if mob was interrupted or after the
+            // timeout
+            const auto r =
+                WaitForMultipleObjects(event_count, events, FALSE, wait_timeout);
 
             if (r == WAIT_OBJECT_0) {
                 on_completed();
                 break;
             }
+            else if (r == WAIT_OBJECT_0 + 1) {
+                event_count     = 1;
+                impl_.interrupt = true;
+                on_timeout(interrupted);
+            }
             else if (r == WAIT_TIMEOUT) {
                 on_timeout(interrupted);
+
+                if (interrupted && !killed)
+                    killed = check_cancel_timeout();
             }
             else {
                 const auto e = GetLastError();
@@ -528,6 +568,8 @@ namespace mob {
     void process::read_pipe(bool finish, stream& s, async_pipe_stdout& pipe,
                             context::reason r)
     {
+        alloc_scope scope(alloc_tag::process);
+
         switch (s.flags) {
         case forward_to_log: {
             // read from the pipe, add the bytes to the buffer
@@ -587,9 +629,12 @@ namespace mob {
     void process::on_completed()
     {
         // none of this stuff is needed if the process was interrupted, mob will
-        // exit shortly
-        if (impl_.interrupt)
-            return;
+        // exit shortly; the output is incomplete and the exit code meaningless,
+        // so the caller must never see this as a successful run
+        if (impl_.interrupt) {
+            cx_->trace(context::cmd, "{} was interrupted", make_name());
+            throw interrupted();
+        }
 
         if (!GetExitCodeProcess(impl_.handle.get(), &exec_.code)) {
             const auto e = GetLastError();
@@ -599,6 +644,8 @@ namespace mob {
             exec_.code = 0xffff;
         }
 
+        record_cpu_time();
+
         // pipes are finicky, or I just don't understand how they work
         //
         // I've seen empty pipes after processes finish even though there was still
@@ -714,6 +761,55 @@ namespace mob {
         return true;
     }
 
+    bool process::check_cancel_timeout()
+    {
+        const auto& c = cancellation::global();
+        if (!cancellable() || !c.cancelled())
+            return false;
+
+        const auto timeout =
+            std::chrono::seconds(conf().global().get<int>("cancel_timeout"));
+
+        if (c.elapsed() < timeout)
+            return false;
+
+        cx_->warning(context::interruption,
+                     "{} still running {}s after interruption, terminating",
+                     make_name(), timeout.count());
+
+        terminate();
+        return true;
+    }
+
+    bool process::cancellable() const
+    {
+        // the global context has no task, it runs commands and gc
+        return !cx_->task_name().empty();
+    }
+
+    void process::record_cpu_time()
+    {
+        if (!impl_.job)
+            return;
+
+        JOBOBJECT_BASIC_ACCOUNTING_INFORMATION info = {};
+
+        const auto r = ::QueryInformationJobObject(
+            impl_.job.get(), JobObjectBasicAccountingInformation, &info,
+            sizeof(info), nullptr);
+
+        if (!r)
+            return;
+
+        // in 100ns units, includes every process in the job, so whatever the
+        // shell started
+        const auto ticks =
+            info.TotalUserTime.QuadPart + info.TotalKernelTime.QuadPart;
+
+        run_metrics::instance().add("mob_process_cpu_seconds_total",
+                                    {{"task", cx_->task_name()}}, ticks / 10000000.0);
+    }
+
     void process::terminate()
     {
         UINT exit_code = 0xff;
@@ -762,18 +858,21 @@ namespace mob {
             return;
         }
 
-        const std::string log = op::read_text_file(*cx_, encodings::dont_know,
-                                                   io_.error_log_file, op::optional);
+        bool first = true;
 
-        if (log.empty())
-            return;
+        op::read_text_lines(
+            *cx_, encodings::dont_know, io_.error_log_file,
+            [&](std::string_view line) {
+                if (first) {
+                    cx_->error(context::cmd, "{} failed, content of {}:", make_name(),
+                               io_.error_log_file);
 
-        cx_->error(context::cmd, "{} failed, content of {}:", make_name(),
-                   io_.error_log_file);
+                    first = false;
+                }
 
-        for_each_line(log, [&](auto&& line) {
-            cx_->error(context::cmd, "        {}", line);
-        });
+                cx_->error(context::cmd, "        {}", line);
+            },
+            op::optional);
     }
 
     void process::dump_stderr() noexcept
@@ -306,7 +306,8 @@ namespace mob {
         void interrupt();
 
         // reads from streams, writes to stdin if needed, monitors for termination,
-        // handles interrupt(); bails out on failure
+        // handles interrupt(); bails out on failure, throws `interrupted` if the
+        // process was interrupted
         //
         void join();
 
@@ -510,6 +511,20 @@ namespace mob {
         //
         bool check_interrupted();
 
+        // whether the process is stopped when mob is interrupted, only true for
+        // processes started by tasks
+        //
+        bool cancellable() const;
+
+        // kills the process and its children if mob was interrupted more than
+        // `cancel_timeout` seconds ago, returns true if it did
+        //
+        bool check_cancel_timeout();
+
+        // adds the cpu time of the process and its children to the metrics
+        //
+        void record_cpu_time();
+
         // forcefully kills the process and its children
         //
         void terminate();
@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "single_flight.h"
+
+namespace mob {
+
+    // every single_flight; they're static so the pointers stay valid, but they
+    // can be constructed during static initialization in any translation unit, so
+    // the list is a function-local static
+    //
+    struct single_flight_instances {
+        std::vector<single_flight_base*> v;
+        std::mutex mutex;
+    };
+
+    single_flight_instances& instances()
+    {
+        static single_flight_instances i;
+        return i;
+    }
+
+    single_flight_base::single_flight_base(std::string name)
+        : name_(std::move(name)), calls_(0), hits_(0)
+    {
+        auto& is = instances();
+
+        std::scoped_lock lock(is.mutex);
+        is.v.push_back(this);
+    }
+
+    void single_flight_base::add_call(const context& cx, const std::string& key,
+                                      bool hit)
+    {
+        ++calls_;
+
+        if (hit) {
+            ++hits_;
+            cx.debug(context::generic, "{}: waiting for {}, already in progress",
+                     name_, key);
+        }
+    }
+
+    void single_flight_base::log_summary()
+    {
+        auto& is = instances();
+
+        std::scoped_lock lock(is.mutex);
+
+        for (auto* sf : is.v) {
+            if (sf->calls_ == 0)
+                continue;
+
+            gcx().debug(context::generic, "single-flight {}: calls={} coalesced={}",
+                        sf->name_, sf->calls_.load(), sf->hits_.load());
+        }
+    }
+
+}  // namespace mob
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "context.h"
+
+namespace mob {
+
+    // counters for a single_flight below, every instance registers itself so the
+    // counters can be logged when mob exits, see log_summary()
+    //
+    class single_flight_base {
+    public:
+        // non-copyable
+        single_flight_base(const single_flight_base&)            = delete;
+        single_flight_base& operator=(const single_flight_base&) = delete;
+
+        // logs how many calls were made to each instance and how many of them
+        // waited on another one instead of running the operation
+        //
+        static void log_summary();
+
+    protected:
+        single_flight_base(std::string name);
+
+        // called once per call to run(), `hit` is true if the call waited on
+        // one that was already in flight
+        //
+        void add_call(const context& cx, const std::string& key, bool hit);
+
+    private:
+        const std::string name_;
+        std::atomic<std::size_t> calls_;
+        std::atomic<std::size_t> hits_;
+    };
+
+    // coalesces concurrent calls for the same key: the first caller runs the
+    // operation and later callers that arrive while it's still running wait for
+    // it and get the same result, or the same exception
+    //
+    // this is for things that parallel tasks can trigger at the same moment, like
+    // downloading the same file or running the same ls-remote; nothing is kept
+    // once the operation is done, callers that want to reuse results must cache
+    // them themselves, typically from within the operation so a call that's late
+    // by a few milliseconds finds it
+    //
+    // instances are meant to be static
+    //
+    template <class T>
+    class single_flight : public single_flight_base {
+    public:
+        single_flight(std::string name) : single_flight_base(std::move(name)) {}
+
+        // calls f() and returns its result, unless another call for the same key
+        // is in progress, in which case this waits for it and returns its result
+        //
+        template <class F>
+        T run(const context& cx, const std::string& key, F&& f)
+        {
+            std::promise<T> promise;
+            std::shared_future<T> future;
+            bool hit = false;
+
+            {
+                std::scoped_lock lock(mutex_);
+
+                auto itor = flights_.find(key);
+
+                if (itor == flights_.end()) {
+                    future = promise.get_future().share();
+                    flights_.emplace(key, future);
+                }
+                else {
+                    future = itor->second;
+                    hit    = true;
+                }
+            }
+
+            add_call(cx, key, hit);
+
+            if (hit)
+                return future.get();
+
+            try {
+                promise.set_value(f());
+            }
+            catch (...) {
+                // bailed and interrupted are forwarded to all the callers
+                promise.set_exception(std::current_exception());
+            }
+
+            {
+                std::scoped_lock lock(mutex_);
+                flights_.erase(key);
+            }
+
+            return future.get();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::map<std::string, std::shared_future<T>> flights_;
+    };
+
+}  // namespace mob
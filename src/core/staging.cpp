@@ -0,0 +1,445 @@
+#include "pch.h"
+#include "staging.h"
+#include "../utility.h"
+#include "conf.h"
+#include "context.h"
+#include "op.h"
+
+namespace mob {
+
+    // extensions of the files created by merge_files()
+    constexpr auto merge_new_ext = L".mob_new";
+    constexpr auto merge_old_ext = L".mob_old";
+
+    // whether both files have the same size and modification time, used to tell
+    // apart conflicts where two tasks install the exact same file
+    //
+    bool same_file(const fs::path& a, const fs::path& b)
+    {
+        std::error_code ec;
+
+        const auto sa = fs::file_size(a, ec);
+        if (ec)
+            return false;
+
+        const auto sb = fs::file_size(b, ec);
+        if (ec || sa != sb)
+            return false;
+
+        const auto ta = fs::last_write_time(a, ec);
+        if (ec)
+            return false;
+
+        const auto tb = fs::last_write_time(b, ec);
+        if (ec)
+            return false;
+
+        return (ta == tb);
+    }
+
+    // file names are stored as utf8
+    //
+    fs::path to_path(std::string_view utf8)
+    {
+        return fs::path(utf8_to_utf16(utf8));
+    }
+
+    install_staging& install_staging::instance()
+    {
+        static install_staging s;
+        return s;
+    }
+
+    fs::path install_staging::path(std::string_view name)
+    {
+        return conf().path().build() / "staging" / name;
+    }
+
+    fs::path install_staging::file()
+    {
+        return conf().path().prefix() / "mob_staging.json";
+    }
+
+    void install_staging::publish(const context& cx, const std::string& name,
+                                  const fs::path& staging, const fs::path& dest)
+    {
+        if (conf().global().dry())
+            return;
+
+        // publishing is fast, doing one stage at a time makes conflicts between
+        // tasks that finish at the same time deterministic
+        std::scoped_lock lock(mutex_);
+        load();
+
+        stage s;
+        s.dest = dest;
+
+        // relative names, sizes and times of every staged file; cmake keeps the
+        // times of the files it installs, so this doesn't change if the build
+        // didn't
+        fingerprint fp;
+
+        if (fs::exists(staging)) {
+            for (auto&& e : fs::recursive_directory_iterator(staging)) {
+                if (!e.is_regular_file())
+                    continue;
+
+                s.files.insert(path_to_utf8(fs::relative(e.path(), staging)));
+            }
+        }
+
+        for (auto&& f : s.files) {
+            const auto p = staging / to_path(f);
+
+            fp.add(f);
+            fp.add(std::to_string(fs::file_size(p)));
+            fp.add(std::to_string(fs::last_write_time(p).time_since_epoch().count()));
+        }
+
+        s.fingerprint = fp.hex();
+
+        auto itor = stages_.find(name);
+
+        if (itor != stages_.end() && itor->second.dest == s.dest &&
+            itor->second.fingerprint == s.fingerprint) {
+            // also make sure nothing was deleted from the install directory
+            const bool all_there =
+                std::all_of(s.files.begin(), s.files.end(), [&](auto&& f) {
+                    return fs::exists(dest / to_path(f));
+                });
+
+            if (all_there) {
+                cx.debug(context::bypass,
+                         "staged install of {} is unchanged, not merging", name);
+
+                return;
+            }
+        }
+
+        check_conflicts(cx, name, s, staging);
+
+        // the staging directory is kept between builds, most files are usually
+        // the same as the ones that were published last time
+        std::vector<std::string> changed;
+
+        for (auto&& f : s.files) {
+            if (!same_file(staging / to_path(f), dest / to_path(f)))
+                changed.push_back(f);
+        }
+
+        cx.debug(context::fs, "merging {} of {} staged files from {} into {}",
+                 changed.size(), s.files.size(), staging, dest);
+
+        merge_files(cx, staging, dest, changed);
+
+        // interrupted before anything was merged, the stage will be merged again
+        // by the next build
+        if (cancellation::global().cancelled())
+            return;
+
+        stages_[name] = std::move(s);
+        save();
+    }
+
+    void install_staging::check_conflicts(const context& cx, const std::string& name,
+                                          const stage& s, const fs::path& staging)
+    {
+        for (auto&& [other_name, other] : stages_) {
+            if (other_name == name || other.dest != s.dest)
+                continue;
+
+            for (auto fitor = other.files.begin(); fitor != other.files.end();) {
+                if (!s.files.contains(*fitor)) {
+                    ++fitor;
+                    continue;
+                }
+
+                const auto rel = to_path(*fitor);
+
+                if (same_file(staging / rel, s.dest / rel)) {
+                    cx.debug(context::fs,
+                             "{} is installed by both {} and {}, same file", *fitor,
+                             other_name, name);
+                }
+                else {
+                    cx.warning(context::fs,
+                               "conflict: {} is installed by both {} and {}, "
+                               "using the one from {}",
+                               *fitor, other_name, name, name);
+                }
+
+                // the file belongs to this stage now
+                fitor = other.files.erase(fitor);
+            }
+        }
+    }
+
+    void install_staging::merge_files(const context& cx, const fs::path& staging,
+                                      const fs::path& dest,
+                                      const std::vector<std::string>& files)
+    {
+        // unique for this merge, an old file from a previous merge that's still
+        // in use can't be replaced
+        const auto token =
+            std::format("{}-{}", GetCurrentProcessId(), GetTickCount64());
+
+        // next to the destination so the renames stay on the same volume
+        const auto new_path = [&](const std::string& f) {
+            auto p = dest / to_path(f);
+            p += merge_new_ext;
+            return p;
+        };
+
+        const auto old_path = [&](const std::string& f) {
+            auto p = dest / to_path(f + "." + token);
+            p += merge_old_ext;
+            return p;
+        };
+
+        const auto delete_new = [&] {
+            for (auto&& f : files)
+                ::DeleteFileW(new_path(f).native().c_str());
+        };
+
+        // directories are created first, copies fail if the parent is missing
+        std::set<fs::path> dirs;
+        for (auto&& f : files)
+            dirs.insert((dest / to_path(f)).parent_path());
+
+        for (auto&& d : dirs) {
+            op::create_directories(cx, d, op::unsafe);
+            delete_old_files(cx, d);
+        }
+
+        // split the copies between threads
+        const std::size_t threads =
+            std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+        std::vector<std::vector<const std::string*>> chunks(threads);
+
+        std::size_t i = 0;
+        for (auto&& f : files)
+            chunks[i++ % threads].push_back(&f);
+
+        std::mutex errors_mutex;
+        std::vector<std::string> errors;
+        std::atomic<std::size_t> copied = 0;
+
+        {
+            thread_pool tp(threads);
+
+            for (auto&& chunk : chunks) {
+                if (chunk.empty())
+                    continue;
+
+                tp.add([&, chunk] {
+                    for (const auto* f : chunk) {
+                        const auto src = staging / to_path(*f);
+                        const auto dst = new_path(*f);
+
+                        // keeps the time of the file, see same_file()
+                        if (::CopyFileW(src.native().c_str(), dst.native().c_str(),
+                                        FALSE)) {
+                            ++copied;
+                            continue;
+                        }
+
+                        const auto e = GetLastError();
+
+                        std::scoped_lock lock(errors_mutex);
+                        errors.push_back(std::format("{}, {}", dst, error_message(e)));
+                    }
+                });
+            }
+        }
+
+        if (!errors.empty()) {
+            delete_new();
+
+            for (auto&& e : errors)
+                cx.error(context::fs, "failed to install {}", e);
+
+            cx.bail_out(context::fs, "failed to merge {} staged files from {}",
+                        errors.size(), staging);
+        }
+
+        // the pool drops the remaining copies on interruption, the stage will be
+        // merged again by the next build
+        if (copied != files.size()) {
+            delete_new();
+            return;
+        }
+
+        // files that were renamed aside, and the ones that didn't exist before
+        std::vector<const std::string*> replaced, added;
+
+        const auto rollback = [&] {
+            for (const auto* f : added)
+                ::DeleteFileW((dest / to_path(*f)).native().c_str());
+
+            for (const auto* f : replaced) {
+                ::MoveFileExW(old_path(*f).native().c_str(),
+                              (dest / to_path(*f)).native().c_str(),
+                              MOVEFILE_REPLACE_EXISTING);
+            }
+
+            delete_new();
+        };
+
+        // renaming works even for files that are in use, like dlls of a running
+        // instance, and is quick enough to not be interrupted
+        for (auto&& f : files) {
+            const auto dst = dest / to_path(f);
+            bool aside     = false;
+
+            if (fs::exists(dst)) {
+                if (!::MoveFileExW(dst.native().c_str(), old_path(f).native().c_str(),
+                                   MOVEFILE_REPLACE_EXISTING)) {
+                    const auto e = GetLastError();
+                    rollback();
+
+                    cx.bail_out(context::fs, "failed to rename {} aside, {}", dst,
+                                error_message(e));
+                }
+
+                replaced.push_back(&f);
+                aside = true;
+            }
+
+            if (!::MoveFileExW(new_path(f).native().c_str(), dst.native().c_str(),
+                               MOVEFILE_REPLACE_EXISTING)) {
+                // the one that was just renamed aside goes back too
+                const auto e = GetLastError();
+                rollback();
+
+                cx.bail_out(context::fs, "failed to install {}, {}", dst,
+                            error_message(e));
+            }
+
+            if (!aside)
+                added.push_back(&f);
+        }
+
+        // old files that are in use can't be deleted, they're deleted by the
+        // next merge or on reboot; scheduling the deletion needs admin rights, so
+        // it's only a fallback
+        for (const auto* f : replaced) {
+            const auto old = old_path(*f);
+
+            if (::DeleteFileW(old.native().c_str()))
+                continue;
+
+            const auto e = GetLastError();
+            cx.debug(context::fs, "can't delete {}, {}", old, error_message(e));
+
+            ::MoveFileExW(old.native().c_str(), nullptr, MOVEFILE_DELAY_UNTIL_REBOOT);
+        }
+    }
+
+    void install_staging::delete_old_files(const context& cx, const fs::path& dir)
+    {
+        std::error_code ec;
+
+        for (auto&& e : fs::directory_iterator(dir, ec)) {
+            if (!e.is_regular_file(ec) || e.path().extension() != merge_old_ext)
+                continue;
+
+            if (::DeleteFileW(e.path().native().c_str()))
+                cx.trace(context::fs, "deleted {} from a previous merge", e.path());
+        }
+    }
+
+    bool install_staging::is_merge_file(const fs::path& p)
+    {
+        const auto ext = p.extension();
+        return (ext == merge_new_ext || ext == merge_old_ext);
+    }
+
+    std::vector<std::string> install_staging::merge_file_globs()
+    {
+        return {"*.mob_new", "*.mob_old"};
+    }
+
+    void install_staging::prune(const context& cx, const fs::path& staging,
+                                const fs::path& manifest)
+    {
+        if (conf().global().dry() || !fs::exists(manifest) || !fs::exists(staging))
+            return;
+
+        // absolute paths with forward slashes, one per line
+        std::set<fs::path> installed;
+
+        op::read_text_lines(cx, encodings::utf8, manifest, [&](std::string_view l) {
+            installed.insert(to_path(l).lexically_normal());
+        });
+
+        std::vector<fs::path> stale;
+
+        for (auto&& e : fs::recursive_directory_iterator(staging)) {
+            if (e.is_regular_file() && !installed.contains(e.path().lexically_normal()))
+                stale.push_back(e.path());
+        }
+
+        for (auto&& p : stale)
+            op::delete_file(cx, p, op::optional);
+    }
+
+    void install_staging::load()
+    {
+        if (loaded_)
+            return;
+
+        loaded_ = true;
+
+        const auto p = file();
+        if (!fs::exists(p))
+            return;
+
+        const std::string s =
+            op::read_text_file(gcx(), encodings::utf8, p, op::optional);
+
+        // a broken file only loses the conflict detection and the skipping for
+        // one run
+        const auto json = nlohmann::json::parse(s, nullptr, false);
+        if (json.is_discarded() || !json.is_object()) {
+            gcx().warning(context::generic, "bad staging file {}, ignoring", p);
+            return;
+        }
+
+        const auto& stages = json["stages"];
+        if (!stages.is_object())
+            return;
+
+        for (auto&& [name, v] : stages.items()) {
+            if (!v.is_object() || !v.contains("files") || !v["files"].is_array())
+                continue;
+
+            stage st;
+            st.dest        = to_path(v.value("dest", ""));
+            st.fingerprint = v.value("fingerprint", "");
+
+            for (auto&& f : v["files"]) {
+                if (f.is_string())
+                    st.files.insert(f.get<std::string>());
+            }
+
+            stages_[name] = std::move(st);
+        }
+    }
+
+    void install_staging::save()
+    {
+        nlohmann::json json;
+        json["stages"] = nlohmann::json::object();
+
+        for (auto&& [name, s] : stages_) {
+            json["stages"][name] = {{"dest", path_to_utf8(s.dest)},
+                                    {"fingerprint", s.fingerprint},
+                                    {"files", s.files}};
+        }
+
+        op::write_text_file(gcx(), encodings::utf8, file(), json.dump(2),
+                            op::optional);
+    }
+
+}  // namespace mob
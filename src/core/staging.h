@@ -0,0 +1,112 @@
+#pragma once
+
+namespace mob {
+
+    class context;
+
+    // tasks install into their own staging directory instead of the shared
+    // install directory, which is then merged into it once the install
+    // succeeded; singleton
+    //
+    // this avoids tasks that install concurrently from writing the same files at
+    // the same time and a failed install from leaving half-updated files in the
+    // install directory, see `[global] stage_installs`
+    //
+    // staging directories are kept between builds so cmake can skip the files
+    // that are up to date, and only the files that changed since they were last
+    // published are copied into the install directory
+    //
+    // the files published by each stage are remembered in a json file in the
+    // prefix so that:
+    //   - files installed by more than one task are reported as conflicts, the
+    //     last one to be published wins, and
+    //   - a stage that has the same files as last time (same names, sizes and
+    //     times) isn't merged again
+    //
+    class install_staging {
+    public:
+        static install_staging& instance();
+
+        // staging directory for the given stage name, build/staging/name
+        //
+        static fs::path path(std::string_view name);
+
+        // copies every file in `staging` that's different from the one in
+        // `dest` to the same relative path, replacing existing files; `name`
+        // identifies the stage for conflicts, usually the task name
+        //
+        // all or nothing: see merge_files(); bails out on failure
+        //
+        void publish(const context& cx, const std::string& name,
+                     const fs::path& staging, const fs::path& dest);
+
+        // deletes the files in `staging` that are not listed in the given
+        // install manifest written by cmake, if it exists, so files that are not
+        // installed anymore aren't published
+        //
+        static void prune(const context& cx, const fs::path& staging,
+                          const fs::path& manifest);
+
+        // path to the file listing published files, prefix/mob_staging.json
+        //
+        static fs::path file();
+
+        // whether the given file was created by merge_files() while it was
+        // replacing files, `*.mob_new` or `*.mob_old`; they're left behind if mob
+        // is killed during a merge or when an old file is still in use, and must
+        // not be released
+        //
+        static bool is_merge_file(const fs::path& p);
+
+        // globs for is_merge_file(), for archive_from_glob()
+        //
+        static std::vector<std::string> merge_file_globs();
+
+    private:
+        // what a stage published last time
+        struct stage {
+            fs::path dest;
+            std::string fingerprint;
+            std::set<std::string> files;
+        };
+
+        std::map<std::string, stage, std::less<>> stages_;
+        bool loaded_ = false;
+        std::mutex mutex_;
+
+        // reads the file if it hasn't been loaded yet; mutex must be locked
+        //
+        void load();
+
+        // writes the file; mutex must be locked
+        //
+        void save();
+
+        // reports files of `s` that were published by other stages in the
+        // same destination and removes them from those stages
+        //
+        void check_conflicts(const context& cx, const std::string& name,
+                             const stage& s, const fs::path& staging);
+
+        // copies the given files from `staging` next to their destination in
+        // parallel, then renames the existing files aside and the copies in their
+        // place; if anything fails, the old files are put back and `dest` is left
+        // as it was before bailing out
+        //
+        // nothing is touched in `dest` if the copies were interrupted, and the
+        // renames are not interrupted once started
+        //
+        // old files are renamed to unique names so one that's still in use from
+        // a previous merge doesn't get in the way; the ones that can't be deleted
+        // are deleted by the next merge into the same directory or on reboot
+        //
+        void merge_files(const context& cx, const fs::path& staging,
+                         const fs::path& dest, const std::vector<std::string>& files);
+
+        // deletes the old files left in `dir` by previous merges, ignoring the
+        // ones that are still in use
+        //
+        static void delete_old_files(const context& cx, const fs::path& dir);
+    };
+
+}  // namespace mob
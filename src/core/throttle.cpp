@@ -0,0 +1,341 @@
+#include "pch.h"
+#include "throttle.h"
+#include "../utility.h"
+#include "conf.h"
+#include "context.h"
+
+namespace mob {
+
+    // how often the system is sampled, sampling more often makes cpu usage too
+    // noisy
+    constexpr auto sample_interval = std::chrono::seconds(1);
+
+    // above any of these, limits go down
+    constexpr double cpu_high        = 90;
+    constexpr double memory_high     = 90;
+    constexpr double disk_queue_high = 4;
+
+    // below all of these, limits go up if something is waiting
+    constexpr double cpu_low        = 70;
+    constexpr double memory_low     = 80;
+    constexpr double disk_queue_low = 1;
+
+    // build jobs when throttling is disabled, this used to be hardcoded
+    constexpr std::size_t default_build_jobs = 16;
+
+    // limit of a gate when throttling is disabled and no maximum is set
+    constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+    std::uint64_t to_uint64(const FILETIME& ft)
+    {
+        return (std::uint64_t(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    }
+
+    struct throttle::pdh {
+        PDH_HQUERY query     = nullptr;
+        PDH_HCOUNTER counter = nullptr;
+
+        pdh()
+        {
+            if (PdhOpenQueryW(nullptr, 0, &query) != ERROR_SUCCESS) {
+                query = nullptr;
+                return;
+            }
+
+            // english name so it works regardless of the system language
+            const auto r = PdhAddEnglishCounterW(
+                query, L"\\PhysicalDisk(_Total)\\Current Disk Queue Length", 0,
+                &counter);
+
+            if (r != ERROR_SUCCESS)
+                counter = nullptr;
+        }
+
+        ~pdh()
+        {
+            if (query)
+                PdhCloseQuery(query);
+        }
+
+        // returns 0 if the counter is not available
+        //
+        double disk_queue()
+        {
+            if (!counter || PdhCollectQueryData(query) != ERROR_SUCCESS)
+                return 0;
+
+            PDH_FMT_COUNTERVALUE v = {};
+
+            const auto r =
+                PdhGetFormattedCounterValue(counter, PDH_FMT_DOUBLE, nullptr, &v);
+
+            if (r != ERROR_SUCCESS)
+                return 0;
+
+            return v.doubleValue;
+        }
+    };
+
+    throttle::slot::slot(gate& g) : g_(g) {}
+
+    throttle::slot::~slot()
+    {
+        g_.release();
+    }
+
+    throttle::gate::gate(std::string name) : name_(std::move(name)) {}
+
+    throttle::slot throttle::gate::acquire(const context& cx)
+    {
+        auto& t = throttle::instance();
+        bool waited = false;
+
+        std::unique_lock lock(t.mutex_);
+        t.configure();
+
+        ++waiting_;
+
+        for (;;) {
+            t.update(cx);
+
+            // always admit if nothing is running, the system might be busy
+            // because of something else and mob would never make progress
+            if (active_ == 0 || active_ < limit_)
+                break;
+
+            // admitted right away on interruption, whatever was waiting will
+            // notice and stop on its own, it must not hold up the shutdown
+            if (cancellation::global().cancelled())
+                break;
+
+            if (!waited) {
+                cx.debug(context::generic, "throttle: waiting for {} slot, {}/{}",
+                         name_, active_, limit_);
+
+                waited = true;
+            }
+
+            // woken up when a slot is released or mob is interrupted, but the
+            // limit can also go up when the load goes down, so the system is
+            // sampled again after a while even if nothing happened
+            t.cv_.wait_for(lock, sample_interval);
+        }
+
+        --waiting_;
+        ++active_;
+
+        return slot(*this);
+    }
+
+    void throttle::gate::release()
+    {
+        auto& t = throttle::instance();
+
+        {
+            std::scoped_lock lock(t.mutex_);
+
+            MOB_ASSERT(active_ > 0);
+            --active_;
+        }
+
+        t.cv_.notify_all();
+    }
+
+    throttle& throttle::instance()
+    {
+        static throttle t;
+        return t;
+    }
+
+    throttle::throttle() : tasks_("task"), processes_("process") {}
+
+    // pdh is incomplete in the header
+    throttle::~throttle() = default;
+
+    void throttle::interrupt()
+    {
+        // acquire() checks the global cancellation when it wakes up; the mutex
+        // is locked so a thread can't miss the notification between checking
+        // the cancellation and starting to wait
+        {
+            std::scoped_lock lock(mutex_);
+        }
+
+        cv_.notify_all();
+    }
+
+    throttle::gate& throttle::tasks()
+    {
+        return tasks_;
+    }
+
+    throttle::gate& throttle::processes()
+    {
+        return processes_;
+    }
+
+    std::size_t throttle::build_jobs(const context& cx)
+    {
+        std::scoped_lock lock(mutex_);
+        configure();
+
+        // set explicitly, typically by `bench-env`
+        const auto conf_jobs = conf().global().get<int>("build_jobs");
+        if (conf_jobs > 0)
+            return static_cast<std::size_t>(conf_jobs);
+
+        if (!enabled_)
+            return default_build_jobs;
+
+        update(cx);
+
+        const auto idle = static_cast<double>(cores_) * (100 - last_.cpu) / 100;
+        // at least 2 so a busy system still builds in parallel, but never more
+        // than the number of cores, which can be 1; std::clamp() would be
+        // undefined in that case
+        const auto rounded = static_cast<std::size_t>(std::lround(idle));
+        const auto jobs    = std::min(std::max<std::size_t>(rounded, 2), cores_);
+
+        cx.debug(context::generic, "throttle: cpu {:.0f}%, using {} build jobs",
+                 last_.cpu, jobs);
+
+        return jobs;
+    }
+
+    void throttle::configure()
+    {
+        if (configured_)
+            return;
+
+        configured_ = true;
+        enabled_    = conf().global().get<bool>("throttle");
+        cores_      = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+        const auto max_of = [&](std::string_view key) {
+            const auto v = conf().global().get<int>(key);
+
+            // 0 means the number of cores when throttling and no limit otherwise,
+            // like before there was a throttle
+            if (v <= 0)
+                return (enabled_ ? cores_ : unlimited);
+
+            return static_cast<std::size_t>(v);
+        };
+
+        tasks_.max_       = max_of("max_tasks");
+        tasks_.limit_     = tasks_.max_;
+        processes_.max_   = max_of("max_processes");
+        processes_.limit_ = processes_.max_;
+
+        if (enabled_) {
+            pdh_ = std::make_unique<pdh>();
+
+            // first sample, cpu usage is relative to this
+            last_      = take_sample();
+            last_time_ = hr_clock::now();
+        }
+
+        const auto limit_string = [](std::size_t n) {
+            return (n == unlimited ? std::string("unlimited") : std::to_string(n));
+        };
+
+        gcx().debug(context::generic,
+                    "throttle: {}, at most {} tasks and {} processes on {} cores",
+                    (enabled_ ? "enabled" : "disabled"), limit_string(tasks_.max_),
+                    limit_string(processes_.max_), cores_);
+    }
+
+    void throttle::update(const context& cx)
+    {
+        if (!enabled_)
+            return;
+
+        const auto now = hr_clock::now();
+        if (now - last_time_ < sample_interval)
+            return;
+
+        last_      = take_sample();
+        last_time_ = now;
+
+        const bool overloaded = (last_.cpu >= cpu_high || last_.memory >= memory_high ||
+                                 last_.disk_queue >= disk_queue_high);
+
+        const bool idle = (last_.cpu < cpu_low && last_.memory < memory_low &&
+                           last_.disk_queue < disk_queue_low);
+
+        cx.dump(context::generic,
+                "throttle: cpu {:.0f}%, memory {:.0f}%, disk queue {:.1f}", last_.cpu,
+                last_.memory, last_.disk_queue);
+
+        for (gate* g : {&tasks_, &processes_}) {
+            const auto before = g->limit_;
+
+            if (!adjust(*g, overloaded, idle))
+                continue;
+
+            cx.debug(context::generic,
+                     "throttle: cpu {:.0f}%, memory {:.0f}%, disk queue {:.1f}, "
+                     "{} limit {} -> {} ({} active, {} waiting)",
+                     last_.cpu, last_.memory, last_.disk_queue, g->name_, before,
+                     g->limit_, g->active_, g->waiting_);
+        }
+    }
+
+    bool throttle::adjust(gate& g, bool overloaded, bool idle)
+    {
+        if (overloaded) {
+            // cut a quarter of what's actually running so the limit reacts even
+            // if it was far above the active count
+            const auto current = std::min(g.limit_, g.active_);
+            if (current <= 1)
+                return false;
+
+            g.limit_ = current - std::max<std::size_t>(1, current / 4);
+            return true;
+        }
+
+        if (idle && g.waiting_ > 0 && g.limit_ < g.max_) {
+            // grow slowly, one at a time
+            ++g.limit_;
+            return true;
+        }
+
+        return false;
+    }
+
+    throttle::sample throttle::take_sample()
+    {
+        sample s;
+
+        // cpu, the kernel time includes idle time
+        FILETIME idle = {}, kernel = {}, user = {};
+
+        if (GetSystemTimes(&idle, &kernel, &user)) {
+            const auto i     = to_uint64(idle);
+            const auto total = to_uint64(kernel) + to_uint64(user);
+
+            const auto di = i - last_idle_;
+            const auto dt = total - last_total_;
+
+            if (last_total_ != 0 && dt > 0)
+                s.cpu = 100.0 * static_cast<double>(dt - std::min(di, dt)) / dt;
+
+            last_idle_  = i;
+            last_total_ = total;
+        }
+
+        // memory
+        MEMORYSTATUSEX ms = {};
+        ms.dwLength       = sizeof(ms);
+
+        if (GlobalMemoryStatusEx(&ms))
+            s.memory = ms.dwMemoryLoad;
+
+        // disk
+        if (pdh_)
+            s.disk_queue = pdh_->disk_queue();
+
+        return s;
+    }
+
+}  // namespace mob
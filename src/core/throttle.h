@@ -0,0 +1,149 @@
+#pragma once
+
+namespace mob {
+
+    class context;
+
+    // limits how many tasks and tool processes can be active at the same time,
+    // depending on the load of the system; singleton
+    //
+    // there are two gates: one for children of parallel_tasks, which is acquired
+    // for the whole duration of a task, and one for tool processes, which is
+    // acquired while a process is running; tasks run processes, so they must be
+    // separate, or a task waiting on a process slot could block forever
+    //
+    // each gate has a limit that starts at the maximum from the ini and is
+    // adjusted as work is admitted: cpu usage, memory load and disk queue length
+    // are sampled at most once per second, the limit goes down when any of them
+    // is too high and back up when everything is idle and work is waiting
+    //
+    // a gate always admits work if nothing is running, so a system that's busy
+    // because of something else can slow mob down, but never stall it
+    //
+    // with `[global] throttle = false`, the limits never change
+    //
+    class throttle {
+    public:
+        class gate;
+
+        // holds a slot in a gate, released in the destructor
+        //
+        class slot {
+        public:
+            slot(gate& g);
+            ~slot();
+
+            // non-copyable
+            slot(const slot&)            = delete;
+            slot& operator=(const slot&) = delete;
+
+        private:
+            gate& g_;
+        };
+
+        class gate {
+        public:
+            gate(std::string name);
+
+            // blocks until the gate admits one more, the returned slot must be
+            // kept alive until the work is done
+            //
+            [[nodiscard]] slot acquire(const context& cx);
+
+        private:
+            friend class slot;
+            friend class throttle;
+
+            const std::string name_;
+
+            // set from the ini on first use
+            std::size_t max_   = 0;
+            std::size_t limit_ = 0;
+
+            // currently holding a slot
+            std::size_t active_ = 0;
+
+            // blocked in acquire()
+            std::size_t waiting_ = 0;
+
+            // frees a slot
+            //
+            void release();
+        };
+
+        static throttle& instance();
+
+        // wakes up everything blocked in acquire() so it can notice the global
+        // cancellation
+        //
+        void interrupt();
+
+        // for children of parallel_tasks
+        //
+        gate& tasks();
+
+        // for tool processes
+        //
+        gate& processes();
+
+        // the value for `--parallel` when building with cmake; this is
+        // `[global] build_jobs` if set, the number of cores that are currently
+        // idle with throttling, or 16 otherwise
+        //
+        std::size_t build_jobs(const context& cx);
+
+    private:
+        // system load at a point in time
+        struct sample {
+            // cpu usage since the previous sample, 0-100
+            double cpu = 0;
+
+            // physical memory in use, 0-100
+            double memory = 0;
+
+            // outstanding requests on all physical disks
+            double disk_queue = 0;
+        };
+
+        // pdh state for the disk queue counter, hidden in the cpp
+        struct pdh;
+
+        gate tasks_, processes_;
+        bool enabled_      = false;
+        bool configured_   = false;
+        std::size_t cores_ = 1;
+
+        sample last_;
+        hr_clock::time_point last_time_;
+        std::uint64_t last_idle_ = 0, last_total_ = 0;
+        std::unique_ptr<pdh> pdh_;
+
+        // guards everything, including the members of both gates
+        std::mutex mutex_;
+
+        // notified when a slot is released or on interruption
+        std::condition_variable cv_;
+
+        throttle();
+        ~throttle();
+
+        // reads the ini the first time a gate is used; mutex must be locked
+        //
+        void configure();
+
+        // samples the system if the last sample is old enough and adjusts the
+        // limits of both gates, logging any change; mutex must be locked
+        //
+        void update(const context& cx);
+
+        // adjusts the limit of one gate given the current load; returns true if
+        // the limit changed
+        //
+        bool adjust(gate& g, bool overloaded, bool idle);
+
+        // reads the current system load
+        //
+        sample take_sample();
+    };
+
+}  // namespace mob
@@ -2,6 +2,7 @@
 #include "cmd/commands.h"
 #include "core/conf.h"
 #include "core/op.h"
+#include "core/single_flight.h"
 #include "net.h"
 #include "tasks/task_manager.h"
 #include "tasks/tasks.h"
@@ -79,6 +80,9 @@ namespace mob {
         // other tasks
         add_task<translations>();
         add_task<installer>();
+
+        // all tasks are known, builds the name index
+        task_manager::instance().freeze();
     }
 
     // figures out which command to run and returns it, if any
@@ -100,7 +104,9 @@ namespace mob {
             std::make_unique<git_command>(),
             std::make_unique<inis_command>(),
             std::make_unique<tx_command>(),
-            std::make_unique<cmake_config_command>()};
+            std::make_unique<cmake_config_command>(),
+            std::make_unique<bench_env_command>(),
+            std::make_unique<gc_command>()};
 
         // commands are shown in the help
         help->set_commands(commands);
@@ -179,6 +185,9 @@ int wmain(int argc, wchar_t** argv)
         args.push_back(mob::utf16_to_utf8(argv[i]));
 
     int r = mob::run(args);
+    mob::net_stats::instance().log_summary();
+    mob::single_flight_base::log_summary();
+    mob::log_alloc_stats();
     mob::dump_logs();
 
     return r;
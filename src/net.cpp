@@ -2,7 +2,9 @@
 #include "net.h"
 #include "core/conf.h"
 #include "core/context.h"
+#include "core/metrics.h"
 #include "core/op.h"
+#include "tasks/plan.h"
 #include "utility.h"
 #include "utility/threading.h"
 
@@ -73,6 +75,123 @@ namespace mob {
             return path.substr(pos + 1);
     }
 
+    // returns the host of the given url, or an empty string if it can't be
+    // parsed; unlike url::filename(), this never bails out because it's only
+    // used for statistics
+    //
+    std::string host_of(const char* u)
+    {
+        if (!u)
+            return {};
+
+        auto* h = curl_url();
+        guard g([&] {
+            curl_url_cleanup(h);
+        });
+
+        if (curl_url_set(h, CURLUPART_URL, u, 0) != CURLUE_OK)
+            return {};
+
+        char* buffer = nullptr;
+        if (curl_url_get(h, CURLUPART_HOST, &buffer, 0) != CURLUE_OK)
+            return {};
+
+        guard g2([&] {
+            curl_free(buffer);
+        });
+
+        return buffer;
+    }
+
+    // milliseconds with one decimal, for logging
+    //
+    std::string ms_string(std::chrono::microseconds us)
+    {
+        return std::format("{:.1f}", us.count() / 1000.0);
+    }
+
+    // megabytes per second, 0 if the duration is 0
+    //
+    double mb_per_second(std::uint64_t bytes, std::chrono::microseconds us)
+    {
+        if (us.count() <= 0)
+            return 0;
+
+        return (bytes / 1024.0 / 1024.0) / (us.count() / 1000000.0);
+    }
+
+    net_stats& net_stats::instance()
+    {
+        static net_stats s;
+        return s;
+    }
+
+    void net_stats::record(const transfer_stats& s)
+    {
+        std::scoped_lock lock(mutex_);
+
+        auto& h = hosts_[s.host.empty() ? "?" : s.host];
+
+        ++h.transfers;
+
+        if (!s.ok)
+            ++h.failures;
+
+        h.bytes += s.bytes;
+        h.dns += s.dns;
+        h.connect += s.connect;
+        h.tls += s.tls;
+        h.first_byte += s.first_byte;
+        h.total += s.total;
+
+        auto& m = run_metrics::instance();
+
+        m.add("mob_download_bytes_total", {{"host", s.host}},
+              static_cast<double>(s.bytes));
+
+        m.add("mob_downloads_total",
+              {{"host", s.host}, {"result", s.ok ? "ok" : "failed"}});
+    }
+
+    std::optional<net_stats::host_stats>
+    net_stats::get(const std::string& host) const
+    {
+        std::scoped_lock lock(mutex_);
+
+        auto itor = hosts_.find(host);
+        if (itor == hosts_.end())
+            return {};
+
+        return itor->second;
+    }
+
+    void net_stats::log_summary() const
+    {
+        std::scoped_lock lock(mutex_);
+
+        if (hosts_.empty())
+            return;
+
+        gcx().info(context::net, "network summary:");
+
+        for (auto&& [host, h] : hosts_) {
+            const auto n = static_cast<long long>(h.transfers);
+
+            gcx().info(context::net,
+                       "  {}: transfers={} failures={} bytes={} dns={}ms "
+                       "connect={}ms tls={}ms ttfb={}ms total={}ms speed={:.2f}MB/s",
+                       host, h.transfers, h.failures, h.bytes, ms_string(h.dns / n),
+                       ms_string(h.connect / n), ms_string(h.tls / n),
+                       ms_string(h.first_byte / n), ms_string(h.total),
+                       mb_per_second(h.bytes, h.total));
+        }
+    }
+
+    std::string url::host() const
+    {
+        return host_of(s_.c_str());
+    }
+
     curl_downloader::curl_downloader(const context* cx)
         : cx_(cx ? *cx : gcx()), bytes_(0), interrupt_(false), ok_(false)
     {
@@ -105,11 +224,25 @@ namespace mob {
 
     curl_downloader& curl_downloader::start()
     {
-        ok_ = false;
+        ok_    = false;
+        bytes_ = 0;
+        stats_ = {};
         cx_.debug(context::net, "downloading {} to {}", url_, path_);
 
-        if (conf().global().dry())
+        // callers are expected to check for offline mode and use their cache or
+        // bail out with a better message, this is just a safety net
+        if (conf().global().offline()) {
+            cx_.error(context::net, "offline, not downloading {}", url_);
+            return *this;
+        }
+
+        if (conf().global().dry()) {
+            if (build_plan::instance().enabled())
+                build_plan::instance().add_process(cx_.task_name(),
+                                                   "download " + url_.string());
+
             return *this;
+        }
 
         thread_ = start_thread([&] {
             run();
@@ -136,6 +269,11 @@ namespace mob {
         return ok_;
     }
 
+    const transfer_stats& curl_downloader::stats() const
+    {
+        return stats_;
+    }
+
     const std::string& curl_downloader::output()
     {
         return output_;
@@ -192,7 +330,7 @@ namespace mob {
             file_.reset();
         }
 
-        if (interrupt_) {
+        if (interrupted()) {
             cx_.trace(context::net, "curl: {} interrupted", url_);
             return;
         }
@@ -220,6 +358,52 @@ namespace mob {
             cx_.error(context::net, "curl: {}, {} {}", curl_easy_strerror(r),
                       trim_copy(error_buffer), url_);
         }
+
+        collect_stats(c, ok_);
+    }
+
+    void curl_downloader::collect_stats(CURL* c, bool ok)
+    {
+        using us = std::chrono::microseconds;
+
+        // all the times are from the start of the transfer
+        curl_off_t dns = 0, connect = 0, tls = 0, first_byte = 0, total = 0;
+        curl_off_t bytes = 0;
+        char* effective  = nullptr;
+
+        curl_easy_getinfo(c, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+        curl_easy_getinfo(c, CURLINFO_CONNECT_TIME_T, &connect);
+        curl_easy_getinfo(c, CURLINFO_APPCONNECT_TIME_T, &tls);
+        curl_easy_getinfo(c, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+        curl_easy_getinfo(c, CURLINFO_TOTAL_TIME_T, &total);
+        curl_easy_getinfo(c, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+        curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &stats_.http);
+        curl_easy_getinfo(c, CURLINFO_EFFECTIVE_URL, &effective);
+
+        stats_.host       = host_of(effective);
+        stats_.ok         = ok;
+        stats_.dns        = us(dns);
+        stats_.connect    = us(connect > dns ? connect - dns : 0);
+        stats_.tls        = us(tls > connect ? tls - connect : 0);
+        stats_.first_byte = us(first_byte);
+        stats_.total      = us(total);
+        stats_.bytes      = static_cast<std::uint64_t>(bytes);
+
+        // one line with key=value pairs so it can be grepped from the log
+        cx_.debug(context::net,
+                  "curl: transfer host={} ok={} http={} dns={}ms connect={}ms "
+                  "tls={}ms ttfb={}ms total={}ms bytes={} speed={:.2f}MB/s",
+                  stats_.host, stats_.ok, stats_.http, ms_string(stats_.dns),
+                  ms_string(stats_.connect), ms_string(stats_.tls),
+                  ms_string(stats_.first_byte), ms_string(stats_.total),
+                  stats_.bytes, mb_per_second(stats_.bytes, stats_.total));
+
+        net_stats::instance().record(stats_);
+    }
+
+    bool curl_downloader::interrupted() const
+    {
+        return interrupt_ || cancellation::global().cancelled();
     }
 
     size_t curl_downloader::on_write_static(char* ptr, size_t size, size_t nmemb,
@@ -227,14 +411,14 @@ namespace mob {
     {
         auto* self = static_cast<curl_downloader*>(user);
 
-        if (self->interrupt_) {
+        if (self->interrupted()) {
             gcx().debug(context::net, "downloader: interrupting");
             return (size * nmemb) + 1;  // force failure
         }
 
         self->on_write(ptr, size * nmemb);
 
-        if (self->interrupt_) {
+        if (self->interrupted()) {
             gcx().debug(context::net, "downloader: interrupting");
             return (size * nmemb) + 1;  // force failure
         }
@@ -313,7 +497,7 @@ namespace mob {
     {
         auto* self = static_cast<curl_downloader*>(user);
 
-        if (self->interrupt_) {
+        if (self->interrupted()) {
             gcx().debug(context::net, "downloader: interrupting");
             return 1;
         }
@@ -326,7 +510,7 @@ namespace mob {
     {
         auto* self = static_cast<curl_downloader*>(user);
 
-        if (self->interrupt_) {
+        if (self->interrupted()) {
             gcx().debug(context::net, "downloader: interrupting");
             return 1;
         }
@@ -31,10 +31,80 @@ namespace mob {
         //
         std::string filename() const;
 
+        // host name, empty if the url can't be parsed
+        //
+        std::string host() const;
+
     private:
         std::string s_;
     };
 
+    // timings of a single transfer, from curl_easy_getinfo()
+    //
+    struct transfer_stats {
+        // host of the last url after redirects, empty if it couldn't be parsed
+        std::string host;
+
+        // whether the transfer succeeded with an http 200
+        bool ok = false;
+
+        // http status, 0 if the server was never reached
+        long http = 0;
+
+        // durations of each step, a step that didn't happen is 0
+        std::chrono::microseconds dns{0};
+        std::chrono::microseconds connect{0};
+        std::chrono::microseconds tls{0};
+
+        // from the start of the transfer until the first byte was received
+        std::chrono::microseconds first_byte{0};
+
+        // the whole transfer, including redirects
+        std::chrono::microseconds total{0};
+
+        // bytes received
+        std::uint64_t bytes = 0;
+    };
+
+    // aggregates transfer_stats per host for the whole run, logged by
+    // log_summary() when mob exits; also used by the downloader tool to try
+    // mirrors that worked before the ones that failed; singleton
+    //
+    class net_stats {
+    public:
+        // totals for one host
+        struct host_stats {
+            std::size_t transfers = 0;
+            std::size_t failures  = 0;
+            std::uint64_t bytes   = 0;
+
+            // sums of transfer_stats, averaged in log_summary()
+            std::chrono::microseconds dns{0};
+            std::chrono::microseconds connect{0};
+            std::chrono::microseconds tls{0};
+            std::chrono::microseconds first_byte{0};
+            std::chrono::microseconds total{0};
+        };
+
+        static net_stats& instance();
+
+        // adds the given transfer to its host, thread-safe
+        //
+        void record(const transfer_stats& s);
+
+        // totals for the given host, empty if nothing was transferred from it
+        //
+        std::optional<host_stats> get(const std::string& host) const;
+
+        // logs a line per host, does nothing if there were no transfers
+        //
+        void log_summary() const;
+
+    private:
+        std::map<std::string, host_stats> hosts_;
+        mutable std::mutex mutex_;
+    };
+
     // threaded downloader
     //
     class curl_downloader {
@@ -75,6 +145,10 @@ namespace mob {
         //
         bool ok() const;
 
+        // timings of the last transfer; only valid after join()
+        //
+        const transfer_stats& stats() const;
+
         // if file() wasn't called, returns the content that was retrieved
         //
         const std::string& output();
@@ -91,8 +165,20 @@ namespace mob {
         bool ok_;
         std::string output_;
         headers headers_;
+        transfer_stats stats_;
 
         void run();
+
+        // whether interrupt() was called, or mob itself was interrupted; checked
+        // in the curl callbacks, which are called at least once per second even
+        // when a transfer is stalled
+        //
+        bool interrupted() const;
+
+        // fills stats_ from the curl handle, logs it and records it in
+        // net_stats
+        //
+        void collect_stats(CURL* c, bool ok);
         bool create_file();
         bool write_file(char* ptr, size_t size);
         bool write_string(char* ptr, size_t size);
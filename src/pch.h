@@ -49,11 +49,16 @@
 #include <array>
 #include <atomic>
 #include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <optional>
@@ -62,13 +67,17 @@
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <windows.h>
 
+#include <bcrypt.h>
 #include <dbghelp.h>
 #include <fcntl.h>
 #include <io.h>
+#include <pdh.h>
+#include <psapi.h>
 #include <shlobj.h>
 #include <shlwapi.h>
 
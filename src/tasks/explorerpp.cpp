@@ -3,16 +3,6 @@
 
 namespace mob::tasks {
 
-    namespace {
-
-        url source_url()
-        {
-            return "https://download.explorerplusplus.com/stable/" +
-                   explorerpp::version() + "/explorerpp_x64.zip";
-        }
-
-    }  // namespace
-
     explorerpp::explorerpp() : basic_task("explorerpp", "explorer++") {}
 
     std::string explorerpp::version()
@@ -20,6 +10,12 @@ namespace mob::tasks {
         return conf().version().get("explorerpp");
     }
 
+    url explorerpp::source_url()
+    {
+        return "https://download.explorerplusplus.com/stable/" + version() +
+               "/explorerpp_x64.zip";
+    }
+
     bool explorerpp::prebuilt()
     {
         // always prebuilt, direct download
@@ -31,6 +27,11 @@ namespace mob::tasks {
         return conf().path().build() / "explorer++";
     }
 
+    std::vector<fs::path> explorerpp::get_kept_paths() const
+    {
+        return {source_path(), downloader(source_url()).result()};
+    }
+
     void explorerpp::do_clean(clean c)
     {
         // delete download
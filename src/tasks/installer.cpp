@@ -20,6 +20,11 @@ namespace mob::tasks {
         return modorganizer::super_path() / "installer";
     }
 
+    url installer::git_url() const
+    {
+        return make_git_url(task_conf().mo_org(), "modorganizer-Installer");
+    }
+
     void installer::do_clean(clean c)
     {
         // delete the git clone directory
@@ -34,24 +39,28 @@ namespace mob::tasks {
 
     void installer::do_fetch()
     {
-        const std::string repo = "modorganizer-Installer";
-
         // find the best suitable branch
         const auto fallback = task_conf().mo_fallback_branch();
         auto branch         = task_conf().mo_branch();
-        if (!fallback.empty() &&
-            !git_wrap::remote_branch_exists(make_git_url(task_conf().mo_org(), repo),
-                                            branch)) {
+
+        // in offline mode, the branch can only be one that was already fetched;
+        // otherwise, the build command has usually resolved it already with the
+        // other repos, see build_command::resolve_remote_heads()
+        const auto has_branch = [&] {
+            if (conf().global().offline())
+                return git_wrap(source_path()).has_branch(branch);
+
+            return git_wrap::remote_branch_exists(git_url(), branch);
+        };
+
+        if (!fallback.empty() && !has_branch()) {
             cx().warning(context::generic,
-                         "{} has no remote {} branch, switching to {}", repo, branch,
-                         fallback);
+                         "{} has no remote {} branch, switching to {}", git_url(),
+                         branch, fallback);
             branch = fallback;
         }
 
-        run_tool(make_git()
-                     .url(make_git_url(task_conf().mo_org(), repo))
-                     .branch(branch)
-                     .root(source_path()));
+        run_tool(make_git().url(git_url()).branch(branch).root(source_path()));
     }
 
     void installer::do_build_and_install()
@@ -1,4 +1,8 @@
 #include "pch.h"
+#include "../core/metrics.h"
+#include "../core/staging.h"
+#include "../core/throttle.h"
+#include "plan.h"
 #include "tasks.h"
 
 namespace mob::tasks {
@@ -59,6 +63,15 @@ namespace mob::tasks {
         g.init_repo();
     }
 
+    // `p` with the given configuration name appended, like "install-Debug", used
+    // for the directories of the configurations other than the main one
+    //
+    fs::path configuration_sibling(const fs::path& p, mob::config c)
+    {
+        return p.parent_path() /
+               (path_to_utf8(p.filename()) + "-" + cmake::configuration_name(c));
+    }
+
     modorganizer::modorganizer(std::string long_name)
         : modorganizer(std::vector<std::string>{long_name})
     {
@@ -82,17 +95,78 @@ namespace mob::tasks {
 
     std::string modorganizer::cmake_prefix_path()
     {
-        return conf().path().qt_install().string() + ";" +
-               (modorganizer::super_path() / "cmake_common").string() + ";" +
-               (conf().path().install() / "lib" / "cmake").string();
+        return path_to_utf8(conf().path().qt_install()) + ";" +
+               path_to_utf8(modorganizer::super_path() / "cmake_common") + ";" +
+               path_to_utf8(conf().path().install() / "lib" / "cmake");
     }
 
     fs::path modorganizer::source_path() const
     {
+        // set by `pr pull --worktree` to build a pr without touching the clone
+        // in super
+        const auto wt = task_conf().mo_worktree();
+        if (!wt.empty())
+            return wt;
+
         // something like build/modorganizer_super/uibase
         return super_path() / name();
     }
 
+    fs::path modorganizer::get_source_path() const
+    {
+        return source_path();
+    }
+
+    fs::path modorganizer::build_path() const
+    {
+        // set by `pr build` for every task it builds so the regular build
+        // directory is left alone and doesn't have to be rebuilt afterwards
+        const auto p = task_conf().mo_build();
+        if (!p.empty())
+            return p;
+
+        return cmake(cmake::build).root(source_path()).build_path();
+    }
+
+    fs::path modorganizer::build_path(mob::config c) const
+    {
+        if (c == task_conf().configurations()[0])
+            return build_path();
+
+        return configuration_sibling(build_path(), c);
+    }
+
+    cmake modorganizer::make_cmake(cmake::ops o, mob::config c) const
+    {
+        auto t = std::move(cmake(o).root(source_path()));
+
+        // the default build directory is only given explicitly when needed
+        const auto p = build_path(c);
+        if (p != t.build_path())
+            t.output(p);
+
+        return t;
+    }
+
+    fs::path modorganizer::install_path() const
+    {
+        // set by `pr build --install` to keep the regular install directory
+        // intact
+        const auto p = task_conf().mo_install();
+        if (!p.empty())
+            return p;
+
+        return conf().path().install();
+    }
+
+    fs::path modorganizer::install_path(mob::config c) const
+    {
+        if (c == task_conf().configurations()[0])
+            return install_path();
+
+        return configuration_sibling(install_path(), c);
+    }
+
     fs::path modorganizer::super_path()
     {
         return conf().path().build();
@@ -123,9 +197,11 @@ namespace mob::tasks {
             return;
         }
 
-        // cmake clean
-        if (is_set(c, clean::reconfigure))
-            run_tool(cmake(cmake::clean).root(source_path()));
+        // cmake clean, every configuration has its own build directory
+        if (is_set(c, clean::reconfigure)) {
+            for (const auto config : task_conf().configurations())
+                run_tool(make_cmake(cmake::clean, config));
+        }
     }
 
     void modorganizer::do_fetch()
@@ -136,7 +212,16 @@ namespace mob::tasks {
         // find the best suitable branch
         const auto fallback = task_conf().mo_fallback_branch();
         auto branch         = task_conf().mo_branch();
-        if (!fallback.empty() && !git_wrap::remote_branch_exists(git_url(), branch)) {
+
+        // in offline mode, the branch can only be one that was already fetched
+        const auto has_branch = [&] {
+            if (conf().global().offline())
+                return git_wrap(source_path()).has_branch(branch);
+
+            return git_wrap::remote_branch_exists(git_url(), branch);
+        };
+
+        if (!fallback.empty() && !has_branch()) {
             cx().warning(context::generic,
                          "{} has no remote {} branch, switching to {}", repo_, branch,
                          fallback);
@@ -175,30 +260,386 @@ namespace mob::tasks {
                            "{} has no CMakePresets.txt, aborting build", repo_);
         }
 
-        // run cmake
-        run_tool(cmake(cmake::generate)
-                     .generator(cmake::vs)
-                     .def("CMAKE_INSTALL_PREFIX:PATH", conf().path().install())
-                     .def("CMAKE_PREFIX_PATH", cmake_prefix_path())
-                     .configuration_types({task_conf().configuration()})
-                     .preset("vs2022-windows")
-                     .root(source_path()));
+        // builds the project with other profiles instead
+        const auto profiles = task_conf().compare_profiles();
+        if (!profiles.empty()) {
+            compare_profiles(profiles);
+            return;
+        }
+
+        // the number of jobs depends on how busy the machine is, see
+        // throttle::build_jobs(), and is shared by all the configurations
+        const auto configs = task_conf().configurations();
+        const auto jobs    = std::max<std::size_t>(
+            1, throttle::instance().build_jobs(cx()) / configs.size());
+
+        if (configs.size() == 1) {
+            configure(configs[0]);
+            build_configuration(configs[0], jobs);
+            return;
+        }
+
+        // each configuration has its own build tree, see build_path(c), so they
+        // can be configured and built at the same time; all of them are
+        // configured first so cmake doesn't regenerate a tree while another
+        // configuration is compiling
+        parallel_functions configure_v, build_v;
+
+        for (const auto c : configs) {
+            const auto n = name() + "-" + cmake::configuration_name(c);
+
+            configure_v.push_back({n, [this, c] {
+                                       configure(c);
+
+                                       // ZERO_CHECK regenerates the project files
+                                       // if cmake files changed
+                                       run_tool(make_cmake(cmake::build, c)
+                                                    .targets("ZERO_CHECK")
+                                                    .configuration(c));
+                                   }});
+
+            build_v.push_back({n, [this, c, jobs] {
+                                   build_configuration(c, jobs);
+                               }});
+        }
+
+        parallel(configure_v);
+        parallel(build_v);
+    }
+
+    void modorganizer::configure(mob::config c)
+    {
+        auto generate = make_generate(task_conf().profile(), c);
+
+        // only run cmake when something that affects the configuration changed
+        // since the last time, see configure_fingerprint()
+        const auto fp_file     = generate.build_path() / "_mob_configure";
+        const std::string fp   = configure_fingerprint(c);
+        const auto changed     = changed_configure_inputs(fp_file, fp);
+        const bool plan_active = build_plan::instance().enabled();
 
+        run_metrics::instance().add(
+            "mob_cache_lookups_total",
+            {{"cache", "configure"}, {"result", changed ? "miss" : "hit"}});
+
+        if (!changed) {
+            cx().debug(context::bypass,
+                       "{} configure inputs unchanged, not running cmake", c);
+
+            if (plan_active)
+                build_plan::instance().add_reason(name(), "configure inputs unchanged");
+
+            return;
+        }
+
+        if (!changed->empty()) {
+            // cached variables like package directories would be stale, so
+            // start from scratch like --reconfigure would
+            cx().info(context::rebuild,
+                      "{} configure inputs changed ({}), reconfiguring", c,
+                      join(*changed, ", "));
+
+            if (plan_active) {
+                build_plan::instance().add_reason(
+                    name(), "configure inputs changed: " + join(*changed, ", "));
+            }
+
+            run_tool(make_cmake(cmake::clean, c));
+        }
+
+        run_tool(generate);
+        op::write_text_file(cx(), encodings::utf8, fp_file, fp);
+    }
+
+    cmake modorganizer::make_generate(const std::string& profile,
+                                      mob::config c) const
+    {
+        auto generate =
+            std::move(make_cmake(cmake::generate, c)
+                          .generator(cmake::vs)
+                          .def("CMAKE_INSTALL_PREFIX:PATH", install_path(c))
+                          .def("CMAKE_PREFIX_PATH", prefix_path(c))
+                          .configuration_types({c})
+                          .preset("vs2022-windows"));
+
+        for (auto&& [name, value] : profile_defs(profile))
+            generate.def(name, value);
+
+        return generate;
+    }
+
+    std::vector<std::pair<std::string, std::string>>
+    modorganizer::profile_defs(const std::string& profile) const
+    {
+        if (profile.empty())
+            return {};
+
+        return conf().build_profiles().defs(profile);
+    }
+
+    void modorganizer::compare_profiles(const std::vector<std::string>& profiles)
+    {
+        using namespace std::chrono;
+
+        struct timings {
+            std::string profile;
+            milliseconds configure{0}, compile{0}, link{0}, total{0};
+        };
+
+        // the same configuration and jobs for every profile, so the times can be
+        // compared; install_path(c) is never touched
+        const auto c    = task_conf().configuration();
+        const auto jobs = throttle::instance().build_jobs(cx());
+
+        std::vector<timings> results;
+
+        for (auto&& profile : profiles) {
+            cx().info(context::generic, "building {} with profile {}", name(),
+                      profile);
+
+            // always from scratch, in a directory that's not the regular build
+            // directory so it's left alone
+            const auto dir = source_path() / ("vsbuild-" + profile);
+            op::delete_directory(cx(), dir, op::optional);
+
+            timings t;
+            t.profile = profile;
+
+            const auto start = hr_clock::now();
+            run_tool(make_generate(profile, c).output(dir));
+            const auto configured = hr_clock::now();
+
+            // msbuild's file logger writes a summary of the time spent in each
+            // task, see parse_task_times()
+            const auto log = dir / "mob_profile.log";
+
+            run_tool(cmake(cmake::build)
+                         .root(source_path())
+                         .output(dir)
+                         .configuration(c)
+                         .arg("--parallel")
+                         .arg(std::to_string(jobs))
+                         .arg("--")
+                         .arg("\"-flp:PerformanceSummary;Verbosity=minimal;LogFile=" +
+                              path_to_utf8(log) + "\""));
+
+            t.configure = duration_cast<milliseconds>(configured - start);
+            t.total     = duration_cast<milliseconds>(hr_clock::now() - start);
+
+            parse_task_times(log, t.compile, t.link);
+            results.push_back(t);
+
+            op::delete_directory(cx(), dir, op::optional);
+        }
+
+        const auto seconds = [](milliseconds ms) {
+            return std::format("{:.1f}s", ms.count() / 1000.0);
+        };
+
+        cx().info(context::generic, "build profiles for {}, {}:", name(), c);
+        cx().info(context::generic, "  {:<12} {:>10} {:>10} {:>10} {:>10}", "profile",
+                  "configure", "compile", "link", "total");
+
+        for (auto&& t : results) {
+            cx().info(context::generic, "  {:<12} {:>10} {:>10} {:>10} {:>10}",
+                      t.profile, seconds(t.configure), seconds(t.compile),
+                      seconds(t.link), seconds(t.total));
+        }
+    }
+
+    void modorganizer::parse_task_times(const fs::path& log,
+                                        std::chrono::milliseconds& compile,
+                                        std::chrono::milliseconds& link) const
+    {
+        if (!exists(log))
+            return;
+
+        // the summary looks like
+        //
+        //   Task Performance Summary:
+        //          12 ms  Message                                    4 calls
+        //      345678 ms  CL                                        42 calls
+        //
+        // and comes after the target summary, which has a "Link" target too
+        static const std::regex re(R"(^\s*(\d+) ms\s+(\S+)\s+\d+ calls)");
+
+        bool in_tasks = false;
+
+        op::read_text_lines(cx(), encodings::dont_know, log, [&](std::string_view l) {
+            if (l.starts_with("Task Performance Summary")) {
+                in_tasks = true;
+                return;
+            }
+
+            std::match_results<std::string_view::const_iterator> m;
+            if (!in_tasks || !std::regex_search(l.begin(), l.end(), m, re))
+                return;
+
+            const auto ms   = std::chrono::milliseconds(std::stoll(m[1].str()));
+            const auto task = m[2].str();
+
+            if (task == "CL")
+                compile += ms;
+            else if (task == "Link" || task == "Lib")
+                link += ms;
+        });
+    }
+
+    void modorganizer::build_configuration(mob::config c, std::size_t jobs)
+    {
         // run cmake --build with default target
         // TODO: handle rebuild by adding `--clean-first`
-        // TODO: have a way to specify the `--parallel` value - 16 is useful to build
-        // game_bethesda that has 15 games, so 15 projects
-        run_tool(cmake(cmake::build)
-                     .root(source_path())
+        run_tool(make_cmake(cmake::build, c)
                      .arg("--parallel")
-                     .arg("16")
-                     .configuration(task_conf().configuration()));
-
-        // run cmake --install
-        run_tool(cmake(cmake::build)
-                     .root(source_path())
-                     .targets("INSTALL")
-                     .configuration(task_conf().configuration()));
+                     .arg(std::to_string(jobs))
+                     .configuration(c));
+
+        if (conf().global().get<bool>("stage_installs")) {
+            // install in a staging directory that's merged into the install
+            // directory once it succeeded, see install_staging
+            std::string stage = name();
+            if (install_path(c) != install_path())
+                stage += "-" + cmake::configuration_name(c);
+
+            // the staging directory is kept so cmake skips the files that are
+            // up to date, files it doesn't install anymore are removed from it
+            const auto staging = install_staging::path(stage);
+
+            run_tool(make_cmake(cmake::install, c).configuration(c).prefix(staging));
+
+            install_staging::prune(cx(), staging,
+                                   build_path(c) / "install_manifest.txt");
+
+            install_staging::instance().publish(cx(), stage, staging,
+                                                install_path(c));
+        }
+        else {
+            // run cmake --install, CMAKE_INSTALL_PREFIX is install_path(c)
+            run_tool(make_cmake(cmake::build, c).targets("INSTALL").configuration(c));
+        }
+    }
+
+    std::string modorganizer::prefix_path(mob::config c) const
+    {
+        // projects installed in a different directory, and the packages of the
+        // same configuration, must be found before the ones in the regular
+        // install directory, which are built with the main configuration
+        std::vector<fs::path> dirs;
+
+        const auto add = [&](const fs::path& d) {
+            if (d == conf().path().install())
+                return;
+
+            if (std::find(dirs.begin(), dirs.end(), d) == dirs.end())
+                dirs.push_back(d);
+        };
+
+        add(install_path(c));
+
+        if (c != task_conf().configurations()[0])
+            add(configuration_sibling(conf().path().install(), c));
+
+        add(install_path());
+
+        std::string s;
+        for (auto&& d : dirs)
+            s += path_to_utf8(d / "lib" / "cmake") + ";";
+
+        return s + cmake_prefix_path();
+    }
+
+    std::string modorganizer::configure_fingerprint(mob::config c) const
+    {
+        const auto line = [](std::string_view name, const fingerprint& f) {
+            return std::string(name) + "=" + f.hex() + "\n";
+        };
+
+        std::string s;
+
+        // shared cmake files included by every project
+        s += line("cmake_common",
+                  fingerprint().add_tree(super_path() / "cmake_common"));
+
+        // presets of this project, the user presets are optional
+        s += line("presets", fingerprint()
+                                 .add_file(source_path() / "CMakePresets.json")
+                                 .add_file(source_path() / "CMakeUserPresets.json"));
+
+        // the same definitions as in do_build_and_install()
+        s += line("prefix_path", fingerprint().add(prefix_path(c)));
+
+        s += line("defs", fingerprint()
+                              .add(path_to_utf8(install_path(c)))
+                              .add(std::format("{}", c))
+                              .add("vs2022-windows"));
+
+        // definitions from the build profile
+        fingerprint profile;
+        for (auto&& [name, value] : profile_defs(task_conf().profile()))
+            profile.add(name + "=" + value);
+
+        s += line("profile", profile);
+
+        // anything that changes the compiler or how cmake finds it
+        s += line("toolchain", fingerprint()
+                                   .add(path_to_utf8(cmake::binary()))
+                                   .add(path_to_utf8(conf().path().vs()))
+                                   .add(vs::version())
+                                   .add(vs::year())
+                                   .add(vs::toolset())
+                                   .add(vs::sdk())
+                                   .add(conf().cmake().host())
+                                   .add(path_to_utf8(conf().path().vcpkg())));
+
+        return s;
+    }
+
+    std::string modorganizer::checkpoint_inputs() const
+    {
+        // nothing is configured without a CMakeLists.txt, see
+        // do_build_and_install()
+        if (!exists(source_path() / "CMakeLists.txt"))
+            return {};
+
+        std::string s;
+        for (const auto c : task_conf().configurations())
+            s += configure_fingerprint(c);
+
+        return s;
+    }
+
+    std::optional<std::vector<std::string>>
+    modorganizer::changed_configure_inputs(const fs::path& file,
+                                           const std::string& current) const
+    {
+        // never configured, or configured by an older version of mob that didn't
+        // write fingerprints, or the build directory was deleted
+        if (!exists(file) || !exists(file.parent_path() / "CMakeCache.txt"))
+            return std::vector<std::string>();
+
+        std::map<std::string, std::string, std::less<>> previous;
+
+        op::read_text_lines(cx(), encodings::utf8, file, [&](std::string_view l) {
+            const auto sep = l.find('=');
+            if (sep != std::string_view::npos)
+                previous.emplace(l.substr(0, sep), l.substr(sep + 1));
+        });
+
+        std::vector<std::string> changed;
+
+        for_each_line(current, [&](std::string_view l) {
+            const auto sep  = l.find('=');
+            const auto name = l.substr(0, sep);
+
+            auto itor = previous.find(name);
+            if (itor == previous.end() || itor->second != l.substr(sep + 1))
+                changed.emplace_back(name);
+        });
+
+        if (changed.empty())
+            return {};
+
+        return changed;
     }
 
 }  // namespace mob::tasks
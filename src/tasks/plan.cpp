@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "plan.h"
+#include "../core/history.h"
+#include "task.h"
+
+namespace mob {
+
+    build_plan& build_plan::instance()
+    {
+        static build_plan p;
+        return p;
+    }
+
+    void build_plan::enable()
+    {
+        enabled_ = true;
+    }
+
+    bool build_plan::enabled() const
+    {
+        return enabled_;
+    }
+
+    void build_plan::begin_phase(const std::string& task, std::string_view name,
+                                 std::vector<std::string> reasons)
+    {
+        std::scoped_lock lock(mutex_);
+
+        phase p;
+        p.name    = name;
+        p.run     = true;
+        p.reasons = std::move(reasons);
+
+        tasks_[task].phases.push_back(std::move(p));
+    }
+
+    void build_plan::add_reason(const std::string& task, std::string reason)
+    {
+        std::scoped_lock lock(mutex_);
+
+        auto itor = tasks_.find(task);
+        if (itor == tasks_.end() || itor->second.phases.empty())
+            return;
+
+        itor->second.phases.back().reasons.push_back(std::move(reason));
+    }
+
+    void build_plan::skip_phase(const std::string& task, std::string_view name,
+                                std::string reason)
+    {
+        std::scoped_lock lock(mutex_);
+
+        phase p;
+        p.name = name;
+        p.run  = false;
+        p.reasons.push_back(std::move(reason));
+
+        tasks_[task].phases.push_back(std::move(p));
+    }
+
+    void build_plan::add_process(const std::string& task, std::string cmd)
+    {
+        std::scoped_lock lock(mutex_);
+
+        auto itor = tasks_.find(task);
+
+        // processes can be started before the first phase, such as vcvars, by
+        // the global context or by threads from task::parallel(), which have
+        // their own context names
+        if (itor == tasks_.end() || itor->second.phases.empty()) {
+            if (task.empty())
+                global_processes_.push_back(std::move(cmd));
+            else
+                global_processes_.push_back("[" + task + "] " + cmd);
+        }
+        else {
+            itor->second.phases.back().processes.push_back(std::move(cmd));
+        }
+    }
+
+    nlohmann::json build_plan::to_json(const std::vector<task*>& top_level)
+    {
+        nlohmann::json json;
+        nlohmann::json tasks = nlohmann::json::array();
+
+        // top level tasks run sequentially, so their estimates add up
+        std::chrono::milliseconds total(0);
+        bool complete = true;
+
+        for (auto* t : top_level)
+            total += task_to_json(t, tasks, complete);
+
+        std::scoped_lock lock(mutex_);
+
+        json["version"]           = mob_version();
+        json["estimated_ms"]      = total.count();
+        json["estimate_complete"] = complete;
+        json["tasks"]             = std::move(tasks);
+        json["global_processes"]  = global_processes_;
+
+        return json;
+    }
+
+    std::chrono::milliseconds build_plan::task_to_json(task* t, nlohmann::json& out,
+                                                       bool& complete)
+    {
+        // parallel tasks take as long as their slowest child
+        if (auto* pt = dynamic_cast<parallel_tasks*>(t)) {
+            nlohmann::json children = nlohmann::json::array();
+            std::chrono::milliseconds longest(0);
+            bool children_complete = true;
+
+            for (auto* c : pt->children()) {
+                const auto d = task_to_json(c, children, children_complete);
+                longest      = std::max(longest, d);
+            }
+
+            if (children.empty())
+                return longest;
+
+            out.push_back({{"parallel", std::move(children)},
+                           {"estimated_ms", longest.count()},
+                           {"estimate_complete", children_complete}});
+
+            complete = complete && children_complete;
+            return longest;
+        }
+
+        // disabled tasks never report phases
+        task_plan tp;
+
+        {
+            std::scoped_lock lock(mutex_);
+
+            auto itor = tasks_.find(t->name());
+            if (itor == tasks_.end())
+                return std::chrono::milliseconds(0);
+
+            tp = itor->second;
+        }
+
+        auto& history = phase_history::instance();
+
+        nlohmann::json phases = nlohmann::json::array();
+        std::chrono::milliseconds total(0);
+        bool task_complete = true;
+
+        for (auto&& p : tp.phases) {
+            nlohmann::json jp = {{"name", p.name},
+                                 {"run", p.run},
+                                 {"reasons", p.reasons},
+                                 {"processes", p.processes}};
+
+            if (p.run) {
+                if (auto d = history.estimate(t->name(), p.name)) {
+                    jp["estimated_ms"] = d->count();
+                    total += *d;
+                }
+                else {
+                    // never ran, no idea
+                    jp["estimated_ms"] = nullptr;
+                    task_complete      = false;
+                }
+            }
+
+            phases.push_back(std::move(jp));
+        }
+
+        out.push_back({{"name", t->name()},
+                       {"phases", std::move(phases)},
+                       {"estimated_ms", total.count()},
+                       {"estimate_complete", task_complete}});
+
+        complete = complete && task_complete;
+        return total;
+    }
+
+}  // namespace mob
@@ -0,0 +1,83 @@
+#pragma once
+
+namespace mob {
+
+    class task;
+
+    // collects what a build would do without doing it, used by `build --plan`;
+    // singleton
+    //
+    // when enabled, the build runs in dry mode and tasks report the phases they
+    // would go through along with the reasons, while processes report their
+    // command lines instead of being spawned; durations are estimated from
+    // phase_history
+    //
+    class build_plan {
+    public:
+        static build_plan& instance();
+
+        // turns on recording, called by the build command for --plan
+        //
+        void enable();
+
+        // whether --plan was given
+        //
+        bool enabled() const;
+
+        // starts a new phase for the given task, processes added after this will
+        // be added to it
+        //
+        void begin_phase(const std::string& task, std::string_view phase,
+                         std::vector<std::string> reasons);
+
+        // adds a reason to the current phase of the given task, used by tasks that
+        // decide what to do based on the state of their files
+        //
+        void add_reason(const std::string& task, std::string reason);
+
+        // records a phase that will not run for the given task
+        //
+        void skip_phase(const std::string& task, std::string_view phase,
+                        std::string reason);
+
+        // records a process for the current phase of the given task; processes
+        // that are not started from a task are recorded under the global context
+        //
+        void add_process(const std::string& task, std::string cmd);
+
+        // builds the plan from the given top-level tasks, estimating durations
+        // for sequential and parallel tasks
+        //
+        nlohmann::json to_json(const std::vector<task*>& top_level);
+
+    private:
+        struct phase {
+            std::string name;
+            bool run = true;
+            std::vector<std::string> reasons;
+            std::vector<std::string> processes;
+        };
+
+        struct task_plan {
+            std::vector<phase> phases;
+        };
+
+        std::atomic<bool> enabled_{false};
+
+        // task name -> plan
+        std::map<std::string, task_plan, std::less<>> tasks_;
+
+        // processes started outside of tasks
+        std::vector<std::string> global_processes_;
+
+        mutable std::mutex mutex_;
+
+        // adds the given task to the json array, returns the estimated duration
+        // of the task, including children for parallel tasks; `complete` is set
+        // to false if a phase that will run has no history
+        //
+        std::chrono::milliseconds task_to_json(task* t, nlohmann::json& out,
+                                               bool& complete);
+    };
+
+}  // namespace mob
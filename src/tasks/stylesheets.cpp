@@ -45,6 +45,18 @@ namespace mob::tasks {
         return false;
     }
 
+    std::vector<fs::path> stylesheets::get_kept_paths() const
+    {
+        std::vector<fs::path> v;
+
+        for (auto&& r : releases()) {
+            v.push_back(release_build_path(r));
+            v.push_back(make_downloader_tool(r).result());
+        }
+
+        return v;
+    }
+
     void stylesheets::do_clean(clean c)
     {
         // delete download file for each release
@@ -66,12 +78,20 @@ namespace mob::tasks {
 
     void stylesheets::do_fetch()
     {
-        // download and extract file for each release
+        parallel_functions v;
+
+        // download and extract file for each release; they all have their own
+        // archive and directory, so they can run concurrently
         for (auto&& r : releases()) {
-            const auto file = run_tool(make_downloader_tool(r));
+            v.push_back({r.repo, [this, r] {
+                             const auto file = run_tool(make_downloader_tool(r));
 
-            run_tool(extractor().file(file).output(release_build_path(r)));
+                             run_tool(
+                                 extractor().file(file).output(release_build_path(r)));
+                         }});
         }
+
+        parallel(v);
     }
 
     fs::path stylesheets::release_build_path(const release& r) const
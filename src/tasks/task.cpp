@@ -1,9 +1,15 @@
 #include "pch.h"
 #include "task.h"
+#include "../core/checkpoint.h"
 #include "../core/conf.h"
+#include "../core/gc.h"
+#include "../core/history.h"
+#include "../core/metrics.h"
 #include "../core/op.h"
+#include "../core/throttle.h"
 #include "../tools/tools.h"
 #include "../utility/threading.h"
+#include "plan.h"
 #include "task_manager.h"
 
 namespace mob {
@@ -65,6 +71,48 @@ namespace mob {
         return c;
     }
 
+    // calls f() and records how long it took in the phase history and the
+    // metrics; nothing is recorded in dry mode, or if f() throws because the
+    // task bailed out or was interrupted
+    //
+    template <class F>
+    void timed_phase(const task& t, std::string_view phase, F&& f)
+    {
+        const auto start = hr_clock::now();
+
+        f();
+
+        if (conf().global().dry())
+            return;
+
+        using namespace std::chrono;
+
+        const auto d = hr_clock::now() - start;
+
+        phase_history::instance().record(t.name(), phase, d);
+
+        run_metrics::instance().set("mob_phase_duration_seconds",
+                                    {{"task", t.name()}, {"phase", std::string(phase)}},
+                                    duration_cast<duration<double>>(d).count());
+    }
+
+    // records a phase that will run in the build plan, if --plan was given
+    //
+    void plan_phase(const task& t, std::string_view phase,
+                    std::vector<std::string> reasons)
+    {
+        if (build_plan::instance().enabled())
+            build_plan::instance().begin_phase(t.name(), phase, std::move(reasons));
+    }
+
+    // records a phase that will not run in the build plan, if --plan was given
+    //
+    void plan_skip(const task& t, std::string_view phase, std::string reason)
+    {
+        if (build_plan::instance().enabled())
+            build_plan::instance().skip_phase(t.name(), phase, std::move(reason));
+    }
+
     task::task(std::vector<std::string> names)
         : names_(std::move(names)), bailed_(), interrupted_(false)
     {
@@ -257,6 +305,8 @@ namespace mob {
             gcx().error(context::generic, "{} bailed out, interrupting all tasks",
                         name());
 
+            run_metrics::instance().add("mob_task_failures_total", {{"task", name()}});
+
             task_manager::instance().interrupt_all();
         }
         catch (interrupted) {
@@ -272,9 +322,17 @@ namespace mob {
         for (auto&& [name, f] : v) {
             cx().trace(context::generic, "running in parallel: {}", name);
 
-            tp.add([this, name, f] {
+            const bool added = tp.add([this, name, f] {
                 running_from_thread(name, f);
             });
+
+            // the pool drops everything once mob is interrupted, the rest of
+            // the functions would be dropped too
+            if (!added) {
+                cx().trace(context::interruption, "interrupted, not starting {}",
+                           name);
+                break;
+            }
         }
     }
 
@@ -322,6 +380,16 @@ namespace mob {
         return false;
     }
 
+    std::vector<fs::path> task::get_kept_paths() const
+    {
+        const auto p = get_source_path();
+
+        if (p.empty())
+            return {};
+
+        return {p};
+    }
+
     void task::run()
     {
         // make sure there's a context for this thread; run() can be called from
@@ -335,6 +403,10 @@ namespace mob {
 
             cx().info(context::generic, "running task");
 
+            // for the garbage collector
+            if (const auto p = get_source_path(); !p.empty())
+                access_log::instance().touch(p);
+
             // clean task if needed
             clean_task();
             check_interrupted();
@@ -361,8 +433,10 @@ namespace mob {
 
     void task::clean_task()
     {
-        if (!conf().global().clean())
+        if (!conf().global().clean()) {
+            plan_skip(*this, "clean", "cleaning is disabled (--no-clean-task)");
             return;
+        }
 
         if (!enabled()) {
             cx().debug(context::generic, "cleaning (skipping, task disabled)");
@@ -372,31 +446,55 @@ namespace mob {
         const auto cf = make_clean_flags();
 
         if (cf != clean::nothing) {
+            if (phase_completed("clean"))
+                return;
+
             cx().info(context::rebuild, "cleaning ({})", to_string(cf));
-            do_clean(cf);
+            plan_phase(*this, "clean", {"clean flags: " + to_string(cf)});
+
+            timed_phase(*this, "clean", [&] {
+                do_clean(cf);
+            });
+
+            complete_phase("clean");
+        }
+        else {
+            plan_skip(*this, "clean", "no clean flags");
         }
     }
 
     void task::fetch()
     {
-        if (!conf().global().fetch())
+        if (!conf().global().fetch()) {
+            plan_skip(*this, "fetch", "fetching is disabled (--no-fetch-task)");
             return;
+        }
 
         if (!enabled()) {
             cx().debug(context::generic, "fetching (skipping, task disabled)");
             return;
         }
 
+        if (phase_completed("fetch"))
+            return;
+
         cx().info(context::generic, "fetching");
+        plan_phase(*this, "fetch", fetch_plan_reasons());
+
+        timed_phase(*this, "fetch", [&] {
+            do_fetch();
+        });
 
-        do_fetch();
         check_interrupted();
+        complete_phase("fetch");
     }
 
     void task::build_and_install()
     {
-        if (!conf().global().build())
+        if (!conf().global().build()) {
+            plan_skip(*this, "build", "building is disabled (--no-build-task)");
             return;
+        }
 
         if (!enabled()) {
             cx().debug(context::generic, "build and install (skipping, task disabled)");
@@ -404,11 +502,223 @@ namespace mob {
             return;
         }
 
+        if (phase_completed("build"))
+            return;
+
         cx().info(context::generic, "build and install");
-        do_build_and_install();
+        plan_phase(*this, "build", build_plan_reasons());
+
+        timed_phase(*this, "build", [&] {
+            do_build_and_install();
+        });
+
+        check_interrupted();
+        complete_phase("build");
+
         cx().info(context::generic, "done");
     }
 
+    // reads the given file from a .git directory, trimmed; empty if it doesn't
+    // exist
+    //
+    std::string read_git_file(const fs::path& p)
+    {
+        if (!fs::exists(p))
+            return {};
+
+        return trim_copy(
+            op::read_text_file(gcx(), encodings::utf8, p, op::optional));
+    }
+
+    // the .git directory of the given working tree, which is a file pointing to
+    // it for worktrees and submodules
+    //
+    fs::path git_dir(const fs::path& root)
+    {
+        const auto dot_git = root / ".git";
+        if (fs::is_directory(dot_git))
+            return dot_git;
+
+        constexpr std::string_view prefix = "gitdir:";
+
+        const auto s = read_git_file(dot_git);
+        if (!s.starts_with(prefix))
+            return dot_git;
+
+        const auto p = fs::path(utf8_to_utf16(trim_copy(s.substr(prefix.size()))));
+        return (p.is_relative() ? (root / p).lexically_normal() : p);
+    }
+
+    // adds what's checked out in the given working tree: HEAD, the commit of the
+    // ref it points to, the time of the index, which changes with checkouts and
+    // staging, and the time of every file that has changes
+    //
+    void add_git_state(fingerprint& fp, const fs::path& root)
+    {
+        const auto dir  = git_dir(root);
+        const auto head = read_git_file(dir / "HEAD");
+
+        fp.add(head);
+
+        constexpr std::string_view ref_prefix = "ref: ";
+
+        if (head.starts_with(ref_prefix)) {
+            const auto ref = head.substr(ref_prefix.size());
+
+            // refs are shared by all the worktrees of a repo
+            auto common = dir;
+            if (const auto c = read_git_file(dir / "commondir"); !c.empty())
+                common = (dir / utf8_to_utf16(c)).lexically_normal();
+
+            auto commit = read_git_file(dir / utf8_to_utf16(ref));
+            if (commit.empty())
+                commit = read_git_file(common / utf8_to_utf16(ref));
+
+            // not loose, the whole packed-refs is good enough
+            if (commit.empty())
+                commit = read_git_file(common / "packed-refs");
+
+            fp.add(commit);
+        }
+
+        std::error_code ec;
+        const auto index = fs::last_write_time(dir / "index", ec);
+        fp.add(ec ? "no index" : std::to_string(index.time_since_epoch().count()));
+
+        for (auto&& f : git_wrap(root).changed_files()) {
+            // build directories created by cmake, like vsbuild, vsbuild-Debug or
+            // usvfs' vsbuild64, show up as untracked in repos that don't ignore
+            // them and change on every build
+            if (f.starts_with("vsbuild"))
+                continue;
+
+            const auto t = fs::last_write_time(root / utf8_to_utf16(f), ec);
+
+            fp.add(f);
+            fp.add(ec ? "deleted" : std::to_string(t.time_since_epoch().count()));
+        }
+    }
+
+    bool task::phase_completed(std::string_view phase) const
+    {
+        auto& cp = checkpoints::instance();
+
+        if (!cp.recorded(name(), phase) ||
+            !cp.completed(name(), phase, checkpoint_fingerprint())) {
+            return false;
+        }
+
+        cx().info(context::bypass, "{} already completed in the last build, skipping",
+                  phase);
+
+        plan_skip(*this, phase, "completed in the last build, which was interrupted");
+
+        return true;
+    }
+
+    void task::complete_phase(std::string_view phase) const
+    {
+        auto& cp = checkpoints::instance();
+
+        if (cp.enabled())
+            cp.complete(name(), phase, checkpoint_fingerprint());
+    }
+
+    std::string task::checkpoint_inputs() const
+    {
+        return {};
+    }
+
+    std::string task::checkpoint_fingerprint() const
+    {
+        const auto p = get_source_path();
+
+        // tasks without a source directory, like stylesheets, only have the
+        // download cache, which they check themselves
+        if (p.empty())
+            return fingerprint().add(name()).hex();
+
+        fingerprint fp;
+        fp.add(path_to_utf8(p));
+
+        std::error_code ec;
+
+        if (fs::exists(p / ".git", ec)) {
+            // not the time of the directory itself: cmake creates the build
+            // directory in there, which would invalidate the fetch and clean
+            // checkpoints of a build interrupted while building; a new clone
+            // has a new index, so the git state catches that too
+            add_git_state(fp, p);
+        }
+        else {
+            // the time of the directory itself only changes when entries are
+            // added, removed or renamed in it
+            const auto t = fs::last_write_time(p, ec);
+            fp.add(ec ? "missing" : std::to_string(t.time_since_epoch().count()));
+        }
+
+        fp.add(checkpoint_inputs());
+
+        return fp.hex();
+    }
+
+    bool task::source_will_be_deleted() const
+    {
+        return conf().global().clean() &&
+               is_set(make_clean_flags(), clean::reextract);
+    }
+
+    std::vector<std::string> task::fetch_plan_reasons() const
+    {
+        const auto p = get_source_path();
+
+        // tasks that don't have a source directory, like stylesheets, download
+        // archives and rely on the cache
+        if (p.empty())
+            return {"fetching is enabled"};
+
+        if (source_will_be_deleted())
+            return {"source directory is deleted by --reextract"};
+
+        if (!fs::exists(p))
+            return {std::format("source directory {} is missing", path_to_utf8(p))};
+
+        if (task_conf().no_pull())
+            return {"source directory exists, no_pull is set"};
+
+        if (conf().global().offline())
+            return {"source directory exists, offline"};
+
+        return {"source directory exists, will be updated"};
+    }
+
+    std::vector<std::string> task::build_plan_reasons() const
+    {
+        std::vector<std::string> v;
+
+        const auto cf = conf().global().clean() ? make_clean_flags() : clean::nothing;
+
+        if (is_set(cf, clean::reconfigure))
+            v.push_back("reconfiguring because of --reconfigure");
+
+        if (is_set(cf, clean::rebuild))
+            v.push_back("rebuilding because of --rebuild");
+
+        const auto p = get_source_path();
+
+        if (!p.empty() && (source_will_be_deleted() || !fs::exists(p))) {
+            // dry runs can't know what the fetched files will contain, so
+            // processes that depend on them will be missing from the plan
+            v.push_back("source directory is missing, the build steps depend "
+                        "on what is fetched");
+        }
+
+        if (v.empty())
+            v.push_back("building is enabled");
+
+        return v;
+    }
+
     void task::check_bailed()
     {
         if (bailed_)
@@ -472,10 +782,14 @@ namespace mob {
 
     void parallel_tasks::run()
     {
-        // creates a thread for each child and calls run()
+        // creates a thread for each child and calls run() once the throttle
+        // admits it, unless mob was interrupted while it was waiting
         for (auto& t : children_)
             threads_.push_back(start_thread([&] {
-                t->run();
+                auto slot = throttle::instance().tasks().acquire(gcx());
+
+                if (!cancellation::global().cancelled())
+                    t->run();
             }));
 
         join();
@@ -70,7 +70,8 @@ namespace mob {
         // path to the source directory, something like prefix/build/7zip-xx or
         // or prefix/build/modorganizer_super/uibase
         //
-        // used for auto patching in fetch(), returns an empty path here
+        // used for auto patching in fetch() and for the build plan, returns an
+        // empty path here
         //
         virtual fs::path get_source_path() const;
 
@@ -80,6 +81,20 @@ namespace mob {
         //
         virtual bool get_prebuilt() const;
 
+        // paths this task keeps on disk between runs, such as downloaded
+        // archives; the garbage collector never deletes them while the task is
+        // enabled
+        //
+        // returns get_source_path() here, if it's not empty
+        //
+        virtual std::vector<fs::path> get_kept_paths() const;
+
+        // anything else that affects the build of this task and that's not in
+        // the source directory, added to the checkpoint fingerprint; empty by
+        // default
+        //
+        virtual std::string checkpoint_inputs() const;
+
         // if the task is enabled, calls fetch() and build_and_install()
         //
         virtual void run();
@@ -244,6 +259,33 @@ namespace mob {
         // --no-clean-task); no-op if the task is disabled
         //
         void clean_task();
+
+        // whether the clean phase will delete the source directory because of
+        // --reextract
+        //
+        bool source_will_be_deleted() const;
+
+        // returns true if the given phase already completed in the last build
+        // that was interrupted, see checkpoints
+        //
+        bool phase_completed(std::string_view phase) const;
+
+        // records the given phase as completed, see checkpoints
+        //
+        void complete_phase(std::string_view phase) const;
+
+        // fingerprint of the inputs of the task used by the checkpoints: whether
+        // the source directory exists and when it was last modified, the
+        // commit that's checked out, the index and the files with changes if
+        // it's a git repo, and checkpoint_inputs()
+        //
+        std::string checkpoint_fingerprint() const;
+
+        // reasons given in the build plan for the fetch and build phases, see
+        // build_plan
+        //
+        std::vector<std::string> fetch_plan_reasons() const;
+        std::vector<std::string> build_plan_reasons() const;
     };
 
     MOB_ENUM_OPERATORS(task::clean);
@@ -256,7 +298,8 @@ namespace mob {
     //
     // these functions don't make sense for some tasks (stylesheets, translations,
     // etc., but also modorganizer, since it's reused for all super projects), so
-    // these inherit directly from task, which has empty implementation for them
+    // these inherit directly from task, which has empty implementation for them;
+    // modorganizer overrides get_source_path() with its per-project directory
     //
     template <class Task>
     class basic_task : public task {
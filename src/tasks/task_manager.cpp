@@ -1,11 +1,43 @@
 #include "pch.h"
 #include "task_manager.h"
+#include "../core/conf.h"
 #include "../core/context.h"
+#include "../core/metrics.h"
+#include "../core/throttle.h"
 #include "task.h"
 
 namespace mob {
 
-    task_manager::task_manager() : interrupt_(false) {}
+    // converts the name to lowercase and underscores to dashes, which is what
+    // task::name_matches() considers equivalent
+    //
+    // the returned string_view points into a thread local buffer to avoid
+    // allocations, it's invalidated by the next call on the same thread
+    //
+    std::string_view normalize_task_name(std::string_view name)
+    {
+        static thread_local std::string buffer;
+
+        buffer.assign(name);
+
+        for (auto& c : buffer) {
+            if (c == '_')
+                c = '-';
+            else
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        return buffer;
+    }
+
+    // whether the pattern has a '*' and has to go through task::name_matches()
+    //
+    bool is_glob(std::string_view pattern)
+    {
+        return (pattern.find('*') != std::string_view::npos);
+    }
+
+    task_manager::task_manager() : frozen_(false), interrupt_(false) {}
 
     task_manager& task_manager::instance()
     {
@@ -20,9 +52,25 @@ namespace mob {
 
     void task_manager::register_task(task* t)
     {
+        MOB_ASSERT(!frozen_, "tasks cannot be added after freeze()");
         all_.push_back(t);
     }
 
+    void task_manager::freeze()
+    {
+        for (auto* t : all_) {
+            for (auto&& n : t->names()) {
+                auto& v = index_[std::string(normalize_task_name(n))];
+
+                // a task may have multiple names that are equivalent
+                if (v.empty() || v.back() != t)
+                    v.push_back(t);
+            }
+        }
+
+        frozen_ = true;
+    }
+
     std::vector<task*> task_manager::find(std::string_view pattern)
     {
         auto tasks = find_by_pattern(pattern);
@@ -81,6 +129,11 @@ namespace mob {
             return;
         }
 
+        // aliases come from the inis, which are loaded after the tasks have been
+        // added, so they can be expanded right away
+        if (frozen_)
+            alias_tasks_.emplace(name, expand_alias(names));
+
         aliases_.emplace(std::move(name), std::move(names));
     }
 
@@ -89,8 +142,12 @@ namespace mob {
         return aliases_;
     }
 
-    void task_manager::run_all()
+    bool task_manager::run_all()
     {
+        // tasks need most of the tools, find them all now instead of failing in
+        // the middle of the build
+        resolve_lazy_options();
+
         try {
             for (auto&& t : top_level_) {
                 t->run();
@@ -102,13 +159,35 @@ namespace mob {
         catch (interrupted&) {
         }
 
+        // every task has returned and their threads and processes are gone,
+        // this is how long it took to stop everything
+        const auto& c = cancellation::global();
+
+        if (c.cancelled()) {
+            const auto d = c.elapsed();
+
+            gcx().info(context::interruption,
+                       "all tasks stopped {}ms after interruption", d.count());
+
+            run_metrics::instance().set("mob_cancel_latency_seconds", {},
+                                        d.count() / 1000.0);
+        }
+
         for (auto&& t : top_level_) {
             t->check_bailed();
         }
+
+        // nothing bailed out, so the interruption came from sigint
+        return !interrupt_;
     }
 
     void task_manager::interrupt_all()
     {
+        // wakes up everything waiting on the global cancellation right away,
+        // before tasks are interrupted one by one below
+        cancellation::global().cancel();
+        throttle::instance().interrupt();
+
         // handles multiple tasks failing simultaneously
         std::scoped_lock lock(interrupt_mutex_);
 
@@ -121,6 +200,13 @@ namespace mob {
 
     std::vector<task*> task_manager::find_by_pattern(std::string_view pattern)
     {
+        if (frozen_ && !is_glob(pattern)) {
+            if (const auto* v = find_in_index(pattern))
+                return *v;
+
+            return {};
+        }
+
         std::vector<task*> tasks;
 
         for (auto&& t : all_) {
@@ -133,13 +219,27 @@ namespace mob {
 
     std::vector<task*> task_manager::find_by_alias(std::string_view alias_name)
     {
-        std::vector<task*> v;
+        if (frozen_) {
+            auto itor = alias_tasks_.find(alias_name);
+            if (itor == alias_tasks_.end())
+                return {};
+
+            return itor->second;
+        }
 
         auto itor = aliases_.find(alias_name);
         if (itor == aliases_.end())
-            return v;
+            return {};
+
+        return expand_alias(itor->second);
+    }
 
-        for (auto&& a : itor->second) {
+    std::vector<task*>
+    task_manager::expand_alias(const std::vector<std::string>& patterns)
+    {
+        std::vector<task*> v;
+
+        for (auto&& a : patterns) {
             const auto temp = find_by_pattern(a);
             v.insert(v.end(), temp.begin(), temp.end());
         }
@@ -147,15 +247,37 @@ namespace mob {
         return v;
     }
 
+    const std::vector<task*>* task_manager::find_in_index(std::string_view name) const
+    {
+        auto itor = index_.find(normalize_task_name(name));
+        if (itor == index_.end())
+            return nullptr;
+
+        return &itor->second;
+    }
+
     bool task_manager::valid_task_name(std::string_view pattern)
     {
-        if (!find(pattern).empty())
+        if (pattern == "_override")
             return true;
 
-        if (pattern == "_override")
+        if (!frozen_)
+            return !find(pattern).empty();
+
+        if (is_glob(pattern)) {
+            for (auto* t : all_) {
+                if (t->name_matches(pattern))
+                    return true;
+            }
+        }
+        else if (find_in_index(pattern)) {
             return true;
+        }
 
-        return false;
+        // aliases are only checked when the pattern doesn't match a task, same as
+        // find()
+        auto itor = alias_tasks_.find(pattern);
+        return (itor != alias_tasks_.end() && !itor->second.empty());
     }
 
 }  // namespace mob
@@ -32,6 +32,11 @@ namespace mob {
         //
         void register_task(task* t);
 
+        // called once all the tasks have been added, builds the name index used
+        // by find() and valid_task_name(); tasks cannot be registered after this
+        //
+        void freeze();
+
         // returns all tasks matching the glob
         //
         std::vector<task*> find(std::string_view pattern);
@@ -45,6 +50,9 @@ namespace mob {
         // whether the given pattern matches at least one task or is "_override",
         // should only be used when parsing inis or command line options
         //
+        // this is called for every task section in every ini, so it doesn't
+        // allocate once the manager is frozen
+        //
         bool valid_task_name(std::string_view pattern);
 
         // returns all tasks except for parallel_tasks
@@ -63,21 +71,51 @@ namespace mob {
         //
         const alias_map& aliases();
 
-        // runs all top-level tasks sequentially, disabled tasks won't run
+        // runs all top-level tasks sequentially, disabled tasks won't run; throws
+        // bailed if a task failed, returns false if the tasks were interrupted
+        // by sigint
         //
-        void run_all();
+        bool run_all();
 
         // interrupts all tasks
         //
         void interrupt_all();
 
     private:
+        // hashes strings and string_views the same way so the index below can be
+        // searched without creating a std::string
+        //
+        struct name_hash {
+            using is_transparent = void;
+
+            std::size_t operator()(std::string_view s) const
+            {
+                return std::hash<std::string_view>()(s);
+            }
+        };
+
+        // normalized name -> tasks, in registration order
+        using name_index = std::unordered_map<std::string, std::vector<task*>,
+                                              name_hash, std::equal_to<>>;
+
+        // map of alias -> tasks
+        using alias_tasks_map = std::map<std::string, std::vector<task*>, std::less<>>;
+
         // top-level tasks
         std::vector<std::unique_ptr<task>> top_level_;
 
         // all tasks except for parallel_tasks
         std::vector<task*> all_;
 
+        // all names of all tasks, built in freeze()
+        name_index index_;
+
+        // aliases expanded to their tasks, built in add_alias() once frozen
+        alias_tasks_map alias_tasks_;
+
+        // set in freeze()
+        bool frozen_;
+
         // set to true in interrupt_all(), checked in run_all() to stop the loop
         std::atomic<bool> interrupt_;
 
@@ -95,6 +133,16 @@ namespace mob {
         // matching tasks
         //
         std::vector<task*> find_by_alias(std::string_view alias_name);
+
+        // used by find_by_pattern() and valid_task_name() once frozen, returns
+        // the tasks having the given name, or null; the pattern must not be a
+        // glob
+        //
+        const std::vector<task*>* find_in_index(std::string_view name) const;
+
+        // used by find_by_alias(), expands the patterns of an alias
+        //
+        std::vector<task*> expand_alias(const std::vector<std::string>& patterns);
     };
 
     // convenience, calls task_manager::add()
@@ -19,6 +19,12 @@ namespace mob::tasks {
         static bool prebuilt();
         static fs::path source_path();
 
+        // url of the archive, also used by `bench-env`
+        //
+        static url source_url();
+
+        std::vector<fs::path> get_kept_paths() const override;
+
     protected:
         void do_clean(clean c) override;
         void do_fetch() override;
@@ -32,6 +38,10 @@ namespace mob::tasks {
         static std::string version();
         static fs::path source_path();
 
+        // url to the git repo
+        //
+        url git_url() const;
+
     protected:
         void do_clean(clean c) override;
         void do_fetch() override;
@@ -96,6 +106,36 @@ namespace mob::tasks {
         //
         fs::path source_path() const;
 
+        // forwards to source_path()
+        //
+        fs::path get_source_path() const override;
+
+        // where the project is installed, the install directory unless the task
+        // has mo_install set
+        //
+        fs::path install_path() const;
+
+        // where the given configuration is installed: install_path() for the
+        // main configuration, or a sibling directory with the configuration name
+        // appended for the others, like "install-Debug"
+        //
+        fs::path install_path(mob::config c) const;
+
+        // cmake's build directory for the project, "vsbuild" in source_path()
+        // unless the task has mo_build set
+        //
+        fs::path build_path() const;
+
+        // build directory of the given configuration: build_path() for the main
+        // configuration, or a sibling directory with the configuration name
+        // appended for the others, like "vsbuild-Debug"
+        //
+        fs::path build_path(mob::config c) const;
+
+        // configure_fingerprint() of every configuration
+        //
+        std::string checkpoint_inputs() const override;
+
     protected:
         void do_clean(clean c) override;
         void do_fetch() override;
@@ -104,6 +144,67 @@ namespace mob::tasks {
     private:
         std::string repo_;
         std::string project_;
+
+        // a cmake tool for the given operation on this project, with the root
+        // and the build directory of the given configuration set
+        //
+        cmake make_cmake(cmake::ops o, mob::config c) const;
+
+        // runs cmake for the given configuration in build_path(c) if anything
+        // in configure_fingerprint(c) changed since the last time
+        //
+        void configure(mob::config c);
+
+        // builds the given configuration with the given number of jobs and
+        // installs it in install_path(c), through a staging directory if
+        // `[global] stage_installs` is set
+        //
+        void build_configuration(mob::config c, std::size_t jobs);
+
+        // the cmake tool that configures the build tree of the given
+        // configuration, with the definitions of the given build profile, if any
+        //
+        cmake make_generate(const std::string& profile, mob::config c) const;
+
+        // definitions of the given build profile from [build-profiles], empty if
+        // `profile` is empty
+        //
+        std::vector<std::pair<std::string, std::string>>
+        profile_defs(const std::string& profile) const;
+
+        // configures and builds the project from scratch with each profile in
+        // its own build directory and logs the configure, compile, link and total
+        // times side by side; the project is not installed
+        //
+        void compare_profiles(const std::vector<std::string>& profiles);
+
+        // adds the time msbuild spent in the CL task to `compile` and in the
+        // Link and Lib tasks to `link`, from the performance summary in the
+        // given log file
+        //
+        void parse_task_times(const fs::path& log, std::chrono::milliseconds& compile,
+                              std::chrono::milliseconds& link) const;
+
+        // cmake_prefix_path(), but with install_path(c), the regular install
+        // directory of that configuration and install_path() first, for the ones
+        // that are not the regular install directory
+        //
+        std::string prefix_path(mob::config c) const;
+
+        // hashes everything that affects how cmake configures the build tree of
+        // the given configuration: cmake_common, the presets, CMAKE_PREFIX_PATH,
+        // the definitions given to cmake and the toolchain; returns one
+        // "name=hash" line per input
+        //
+        std::string configure_fingerprint(mob::config c) const;
+
+        // compares the fingerprint saved in `file` with `current`, returns an
+        // empty optional if nothing changed, an empty vector if there's no saved
+        // fingerprint or no cmake cache, or the names of the inputs that changed
+        //
+        std::optional<std::vector<std::string>>
+        changed_configure_inputs(const fs::path& file,
+                                 const std::string& current) const;
     };
 
     class stylesheets : public task {
@@ -120,6 +221,8 @@ namespace mob::tasks {
 
         static bool prebuilt();
 
+        std::vector<fs::path> get_kept_paths() const override;
+
     protected:
         void do_clean(clean c) override;
         void do_fetch() override;
@@ -216,6 +319,8 @@ namespace mob::tasks {
         translations();
         static fs::path source_path();
 
+        std::vector<fs::path> get_kept_paths() const override;
+
     protected:
         void do_clean(clean c) override;
         void do_fetch() override;
@@ -244,6 +349,10 @@ namespace mob::tasks {
         void fetch_from_source();
         void build_and_install_from_source();
 
+        // runs cmake for x64 and x86 concurrently
+        //
+        void configure_both_arches();
+
         cmake create_cmake_tool(arch, cmake::ops = cmake::generate) const;
         msbuild create_msbuild_tool(arch, msbuild::ops = msbuild::build,
                                     config = config::release) const;
@@ -184,6 +184,11 @@ namespace mob::tasks {
 
     translations::translations() : task("translations") {}
 
+    std::vector<fs::path> translations::get_kept_paths() const
+    {
+        return {source_path()};
+    }
+
     fs::path translations::source_path()
     {
         return conf().path().build() / "transifex-translations";
@@ -209,6 +214,21 @@ namespace mob::tasks {
         // 2) configure the tx directory so it knows the url
         // 3) pull translations from transifex
 
+        // translations can only come from transifex, but they don't change much,
+        // so whatever was pulled last time is good enough
+        if (conf().global().offline()) {
+            if (!exists(source_path() / "translations")) {
+                cx().bail_out(context::net,
+                              "offline, translations were never pulled into {}",
+                              source_path());
+            }
+
+            cx().trace(context::bypass, "offline, using translations in {}",
+                       source_path());
+
+            return;
+        }
+
         // api key
         const std::string key = conf().transifex().get("key");
 
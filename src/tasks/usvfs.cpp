@@ -40,10 +40,8 @@ namespace mob::tasks {
             return;
         }
 
-        if (is_set(c, clean::reconfigure)) {
-            run_tool(create_cmake_tool(arch::x64));
-            run_tool(create_cmake_tool(arch::x86));
-        }
+        if (is_set(c, clean::reconfigure))
+            configure_both_arches();
 
         if (is_set(c, clean::rebuild)) {
             // msbuild clean
@@ -74,14 +72,31 @@ namespace mob::tasks {
 
     void usvfs::build_and_install_from_source()
     {
-        run_tool(create_cmake_tool(arch::x64));
-        run_tool(create_cmake_tool(arch::x86));
+        configure_both_arches();
+
+        // both builds install into the same directories, so they're not run
+        // concurrently
         run_tool(create_msbuild_tool(arch::x64, msbuild::build,
                                      task_conf().configuration()));
         run_tool(create_msbuild_tool(arch::x86, msbuild::build,
                                      task_conf().configuration()));
     }
 
+    void usvfs::configure_both_arches()
+    {
+        parallel_functions v;
+
+        // each arch has its own build directory, so cmake can run for both at the
+        // same time
+        for (const auto a : {arch::x64, arch::x86}) {
+            v.push_back({a == arch::x64 ? "usvfs-x64" : "usvfs-x86", [this, a] {
+                             run_tool(create_cmake_tool(a));
+                         }});
+        }
+
+        parallel(v);
+    }
+
     cmake usvfs::create_cmake_tool(arch a, cmake::ops o) const
     {
         return std::move(
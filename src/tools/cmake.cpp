@@ -29,6 +29,11 @@ namespace mob {
         return conf().tool().get("cmake");
     }
 
+    std::string cmake::configuration_name(mob::config c)
+    {
+        return config_to_string(c);
+    }
+
     cmake& cmake::generator(generators g)
     {
         gen_ = g;
@@ -185,6 +190,10 @@ namespace mob {
 
         if (!preset_.empty()) {
             p = p.arg("--preset").arg(preset_);
+
+            // overrides the binary directory of the preset
+            if (!output_.empty())
+                p = p.arg("-B").arg(output_);
         }
 
         if (!config_types_.empty()) {
@@ -253,19 +262,28 @@ namespace mob {
             p = p.arg("--target").arg(target);
         }
 
+        // such as --parallel
+        p.args(args_);
+
         execute_and_join(p);
     }
 
     void cmake::do_install()
     {
-        execute_and_join(process()
-                             .stdout_encoding(encodings::utf8)
-                             .stderr_encoding(encodings::utf8)
-                             .binary(binary())
-                             .arg("--install")
-                             .arg(build_path())
-                             .arg("--config")
-                             .arg(config_to_string(config_)));
+        auto p = process()
+                     .stdout_encoding(encodings::utf8)
+                     .stderr_encoding(encodings::utf8)
+                     .binary(binary())
+                     .arg("--install")
+                     .arg(build_path())
+                     .arg("--config")
+                     .arg(config_to_string(config_));
+
+        // overrides CMAKE_INSTALL_PREFIX from the generate step
+        if (!prefix_.empty())
+            p.arg("--prefix").arg(prefix_);
+
+        execute_and_join(p);
     }
 
     void cmake::do_clean()
@@ -12,6 +12,10 @@ namespace mob {
         //
         static fs::path binary();
 
+        // name of the given configuration, such as "RelWithDebInfo"
+        //
+        static std::string configuration_name(mob::config c);
+
         // type of build files generated
         //
         enum class generators {
@@ -80,10 +84,13 @@ namespace mob {
         //
         // if generator() was called with a string, output() must be called
         //
+        // with preset(), this overrides the binary directory of the preset
+        //
         cmake& output(const fs::path& p);
 
         // if not empty, the path is passed to cmake with
-        // `-DCMAKE_INSTALL_PREFIX=path`
+        // `-DCMAKE_INSTALL_PREFIX=path` when generating, or with `--prefix` when
+        // installing
         //
         cmake& prefix(const fs::path& s);
 
@@ -1,8 +1,36 @@
 #include "pch.h"
+#include "../core/gc.h"
+#include "../core/metrics.h"
+#include "../core/single_flight.h"
 #include "tools.h"
 
 namespace mob {
 
+    // tasks that download the same file at the same time, like prebuilt assets
+    // sharing the cache directory, wait on the first one instead of writing to
+    // the same file; keyed on the output path
+    //
+    static single_flight<fs::path> g_downloads("downloads");
+
+    // with `[global] download_mirror`, `scheme://host/path` is downloaded from
+    // `<mirror>/host/path` instead
+    //
+    mob::url mirrored_url(const mob::url& u)
+    {
+        std::string mirror = conf().global().get("download_mirror");
+        if (mirror.empty())
+            return u;
+
+        const auto& s   = u.string();
+        const auto sep  = s.find("://");
+        const auto rest = (sep == std::string::npos ? s : s.substr(sep + 3));
+
+        if (!mirror.ends_with("/"))
+            mirror += "/";
+
+        return mirror + rest;
+    }
+
     downloader::downloader(ops o) : tool("dl"), op_(o) {}
 
     downloader::downloader(mob::url u, ops o) : downloader(o)
@@ -24,6 +52,10 @@ namespace mob {
 
     fs::path downloader::result() const
     {
+        // before run(), this is where the first url would be downloaded
+        if (file_.empty() && !urls_.empty())
+            return path_for_url(urls_[0]);
+
         return file_;
     }
 
@@ -47,23 +79,55 @@ namespace mob {
     }
 
     void downloader::do_download()
+    {
+        file_ = g_downloads.run(cx(), path_to_utf8(result()), [&] {
+            do_download_impl();
+            return file_;
+        });
+    }
+
+    void downloader::do_download_impl()
     {
         dl_.reset(new curl_downloader(&cx()));
 
         cx().trace(context::net, "looking for already downloaded files");
         if (use_existing()) {
             cx().trace(context::bypass, "using {}", file_);
+            access_log::instance().touch(file_);
+
+            run_metrics::instance().add("mob_cache_lookups_total",
+                                        {{"cache", "downloads"}, {"result", "hit"}});
+
             return;
         }
 
+        run_metrics::instance().add("mob_cache_lookups_total",
+                                    {{"cache", "downloads"}, {"result", "miss"}});
+
+        if (conf().global().offline()) {
+            cx().bail_out(context::net,
+                          "offline and nothing was found in the cache for {}",
+                          file_.empty() ? path_for_url(urls_[0]) : file_);
+        }
+
+        const auto urls = ordered_urls();
+
         cx().trace(context::net, "no cached downloads were found, will try:");
-        for (auto&& u : urls_)
+        for (auto&& u : urls)
             cx().trace(context::net, "  . {}", u);
 
         // try them in order
-        for (auto&& u : urls_) {
+        for (auto&& u : urls) {
+            // don't start the next mirror if the previous one was interrupted
+            if (interrupted())
+                break;
+
+            if (&u != &urls.front())
+                run_metrics::instance().add("mob_download_retries_total");
+
             if (try_download(u)) {
                 // done
+                access_log::instance().touch(file_);
                 return;
             }
         }
@@ -83,9 +147,11 @@ namespace mob {
         if (file_.empty())
             file_ = path_for_url(u);
 
-        // downloading
-        cx().trace(context::net, "trying {} into {}", u, file_);
-        dl_->start(u, file_);
+        // downloading, the output file is still named after the original url
+        const auto from = mirrored_url(u);
+
+        cx().trace(context::net, "trying {} into {}", from, file_);
+        dl_->start(from, file_);
 
         cx().trace(context::net, "waiting for download");
         dl_->join();
@@ -100,6 +166,20 @@ namespace mob {
         return false;
     }
 
+    std::vector<mob::url> downloader::ordered_urls() const
+    {
+        std::vector<mob::url> urls = urls_;
+
+        // a host that didn't work for another download will probably not work
+        // now either, but keep it as a last resort
+        std::stable_partition(urls.begin(), urls.end(), [&](auto&& u) {
+            const auto s = net_stats::instance().get(u.host());
+            return (!s || s->failures < s->transfers);
+        });
+
+        return urls;
+    }
+
     void downloader::do_clean()
     {
         if (file_.empty()) {
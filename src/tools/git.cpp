@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "../core/conf.h"
+#include "../core/metrics.h"
 #include "../core/process.h"
+#include "../core/single_flight.h"
 #include "../utility/threading.h"
 #include "tools.h"
 
@@ -96,6 +98,30 @@ namespace mob::details {
             .cwd(root);
     }
 
+    [[nodiscard]] process add_worktree(const fs::path& root, const fs::path& path,
+                                       const std::string& what)
+    {
+        return make_process()
+            .arg("-c", "advice.detachedHead=false")
+            .arg("worktree")
+            .arg("add")
+            .arg("-q")
+            .arg("--detach")
+            .arg(path, process::forward_slashes)
+            .arg(what)
+            .cwd(root);
+    }
+
+    [[nodiscard]] process remove_worktree(const fs::path& root, const fs::path& path)
+    {
+        return make_process()
+            .arg("worktree")
+            .arg("remove")
+            .arg("--force")
+            .arg(path, process::forward_slashes)
+            .cwd(root);
+    }
+
     [[nodiscard]] process current_branch(const fs::path& root)
     {
         return make_process()
@@ -166,6 +192,17 @@ namespace mob::details {
             .cwd(root);
     }
 
+    [[nodiscard]] process has_branch(const fs::path& root, const std::string& name)
+    {
+        return make_process()
+            .flags(process::allow_failure)
+            .arg("show-ref")
+            .arg("--quiet")
+            .arg("refs/heads/" + name)
+            .arg("refs/remotes/origin/" + name)
+            .cwd(root);
+    }
+
     [[nodiscard]] process rename_remote(const fs::path& root, const std::string& from,
                                         const std::string& to)
     {
@@ -226,16 +263,28 @@ namespace mob::details {
             .cwd(root);
     }
 
-    [[nodiscard]] process remote_branch_exists(const mob::url& url,
-                                               const std::string& branch)
+    [[nodiscard]] process remote_head(const mob::url& url, const std::string& branch)
     {
         return make_process()
             .flags(process::allow_failure)
+            .stdout_flags(process::keep_in_string)
             .arg("ls-remote")
             .arg("--exit-code")
-            .arg("--heads")
             .arg(url)
-            .arg(branch);
+            .arg("refs/heads/" + branch);
+    }
+
+    [[nodiscard]] process is_ancestor_of_head(const fs::path& root,
+                                              const std::string& commit)
+    {
+        return make_process()
+            .flags(process::allow_failure)
+            .stderr_level(context::level::debug)
+            .arg("merge-base")
+            .arg("--is-ancestor")
+            .arg(commit)
+            .arg("HEAD")
+            .cwd(root);
     }
 
     [[nodiscard]] process has_uncommitted_changes(const fs::path& root)
@@ -409,6 +458,14 @@ namespace mob {
         return (run(details::has_remote(root_, name)) == 0);
     }
 
+    bool git_wrap::has_branch(const std::string& name)
+    {
+        if (!fs::exists(root_ / ".git"))
+            return false;
+
+        return (run(details::has_branch(root_, name)) == 0);
+    }
+
     void git_wrap::add_remote(
         const std::string& remote_name, const std::string& username,
         const std::string& key, bool push_default,
@@ -449,6 +506,16 @@ namespace mob {
         run(details::checkout(root_, what));
     }
 
+    void git_wrap::add_worktree(const fs::path& path, const std::string& what)
+    {
+        run(details::add_worktree(root_, path, what));
+    }
+
+    void git_wrap::remove_worktree(const fs::path& path)
+    {
+        run(details::remove_worktree(root_, path));
+    }
+
     std::string git_wrap::current_branch()
     {
         auto p = details::current_branch(root_);
@@ -533,9 +600,121 @@ namespace mob {
         return (run(details::is_repo(root_)) == 0);
     }
 
+    // remote heads resolved by git_wrap::remote_head(), keyed on url and branch;
+    // an empty optional means the branch doesn't exist or ls-remote failed
+    //
+    static std::map<std::string, std::optional<std::string>> g_remote_heads;
+    static std::mutex g_remote_heads_mutex;
+
+    // parallel tasks checking the same branch at the same time, such as
+    // installer and modorganizer looking for a release branch, run ls-remote once
+    //
+    static single_flight<std::optional<std::string>> g_remote_head_flights(
+        "remote heads");
+
+    std::string remote_head_key(const mob::url& u, const std::string& branch)
+    {
+        return u.string() + " " + branch;
+    }
+
+    // returns the commit from the output of `ls-remote`, which is something like
+    // "8b2b4f0c...\trefs/heads/master"
+    //
+    std::optional<std::string> parse_remote_head(process& p)
+    {
+        if (p.exit_code() != 0)
+            return {};
+
+        const auto out = p.stdout_string();
+        const auto tab = out.find('\t');
+
+        if (tab == std::string::npos || tab == 0)
+            return {};
+
+        return out.substr(0, tab);
+    }
+
     bool git_wrap::remote_branch_exists(const mob::url& u, const std::string& name)
     {
-        return (details::remote_branch_exists(u, name).run_and_join() == 0);
+        const auto head = remote_head(u, name);
+
+        // dry runs don't start processes, assume the branch exists
+        return (head || conf().global().dry());
+    }
+
+    std::optional<std::string> git_wrap::remote_head(const mob::url& u,
+                                                     const std::string& branch)
+    {
+        if (conf().global().offline()) {
+            gcx().bail_out(context::net, "offline, cannot check if {} has branch {}",
+                           u, branch);
+        }
+
+        if (conf().global().dry())
+            return {};
+
+        const auto key = remote_head_key(u, branch);
+
+        return g_remote_head_flights.run(gcx(), key, [&] {
+            // checked from within the flight, a call that just finished has
+            // already cached its result
+            {
+                std::scoped_lock lock(g_remote_heads_mutex);
+
+                auto itor = g_remote_heads.find(key);
+                if (itor != g_remote_heads.end())
+                    return itor->second;
+            }
+
+            auto p = details::remote_head(u, branch);
+            p.run_and_join();
+
+            auto head = parse_remote_head(p);
+
+            std::scoped_lock lock(g_remote_heads_mutex);
+            g_remote_heads.emplace(key, head);
+
+            return head;
+        });
+    }
+
+    void git_wrap::resolve_remote_heads(
+        const std::vector<std::pair<mob::url, std::string>>& v)
+    {
+        if (conf().global().dry() || conf().global().offline())
+            return;
+
+        std::vector<std::pair<std::string, process>> ps;
+
+        {
+            std::scoped_lock lock(g_remote_heads_mutex);
+
+            for (auto&& [u, branch] : v) {
+                auto key = remote_head_key(u, branch);
+
+                if (!g_remote_heads.contains(key))
+                    ps.emplace_back(std::move(key), details::remote_head(u, branch));
+            }
+        }
+
+        gcx().debug(context::net, "resolving {} remote heads", ps.size());
+
+        // the output of ls-remote for a single branch is tiny and won't fill the
+        // pipes, so all processes can be started before joining them in order
+        for (auto&& [key, p] : ps)
+            p.run();
+
+        for (auto&& [key, p] : ps) {
+            p.join();
+
+            std::scoped_lock lock(g_remote_heads_mutex);
+            g_remote_heads.emplace(key, parse_remote_head(p));
+        }
+    }
+
+    bool git_wrap::head_contains(const std::string& commit)
+    {
+        return (run(details::is_ancestor_of_head(root_, commit)) == 0);
     }
 
     bool git_wrap::has_uncommitted_changes()
@@ -545,6 +724,34 @@ namespace mob {
         return (p.stdout_string() != "");
     }
 
+    std::vector<std::string> git_wrap::changed_files()
+    {
+        auto p = details::has_uncommitted_changes(root_);
+        run(p);
+
+        std::vector<std::string> v;
+
+        // lines are "XY path", or "XY old -> new" for renames; paths with
+        // special characters are quoted
+        for_each_line(p.stdout_string(), [&](std::string_view line) {
+            if (line.size() < 4)
+                return;
+
+            auto path = line.substr(3);
+
+            const auto arrow = path.find(" -> ");
+            if (arrow != std::string_view::npos)
+                path = path.substr(arrow + 4);
+
+            if (path.size() > 1 && path.front() == '"' && path.back() == '"')
+                path = path.substr(1, path.size() - 2);
+
+            v.emplace_back(path);
+        });
+
+        return v;
+    }
+
     bool git_wrap::has_stashed_changes()
     {
         auto p = details::has_stashed_changes(root_);
@@ -648,6 +855,11 @@ namespace mob {
             return false;
         }
 
+        if (conf().global().offline()) {
+            cx().bail_out(context::net, "offline, cannot clone {} into {}", url_,
+                          root_);
+        }
+
         git_wrap g(root_, this);
 
         g.clone(url_, branch_, shallow_);
@@ -668,8 +880,30 @@ namespace mob {
 
     void git::do_pull()
     {
+        if (conf().global().offline()) {
+            cx().trace(context::bypass, "offline, not pulling {}", root_);
+            return;
+        }
+
         git_wrap g(root_, this);
 
+        // when the remote branch is already merged, the pull would be a no-op, so
+        // don't bother reverting .ts files and fetching
+        if (const auto head = git_wrap::remote_head(url_, branch_)) {
+            if (g.head_contains(*head)) {
+                cx().trace(context::bypass, "{} is up to date with {} {}", root_,
+                           url_, branch_);
+
+                run_metrics::instance().add("mob_cache_lookups_total",
+                                            {{"cache", "git_pull"}, {"result", "hit"}});
+
+                return;
+            }
+        }
+
+        run_metrics::instance().add("mob_cache_lookups_total",
+                                    {{"cache", "git_pull"}, {"result", "miss"}});
+
         if (revert_ts_)
             g.revert_ts();
 
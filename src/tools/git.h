@@ -84,6 +84,12 @@ namespace mob {
         //
         bool has_remote(const std::string& name);
 
+        // returns whether the given branch exists in the clone, either as a local
+        // branch or as a branch from origin; used instead of
+        // remote_branch_exists() in offline mode
+        //
+        bool has_branch(const std::string& name);
+
         // adds a remote from github, no-op if it already exists
         //
         // remote_name:  name of the new remote
@@ -150,6 +156,15 @@ namespace mob {
         //
         void checkout(const std::string& what);
 
+        // runs `git worktree add --detach path what`, creates a new working tree
+        // at `path` that shares the objects of this repo
+        //
+        void add_worktree(const fs::path& path, const std::string& what);
+
+        // runs `git worktree remove --force path`
+        //
+        void remove_worktree(const fs::path& path);
+
         // runs `git submodule add` for the given branch submodule and url
         //
         void add_submodule(const std::string& branch, const std::string& submodule,
@@ -174,6 +189,11 @@ namespace mob {
         //
         bool has_stashed_changes();
 
+        // paths of the files listed by `git status`: modified, staged, deleted
+        // and untracked ones, relative to the root
+        //
+        std::vector<std::string> changed_files();
+
         // used by various tasks to delete a directory that was created by pulling
         // from git
         //
@@ -190,8 +210,31 @@ namespace mob {
         // sure the branch exists in all repos before starting the build so it
         // doesn't fail in the middle
         //
+        // bails out in offline mode
+        //
         static bool remote_branch_exists(const mob::url& u, const std::string& name);
 
+        // runs `git ls-remote` to get the commit at the tip of the given branch,
+        // returns an empty optional if the branch doesn't exist or if ls-remote
+        // failed; results are cached for the whole run
+        //
+        // bails out in offline mode
+        //
+        static std::optional<std::string> remote_head(const mob::url& u,
+                                                      const std::string& branch);
+
+        // runs `git ls-remote` concurrently for all the given urls and branches
+        // that haven't been resolved yet and caches the results for remote_head()
+        // and remote_branch_exists(); no-op in dry or offline mode
+        //
+        static void
+        resolve_remote_heads(const std::vector<std::pair<mob::url, std::string>>& v);
+
+        // whether the given commit is HEAD or one of its ancestors, which is
+        // false if the commit was never fetched
+        //
+        bool head_contains(const std::string& commit);
+
     private:
         // git root directory, from constructor
         fs::path root_;
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "../core/conf.h"
 #include "../core/process.h"
+#include "../core/throttle.h"
 #include "tools.h"
 
 namespace mob {
@@ -31,6 +32,9 @@ namespace mob {
         // use this tool's log context for the process
         p.set_context(&cx());
 
+        // wait until the system can take another process
+        auto slot = throttle::instance().processes().acquire(cx());
+
         // run, remember the code because the process object might be destroyed
         code_ = p.run_and_join();
 
@@ -240,6 +240,10 @@ namespace mob {
 
     void transifex::do_run()
     {
+        // init only creates the .tx directory
+        if (op_ != init && conf().global().offline())
+            cx().bail_out(context::net, "offline, transifex needs the network");
+
         switch (op_) {
         case init:
             do_init();
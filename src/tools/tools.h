@@ -194,10 +194,15 @@ namespace mob {
         //
         void do_clean();
 
-        // downloads a file to the output path
+        // downloads a file to the output path, or waits for another downloader
+        // that's already downloading the same file
         //
         void do_download();
 
+        // called by do_download() when nothing else is downloading the file
+        //
+        void do_download_impl();
+
         // generates an output path for the given url
         //
         fs::path path_for_url(const mob::url& u) const;
@@ -210,6 +215,11 @@ namespace mob {
         // tries to download the given url, returns whether it succeeded
         //
         bool try_download(const mob::url& u);
+
+        // urls_ in the order they should be tried: hosts that only failed
+        // during this run are moved to the end, see net_stats
+        //
+        std::vector<mob::url> ordered_urls() const;
     };
 
     // base class for tools that run processes
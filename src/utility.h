@@ -1,9 +1,13 @@
 #pragma once
 
 #include "utility/algo.h"
+#include "utility/alloc.h"
+#include "utility/delta.h"
 #include "utility/enum.h"
 #include "utility/fs.h"
+#include "utility/hash.h"
 #include "utility/io.h"
+#include "utility/pe.h"
 #include "utility/string.h"
 #include "utility/threading.h"
 
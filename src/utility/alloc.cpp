@@ -0,0 +1,246 @@
+#include "pch.h"
+#include "alloc.h"
+#include "../core/context.h"
+
+#ifdef MOB_MIMALLOC
+#include <mimalloc.h>
+#endif
+
+namespace mob {
+
+#ifdef MOB_ALLOC_STATS
+    constexpr bool count_allocations = true;
+#else
+    constexpr bool count_allocations = false;
+#endif
+
+#ifdef MOB_MIMALLOC
+    constexpr bool use_mimalloc = true;
+#else
+    constexpr bool use_mimalloc = false;
+#endif
+
+    // counters for one tag; these can be used by operator new during static
+    // initialization, so they must not need a constructor to run
+    //
+    struct alloc_counters {
+        std::atomic<std::uint64_t> count = 0;
+        std::atomic<std::uint64_t> bytes = 0;
+    };
+
+    constexpr std::size_t tag_count = static_cast<std::size_t>(alloc_tag::count);
+
+    constinit thread_local alloc_tag g_tag = alloc_tag::other;
+    constinit std::array<alloc_counters, tag_count> g_counters;
+
+    const char* tag_name(alloc_tag t)
+    {
+        switch (t) {
+        case alloc_tag::other:
+            return "other";
+        case alloc_tag::process:
+            return "process";
+        case alloc_tag::log:
+            return "log";
+        case alloc_tag::conf:
+            return "conf";
+        case alloc_tag::threading:
+            return "threading";
+        case alloc_tag::count:
+        default:
+            return "?";
+        }
+    }
+
+    void* allocate(std::size_t n, std::size_t align) noexcept
+    {
+        // new must return a unique pointer even for 0 bytes
+        if (n == 0)
+            n = 1;
+
+        if constexpr (count_allocations) {
+            auto& c = g_counters[static_cast<std::size_t>(g_tag)];
+            c.count.fetch_add(1, std::memory_order_relaxed);
+            c.bytes.fetch_add(n, std::memory_order_relaxed);
+        }
+
+#ifdef MOB_MIMALLOC
+        return mi_malloc_aligned(n, align);
+#else
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return _aligned_malloc(n, align);
+
+        return std::malloc(n);
+#endif
+    }
+
+    void deallocate(void* p, std::size_t align) noexcept
+    {
+#ifdef MOB_MIMALLOC
+        (void)align;
+        mi_free(p);
+#else
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            _aligned_free(p);
+        else
+            std::free(p);
+#endif
+    }
+
+    void* allocate_or_throw(std::size_t n, std::size_t align)
+    {
+        if (void* p = allocate(n, align))
+            return p;
+
+        throw std::bad_alloc();
+    }
+
+    alloc_scope::alloc_scope(alloc_tag t) : previous_(g_tag)
+    {
+        g_tag = t;
+    }
+
+    alloc_scope::~alloc_scope()
+    {
+        g_tag = previous_;
+    }
+
+    void log_counters()
+    {
+        // logging allocates, take a copy first
+        std::array<std::pair<std::uint64_t, std::uint64_t>, tag_count> v;
+
+        for (std::size_t i = 0; i < tag_count; ++i)
+            v[i] = {g_counters[i].count.load(), g_counters[i].bytes.load()};
+
+        gcx().info(context::generic, "allocations:");
+
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            if (v[i].first == 0)
+                continue;
+
+            gcx().info(context::generic, "  {}: count={} bytes={} average={}",
+                       tag_name(static_cast<alloc_tag>(i)), v[i].first, v[i].second,
+                       v[i].second / v[i].first);
+        }
+    }
+
+    void log_alloc_stats()
+    {
+        gcx().debug(context::generic, "allocator: {}",
+                    use_mimalloc ? "mimalloc" : "crt");
+
+        if constexpr (count_allocations)
+            log_counters();
+    }
+
+}  // namespace mob
+
+// operator new and delete are only replaced when they have to be, the crt's own
+// are used otherwise, including its debug heap
+//
+#if defined(MOB_ALLOC_STATS) || defined(MOB_MIMALLOC)
+
+constexpr std::size_t default_align = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+void* operator new(std::size_t n)
+{
+    return mob::allocate_or_throw(n, default_align);
+}
+
+void* operator new[](std::size_t n)
+{
+    return mob::allocate_or_throw(n, default_align);
+}
+
+void* operator new(std::size_t n, std::align_val_t a)
+{
+    return mob::allocate_or_throw(n, static_cast<std::size_t>(a));
+}
+
+void* operator new[](std::size_t n, std::align_val_t a)
+{
+    return mob::allocate_or_throw(n, static_cast<std::size_t>(a));
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+    return mob::allocate(n, default_align);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+    return mob::allocate(n, default_align);
+}
+
+void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+    return mob::allocate(n, static_cast<std::size_t>(a));
+}
+
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+    return mob::allocate(n, static_cast<std::size_t>(a));
+}
+
+void operator delete(void* p) noexcept
+{
+    mob::deallocate(p, default_align);
+}
+
+void operator delete[](void* p) noexcept
+{
+    mob::deallocate(p, default_align);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    mob::deallocate(p, default_align);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    mob::deallocate(p, default_align);
+}
+
+void operator delete(void* p, std::align_val_t a) noexcept
+{
+    mob::deallocate(p, static_cast<std::size_t>(a));
+}
+
+void operator delete[](void* p, std::align_val_t a) noexcept
+{
+    mob::deallocate(p, static_cast<std::size_t>(a));
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t a) noexcept
+{
+    mob::deallocate(p, static_cast<std::size_t>(a));
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t a) noexcept
+{
+    mob::deallocate(p, static_cast<std::size_t>(a));
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    mob::deallocate(p, default_align);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    mob::deallocate(p, default_align);
+}
+
+void operator delete(void* p, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+    mob::deallocate(p, static_cast<std::size_t>(a));
+}
+
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+    mob::deallocate(p, static_cast<std::size_t>(a));
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+namespace mob {
+
+    // subsystems that allocations are attributed to, see alloc_scope
+    //
+    enum class alloc_tag {
+        // anything outside of a scope
+        other = 0,
+
+        // reading the output of processes and splitting it into lines
+        process,
+
+        // formatting and writing log lines
+        log,
+
+        // looking up options
+        conf,
+
+        // handing functions to threads
+        threading,
+
+        // number of tags
+        count
+    };
+
+    // attributes the allocations made by the current thread to the given tag
+    // until it's destroyed, then restores the previous one; scopes can be nested
+    //
+    // allocations are only counted when mob is built with MOB_ALLOC_STATS, see
+    // log_alloc_stats(), this just sets a thread local otherwise
+    //
+    class alloc_scope {
+    public:
+        alloc_scope(alloc_tag t);
+        ~alloc_scope();
+
+        // non-copyable
+        alloc_scope(const alloc_scope&)            = delete;
+        alloc_scope& operator=(const alloc_scope&) = delete;
+
+    private:
+        alloc_tag previous_;
+    };
+
+    // logs which allocator operator new uses and, when built with
+    // MOB_ALLOC_STATS, the number of allocations and bytes allocated for every
+    // tag since mob started
+    //
+    void log_alloc_stats();
+
+}  // namespace mob
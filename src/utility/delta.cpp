@@ -0,0 +1,294 @@
+#include "pch.h"
+#include "delta.h"
+#include "../utility.h"
+
+namespace mob {
+
+    constexpr std::string_view delta_magic = "MOBDELTA";
+
+    // only this many blocks of the old file are remembered for a given checksum,
+    // files with large runs of identical blocks, like zero padding, would
+    // otherwise make every lookup compare against all of them
+    //
+    constexpr std::size_t max_candidates = 8;
+
+    void append_u64(std::string& s, std::uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            s += static_cast<char>((v >> (i * 8)) & 0xff);
+    }
+
+    // reads a little-endian 64-bit integer and advances `pos`, returns empty if
+    // it's out of bounds
+    //
+    std::optional<std::uint64_t> read_u64(std::string_view s, std::size_t& pos)
+    {
+        if (pos > s.size() || s.size() - pos < 8)
+            return {};
+
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            v |= std::uint64_t(static_cast<unsigned char>(s[pos + i])) << (i * 8);
+
+        pos += 8;
+        return v;
+    }
+
+    // rsync's weak checksum: `a` is the sum of the bytes in the window and `b`
+    // the sum of the `a` for every prefix of the window, both can be updated in
+    // constant time when the window slides by one byte
+    //
+    class rolling_checksum {
+    public:
+        rolling_checksum(std::string_view window) : size_(window.size())
+        {
+            for (std::size_t i = 0; i < window.size(); ++i) {
+                const auto c = static_cast<unsigned char>(window[i]);
+                a_ += c;
+                b_ += static_cast<std::uint32_t>(window.size() - i) * c;
+            }
+        }
+
+        // slides the window by one byte, `out` is the byte that leaves it and
+        // `in` the one that enters it; overflows wrap, which is fine
+        //
+        void roll(char out, char in)
+        {
+            const auto o = static_cast<unsigned char>(out);
+            const auto i = static_cast<unsigned char>(in);
+
+            a_ = a_ - o + i;
+            b_ = b_ - static_cast<std::uint32_t>(size_) * o + a_;
+        }
+
+        std::uint32_t value() const { return (a_ & 0xffff) | (b_ << 16); }
+
+    private:
+        std::size_t size_;
+        std::uint32_t a_ = 0;
+        std::uint32_t b_ = 0;
+    };
+
+    // accumulates operations, merging consecutive ones of the same kind
+    //
+    class delta_writer {
+    public:
+        delta_writer(std::string_view new_bytes) : new_(new_bytes) {}
+
+        // bytes [begin, end) of the new file are literals
+        //
+        void literal(std::size_t begin, std::size_t end)
+        {
+            if (begin == end)
+                return;
+
+            flush_copy();
+
+            if (lit_end_ != begin) {
+                flush_literal();
+                lit_begin_ = begin;
+            }
+
+            lit_end_ = end;
+        }
+
+        // `length` bytes are copied from `offset` in the old file
+        //
+        void copy(std::size_t offset, std::size_t length)
+        {
+            flush_literal();
+
+            if (copy_length_ > 0 && copy_offset_ + copy_length_ == offset) {
+                copy_length_ += length;
+                return;
+            }
+
+            flush_copy();
+            copy_offset_ = offset;
+            copy_length_ = length;
+        }
+
+        std::string finish()
+        {
+            flush_literal();
+            flush_copy();
+            return std::move(out_);
+        }
+
+        std::string& out() { return out_; }
+
+    private:
+        std::string_view new_;
+        std::string out_;
+        std::size_t lit_begin_   = 0;
+        std::size_t lit_end_     = 0;
+        std::size_t copy_offset_ = 0;
+        std::size_t copy_length_ = 0;
+
+        void flush_literal()
+        {
+            if (lit_begin_ == lit_end_)
+                return;
+
+            out_ += 'L';
+            append_u64(out_, lit_end_ - lit_begin_);
+            out_.append(new_.substr(lit_begin_, lit_end_ - lit_begin_));
+
+            lit_begin_ = lit_end_ = 0;
+        }
+
+        void flush_copy()
+        {
+            if (copy_length_ == 0)
+                return;
+
+            out_ += 'C';
+            append_u64(out_, copy_offset_);
+            append_u64(out_, copy_length_);
+
+            copy_length_ = 0;
+        }
+    };
+
+    std::string make_delta(std::string_view old_bytes, std::string_view new_bytes,
+                           std::size_t block_size)
+    {
+        MOB_ASSERT(block_size > 0);
+
+        delta_writer w(new_bytes);
+
+        w.out().append(delta_magic);
+        append_u64(w.out(), old_bytes.size());
+        append_u64(w.out(), new_bytes.size());
+
+        // index of the full blocks of the old file by checksum
+        std::unordered_map<std::uint32_t, std::vector<std::size_t>> index;
+
+        for (std::size_t off = 0; off + block_size <= old_bytes.size();
+             off += block_size) {
+            const auto sum = rolling_checksum(old_bytes.substr(off, block_size));
+            auto& v        = index[sum.value()];
+
+            if (v.size() < max_candidates)
+                v.push_back(off);
+        }
+
+        if (index.empty() || new_bytes.size() < block_size) {
+            w.literal(0, new_bytes.size());
+            return w.finish();
+        }
+
+        std::size_t pos     = 0;
+        std::size_t pending = 0;
+
+        auto sum = rolling_checksum(new_bytes.substr(0, block_size));
+
+        while (pos + block_size <= new_bytes.size()) {
+            std::optional<std::size_t> match;
+
+            auto itor = index.find(sum.value());
+
+            if (itor != index.end()) {
+                const auto window = new_bytes.substr(pos, block_size);
+
+                for (const auto off : itor->second) {
+                    if (old_bytes.substr(off, block_size) == window) {
+                        match = off;
+                        break;
+                    }
+                }
+            }
+
+            if (!match) {
+                // slide by one byte
+                if (pos + block_size < new_bytes.size())
+                    sum.roll(new_bytes[pos], new_bytes[pos + block_size]);
+
+                ++pos;
+                continue;
+            }
+
+            // extend the match as far as the bytes are the same
+            std::size_t length = block_size;
+
+            while (*match + length < old_bytes.size() &&
+                   pos + length < new_bytes.size() &&
+                   old_bytes[*match + length] == new_bytes[pos + length]) {
+                ++length;
+            }
+
+            w.literal(pending, pos);
+            w.copy(*match, length);
+
+            pos += length;
+            pending = pos;
+
+            if (pos + block_size <= new_bytes.size())
+                sum = rolling_checksum(new_bytes.substr(pos, block_size));
+        }
+
+        w.literal(pending, new_bytes.size());
+
+        return w.finish();
+    }
+
+    std::optional<std::string> apply_delta(std::string_view old_bytes,
+                                           std::string_view delta)
+    {
+        if (!delta.starts_with(delta_magic))
+            return {};
+
+        std::size_t pos = delta_magic.size();
+
+        const auto old_size = read_u64(delta, pos);
+        const auto new_size = read_u64(delta, pos);
+
+        if (!old_size || !new_size || *old_size != old_bytes.size())
+            return {};
+
+        // a corrupted size could be anything, the operations can't produce more
+        // than the size of both files unless the same bytes are copied more than
+        // once, which is rare enough to not reserve for
+        std::string out;
+        out.reserve(static_cast<std::size_t>(
+            std::min<std::uint64_t>(*new_size, old_bytes.size() + delta.size())));
+
+        while (pos < delta.size()) {
+            const char op = delta[pos++];
+
+            if (op == 'C') {
+                const auto offset = read_u64(delta, pos);
+                const auto length = read_u64(delta, pos);
+
+                if (!offset || !length || *offset > old_bytes.size() ||
+                    old_bytes.size() - *offset < *length ||
+                    *new_size - out.size() < *length) {
+                    return {};
+                }
+
+                out.append(old_bytes.substr(static_cast<std::size_t>(*offset),
+                                            static_cast<std::size_t>(*length)));
+            }
+            else if (op == 'L') {
+                const auto length = read_u64(delta, pos);
+
+                if (!length || delta.size() - pos < *length ||
+                    *new_size - out.size() < *length) {
+                    return {};
+                }
+
+                out.append(delta.substr(pos, static_cast<std::size_t>(*length)));
+                pos += static_cast<std::size_t>(*length);
+            }
+            else {
+                return {};
+            }
+        }
+
+        if (out.size() != *new_size)
+            return {};
+
+        return out;
+    }
+
+}  // namespace mob
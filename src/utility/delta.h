@@ -0,0 +1,38 @@
+#pragma once
+
+namespace mob {
+
+    // binary deltas between two versions of a file, used by `release` to ship
+    // only what changed in large binaries
+    //
+    // the format is meant to be trivial to apply, all integers are 64-bit little
+    // endian:
+    //   - the magic "MOBDELTA", followed by the sizes of the old and new files;
+    //   - a list of operations until the end of the delta, each one starting
+    //     with a byte:
+    //       'C' offset length: copies `length` bytes from the old file, starting
+    //                          at `offset`;
+    //       'L' length bytes:  `length` literal bytes follow.
+    //
+    // applying the operations in order produces the new file
+    //
+    // matches are found like rsync does: the old file is split into blocks that
+    // are indexed by a rolling checksum, which is then computed at every offset
+    // of the new file; matches are extended past the end of the block as long as
+    // the bytes are the same, so an unchanged region of any size becomes a single
+    // copy, even if it moved
+    //
+
+    // creates a delta that turns `old_bytes` into `new_bytes`; smaller blocks
+    // find more matches but use more memory for the index
+    //
+    std::string make_delta(std::string_view old_bytes, std::string_view new_bytes,
+                           std::size_t block_size = 4096);
+
+    // applies the given delta to `old_bytes`, returns empty if the delta is
+    // invalid or was made from a file with a different size
+    //
+    std::optional<std::string> apply_delta(std::string_view old_bytes,
+                                           std::string_view delta);
+
+}  // namespace mob
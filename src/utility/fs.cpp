@@ -22,6 +22,66 @@ namespace mob {
         return dir / name;
     }
 
+    mapped_file::~mapped_file()
+    {
+        if (view_)
+            ::UnmapViewOfFile(view_);
+    }
+
+    bool mapped_file::open(const fs::path& p, DWORD& error)
+    {
+        // other processes may have the file open for writing or deleting, like
+        // a build writing a log, which shouldn't prevent reading it
+        HANDLE f = ::CreateFileW(
+            p.native().c_str(), GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if (f == INVALID_HANDLE_VALUE) {
+            error = GetLastError();
+            return false;
+        }
+
+        file_.reset(f);
+
+        LARGE_INTEGER size = {};
+        if (!::GetFileSizeEx(f, &size)) {
+            error = GetLastError();
+            return false;
+        }
+
+        // CreateFileMapping() fails for empty files
+        if (size.QuadPart == 0)
+            return true;
+
+        HANDLE m = ::CreateFileMappingW(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m) {
+            error = GetLastError();
+            return false;
+        }
+
+        mapping_.reset(m);
+
+        const void* v = ::MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+        if (!v) {
+            error = GetLastError();
+            return false;
+        }
+
+        view_ = static_cast<const char*>(v);
+        size_ = static_cast<std::size_t>(size.QuadPart);
+
+        return true;
+    }
+
+    std::string_view mapped_file::bytes() const
+    {
+        if (!view_)
+            return {};
+
+        return {view_, size_};
+    }
+
     file_deleter::file_deleter(const context& cx, fs::path p)
         : cx_(cx), p_(std::move(p)), delete_(true)
     {
@@ -30,6 +30,35 @@ namespace mob {
 
     using file_ptr = std::unique_ptr<FILE, file_closer>;
 
+    // a read-only view of a whole file mapped in memory, unmapped in the
+    // destructor
+    //
+    // this avoids copying the content of a file into a string before parsing it,
+    // see op::read_text_file() and op::read_text_lines()
+    //
+    class mapped_file {
+    public:
+        mapped_file() = default;
+        mapped_file(const mapped_file&)            = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        ~mapped_file();
+
+        // maps the given file, returns false and sets `error` on failure; empty
+        // files are never actually mapped and have an empty view
+        //
+        bool open(const fs::path& p, DWORD& error);
+
+        // content of the file, empty if open() wasn't called or failed
+        //
+        std::string_view bytes() const;
+
+    private:
+        handle_ptr file_;
+        handle_ptr mapping_;
+        const char* view_ = nullptr;
+        std::size_t size_ = 0;
+    };
+
     // deletes the given file in the destructor unless cancel() is called
     //
     class file_deleter {
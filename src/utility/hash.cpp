@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "hash.h"
+#include "../utility.h"
+
+namespace mob {
+
+    constexpr std::uint64_t fnv_offset = 14695981039346656037ull;
+    constexpr std::uint64_t fnv_prime  = 1099511628211ull;
+
+    fingerprint::fingerprint() : h_(fnv_offset) {}
+
+    fingerprint& fingerprint::add(std::string_view s)
+    {
+        for (const char c : s) {
+            h_ ^= static_cast<unsigned char>(c);
+            h_ *= fnv_prime;
+        }
+
+        // separator so that add("ab") + add("c") is different from add("a") +
+        // add("bc")
+        h_ ^= 0xff;
+        h_ *= fnv_prime;
+
+        return *this;
+    }
+
+    fingerprint& fingerprint::add_file(const fs::path& p)
+    {
+        mapped_file mf;
+        DWORD e = 0;
+
+        if (!mf.open(p, e))
+            return add(path_to_utf8(p));
+
+        return add(mf.bytes());
+    }
+
+    fingerprint& fingerprint::add_tree(const fs::path& dir)
+    {
+        if (!fs::exists(dir))
+            return add(path_to_utf8(dir));
+
+        std::vector<fs::path> files;
+
+        for (auto itor = fs::recursive_directory_iterator(dir);
+             itor != fs::recursive_directory_iterator(); ++itor) {
+            const auto& e = *itor;
+
+            if (e.is_directory()) {
+                if (path_to_utf8(e.path().filename()).starts_with("."))
+                    itor.disable_recursion_pending();
+
+                continue;
+            }
+
+            files.push_back(e.path());
+        }
+
+        // directory iteration order is unspecified
+        std::sort(files.begin(), files.end());
+
+        for (auto&& f : files) {
+            add(path_to_utf8(fs::relative(f, dir)));
+            add_file(f);
+        }
+
+        return *this;
+    }
+
+    std::string fingerprint::hex() const
+    {
+        return std::format("{:016x}", h_);
+    }
+
+    std::optional<std::string> sha256(std::string_view bytes)
+    {
+        BCRYPT_ALG_HANDLE alg = nullptr;
+        const auto r =
+            ::BCryptOpenAlgorithmProvider(&alg, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
+
+        if (!BCRYPT_SUCCESS(r))
+            return {};
+
+        BCRYPT_HASH_HANDLE h = nullptr;
+        std::array<unsigned char, 32> digest;
+
+        bool ok =
+            BCRYPT_SUCCESS(::BCryptCreateHash(alg, &h, nullptr, 0, nullptr, 0, 0));
+
+        // BCryptHashData() takes a ULONG, large files are hashed in chunks
+        constexpr std::size_t chunk = 64 * 1024 * 1024;
+
+        for (std::size_t i = 0; ok && i < bytes.size(); i += chunk) {
+            const auto n = std::min(chunk, bytes.size() - i);
+
+            ok = BCRYPT_SUCCESS(::BCryptHashData(
+                h, reinterpret_cast<PUCHAR>(const_cast<char*>(bytes.data() + i)),
+                static_cast<ULONG>(n), 0));
+        }
+
+        if (ok) {
+            ok = BCRYPT_SUCCESS(::BCryptFinishHash(
+                h, digest.data(), static_cast<ULONG>(digest.size()), 0));
+        }
+
+        if (h)
+            ::BCryptDestroyHash(h);
+
+        ::BCryptCloseAlgorithmProvider(alg, 0);
+
+        if (!ok)
+            return {};
+
+        std::string s;
+        for (const auto b : digest)
+            s += std::format("{:02x}", b);
+
+        return s;
+    }
+
+}  // namespace mob
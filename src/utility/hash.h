@@ -0,0 +1,47 @@
+#pragma once
+
+namespace mob {
+
+    // a 64-bit fnv-1a hash that can be fed strings, files and directory trees,
+    // used to detect whether the inputs of an operation changed since the last
+    // time it ran
+    //
+    // this is not cryptographic at all, but it's fast and stable across runs and
+    // compilers, unlike std::hash
+    //
+    class fingerprint {
+    public:
+        fingerprint();
+
+        // hashes the given bytes
+        //
+        fingerprint& add(std::string_view s);
+
+        // hashes the content of the given file, or just its path if it doesn't
+        // exist or can't be read
+        //
+        fingerprint& add_file(const fs::path& p);
+
+        // hashes the relative path and content of every file in the given
+        // directory, recursively, in a stable order; directories starting with a
+        // dot, like .git, are skipped
+        //
+        fingerprint& add_tree(const fs::path& dir);
+
+        // the hash as 16 hex characters
+        //
+        std::string hex() const;
+
+    private:
+        std::uint64_t h_;
+    };
+
+    // sha-256 of the given bytes as 64 lowercase hex characters, computed by
+    // bcrypt; returns an empty optional if bcrypt failed
+    //
+    // unlike fingerprint, this is meant for hashes that other programs must be
+    // able to check, like the ones in release manifests
+    //
+    std::optional<std::string> sha256(std::string_view bytes);
+
+}  // namespace mob
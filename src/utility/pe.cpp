@@ -0,0 +1,339 @@
+#include "pch.h"
+#include "pe.h"
+
+namespace mob {
+
+    // reads a little-endian T at the given offset, returns empty if it's out of
+    // bounds
+    //
+    template <class T>
+    std::optional<T> read_at(std::string_view bytes, std::size_t offset)
+    {
+        if (offset > bytes.size() || bytes.size() - offset < sizeof(T))
+            return {};
+
+        T t;
+        std::memcpy(&t, bytes.data() + offset, sizeof(T));
+        return t;
+    }
+
+    // converts an rva to a file offset by finding the section that contains it
+    //
+    std::optional<std::size_t> rva_to_offset(std::string_view bytes,
+                                             std::size_t sections,
+                                             std::uint16_t section_count,
+                                             std::uint32_t rva)
+    {
+        // section header:
+        //   8 bytes name, 4 virtual size, 4 virtual address, 4 raw size,
+        //   4 raw pointer, ...
+        const std::size_t section_header_size = 40;
+
+        for (std::uint16_t i = 0; i < section_count; ++i) {
+            const std::size_t s = sections + i * section_header_size;
+
+            const auto vsize = read_at<std::uint32_t>(bytes, s + 8);
+            const auto va    = read_at<std::uint32_t>(bytes, s + 12);
+            const auto raw   = read_at<std::uint32_t>(bytes, s + 20);
+
+            if (!vsize || !va || !raw)
+                return {};
+
+            if (rva >= *va && rva - *va < *vsize)
+                return std::size_t(*raw) + (rva - *va);
+        }
+
+        return {};
+    }
+
+    // parses a codeview 7.0 record: "RSDS", 16 bytes guid, 4 bytes age, then
+    // the pdb path as a null-terminated string
+    //
+    bool parse_codeview(std::string_view bytes, std::size_t offset,
+                        std::uint32_t size, pe_info& info)
+    {
+        const std::size_t header_size = 4 + 16 + 4;
+
+        if (size < header_size || offset > bytes.size() ||
+            bytes.size() - offset < size) {
+            return false;
+        }
+
+        const auto record = bytes.substr(offset, size);
+        if (!record.starts_with("RSDS"))
+            return false;
+
+        pdb_id id;
+        std::memcpy(id.guid.data(), record.data() + 4, id.guid.size());
+        id.age = *read_at<std::uint32_t>(record, 20);
+
+        auto path = record.substr(header_size);
+        path      = path.substr(0, path.find('\0'));
+
+        info.pdb      = id;
+        info.pdb_path = std::string(path);
+
+        return true;
+    }
+
+    std::optional<pe_info> parse_pe(std::string_view bytes)
+    {
+        // dos header, e_lfanew is the offset of the pe signature
+        if (!bytes.starts_with("MZ"))
+            return {};
+
+        const auto pe = read_at<std::uint32_t>(bytes, 0x3c);
+        if (!pe)
+            return {};
+
+        const auto sig = read_at<std::uint32_t>(bytes, *pe);
+        if (!sig || *sig != 0x00004550)  // "PE\0\0"
+            return {};
+
+        // coff header:
+        //   2 bytes machine, 2 section count, 4 timestamp, 4 symbol table,
+        //   4 symbol count, 2 optional header size, 2 characteristics
+        const std::size_t coff = *pe + 4;
+
+        const auto section_count = read_at<std::uint16_t>(bytes, coff + 2);
+        const auto timestamp     = read_at<std::uint32_t>(bytes, coff + 4);
+        const auto opt_size      = read_at<std::uint16_t>(bytes, coff + 16);
+
+        if (!section_count || !timestamp || !opt_size)
+            return {};
+
+        // optional header, the layout depends on pe32 or pe32+
+        const std::size_t opt = coff + 20;
+
+        const auto magic      = read_at<std::uint16_t>(bytes, opt);
+        const auto image_size = read_at<std::uint32_t>(bytes, opt + 56);
+
+        if (!magic || !image_size)
+            return {};
+
+        std::size_t dirs = 0;
+
+        if (*magic == 0x10b)  // pe32
+            dirs = opt + 92;
+        else if (*magic == 0x20b)  // pe32+
+            dirs = opt + 108;
+        else
+            return {};
+
+        pe_info info;
+        info.timestamp  = *timestamp;
+        info.image_size = *image_size;
+
+        // data directories, preceded by their count; the debug directory is
+        // the 7th entry and each entry is 4 bytes rva and 4 bytes size
+        const std::uint32_t debug_index = 6;
+
+        const auto dir_count = read_at<std::uint32_t>(bytes, dirs);
+        if (!dir_count || *dir_count <= debug_index)
+            return info;
+
+        const std::size_t debug_dir = dirs + 4 + debug_index * 8;
+
+        const auto debug_rva  = read_at<std::uint32_t>(bytes, debug_dir);
+        const auto debug_size = read_at<std::uint32_t>(bytes, debug_dir + 4);
+
+        if (!debug_rva || !debug_size || *debug_rva == 0)
+            return info;
+
+        const std::size_t sections = opt + *opt_size;
+
+        const auto debug = rva_to_offset(bytes, sections, *section_count, *debug_rva);
+
+        if (!debug)
+            return info;
+
+        // debug directory entries:
+        //   4 bytes characteristics, 4 timestamp, 2 major, 2 minor, 4 type,
+        //   4 data size, 4 data rva, 4 data file offset
+        const std::size_t entry_size      = 28;
+        const std::uint32_t codeview_type = 2;
+
+        for (std::size_t i = 0; i < *debug_size / entry_size; ++i) {
+            const std::size_t e = *debug + i * entry_size;
+
+            const auto type   = read_at<std::uint32_t>(bytes, e + 12);
+            const auto size   = read_at<std::uint32_t>(bytes, e + 16);
+            const auto offset = read_at<std::uint32_t>(bytes, e + 24);
+
+            if (!type || !size || !offset)
+                break;
+
+            if (*type != codeview_type)
+                continue;
+
+            if (parse_codeview(bytes, *offset, *size, info))
+                break;
+        }
+
+        return info;
+    }
+
+    // reads the given stream from a pdb, `dir` is the stream directory and
+    // `block_size` comes from the superblock
+    //
+    // returns empty if the stream doesn't exist or has blocks out of bounds,
+    // `max` can be used to only read the beginning of the stream
+    //
+    std::optional<std::string> read_pdb_stream(std::string_view bytes,
+                                               std::string_view dir,
+                                               std::uint32_t block_size,
+                                               std::uint32_t stream,
+                                               std::size_t max)
+    {
+        // stream directory:
+        //   4 bytes stream count, 4 bytes size for each stream, then the block
+        //   indices of every stream, one after the other
+        const auto count = read_at<std::uint32_t>(dir, 0);
+        if (!count || stream >= *count)
+            return {};
+
+        const auto blocks_for = [&](std::uint32_t size) {
+            // unused streams have a size of -1 and no blocks
+            if (size == 0xffffffff)
+                return std::size_t(0);
+
+            return (std::size_t(size) + block_size - 1) / block_size;
+        };
+
+        // skip the blocks of all the streams before this one
+        std::size_t block_list = 4 + std::size_t(*count) * 4;
+
+        for (std::uint32_t i = 0; i < stream; ++i) {
+            const auto size = read_at<std::uint32_t>(dir, 4 + i * 4);
+            if (!size)
+                return {};
+
+            block_list += blocks_for(*size) * 4;
+        }
+
+        const auto size = read_at<std::uint32_t>(dir, 4 + stream * 4);
+        if (!size || *size == 0xffffffff)
+            return {};
+
+        const std::size_t wanted = std::min<std::size_t>(*size, max);
+
+        std::string s;
+        s.reserve(wanted);
+
+        for (std::size_t i = 0; s.size() < wanted; ++i) {
+            const auto block = read_at<std::uint32_t>(dir, block_list + i * 4);
+            if (!block)
+                return {};
+
+            const std::size_t offset = std::size_t(*block) * block_size;
+            if (offset >= bytes.size())
+                return {};
+
+            const std::size_t n = std::min<std::size_t>(block_size, wanted - s.size());
+            s.append(bytes.substr(offset, n));
+        }
+
+        if (s.size() < wanted)
+            return {};
+
+        return s;
+    }
+
+    std::optional<pdb_id> parse_pdb(std::string_view bytes)
+    {
+        static constexpr std::string_view magic("Microsoft C/C++ MSF 7.00\r\n\x1a"
+                                                "DS\0\0\0",
+                                                32);
+
+        if (!bytes.starts_with(magic))
+            return {};
+
+        // superblock, after the magic:
+        //   4 bytes block size, 4 free block map, 4 block count,
+        //   4 directory size, 4 unknown, 4 block of the directory block map
+        const auto block_size = read_at<std::uint32_t>(bytes, 32);
+        const auto dir_size   = read_at<std::uint32_t>(bytes, 44);
+        const auto map_block  = read_at<std::uint32_t>(bytes, 52);
+
+        if (!block_size || !dir_size || !map_block || *block_size == 0)
+            return {};
+
+        // the directory can't be larger than the file, this would reserve
+        // gigabytes below for a corrupted file
+        if (*dir_size > bytes.size())
+            return {};
+
+        // the block map is a list of the blocks containing the stream directory
+        const std::size_t map = std::size_t(*map_block) * *block_size;
+        const std::size_t dir_blocks =
+            (std::size_t(*dir_size) + *block_size - 1) / *block_size;
+
+        std::string dir;
+        dir.reserve(*dir_size);
+
+        for (std::size_t i = 0; i < dir_blocks; ++i) {
+            const auto block = read_at<std::uint32_t>(bytes, map + i * 4);
+            if (!block)
+                return {};
+
+            const std::size_t offset = std::size_t(*block) * *block_size;
+            if (offset >= bytes.size())
+                return {};
+
+            const std::size_t n =
+                std::min<std::size_t>(*block_size, *dir_size - dir.size());
+
+            dir.append(bytes.substr(offset, n));
+        }
+
+        // pdb info stream:
+        //   4 bytes version, 4 signature, 4 age, 16 guid
+        const std::uint32_t info_stream = 1;
+
+        const auto info = read_pdb_stream(bytes, dir, *block_size, info_stream, 28);
+        if (!info || info->size() < 28)
+            return {};
+
+        pdb_id id;
+        id.age = *read_at<std::uint32_t>(*info, 8);
+        std::memcpy(id.guid.data(), info->data() + 12, id.guid.size());
+
+        // the age in the info stream is bumped every time the pdb is written,
+        // but binaries use the age from the dbi stream:
+        //   4 bytes signature, 4 version, 4 age
+        const std::uint32_t dbi_stream = 3;
+
+        const auto dbi = read_pdb_stream(bytes, dir, *block_size, dbi_stream, 12);
+        if (dbi && dbi->size() >= 12)
+            id.age = *read_at<std::uint32_t>(*dbi, 8);
+
+        return id;
+    }
+
+    std::string pdb_id::key() const
+    {
+        // the first three parts of the guid are little-endian integers, the
+        // rest are bytes
+        std::uint32_t data1 = 0;
+        std::uint16_t data2 = 0, data3 = 0;
+
+        std::memcpy(&data1, guid.data(), 4);
+        std::memcpy(&data2, guid.data() + 4, 2);
+        std::memcpy(&data3, guid.data() + 6, 2);
+
+        std::string s = std::format("{:08X}{:04X}{:04X}", data1, data2, data3);
+
+        for (std::size_t i = 8; i < guid.size(); ++i)
+            s += std::format("{:02X}", guid[i]);
+
+        s += std::format("{:X}", age);
+
+        return s;
+    }
+
+    std::string pe_info::key() const
+    {
+        return std::format("{:08X}{:x}", timestamp, image_size);
+    }
+
+}  // namespace mob
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace mob {
+
+    // identifies a pdb in a symbol store, this is the guid and age found in the
+    // codeview record of a binary, which must match the ones in the pdb itself
+    //
+    struct pdb_id {
+        std::array<std::uint8_t, 16> guid = {};
+        std::uint32_t age                = 0;
+
+        // the guid in uppercase hex without dashes followed by the age in hex,
+        // this is the name of the directory in a symbol store, such as
+        // `ModOrganizer.pdb/<key>/ModOrganizer.pdb`
+        //
+        std::string key() const;
+    };
+
+    // information about a PE binary (exe, dll, pyd, etc.) needed to put it and
+    // its pdb in a symbol store
+    //
+    struct pe_info {
+        // from the coff header
+        std::uint32_t timestamp = 0;
+
+        // from the optional header
+        std::uint32_t image_size = 0;
+
+        // from the codeview record in the debug directory, if any
+        std::optional<pdb_id> pdb;
+
+        // path of the pdb given to the linker, from the codeview record
+        std::string pdb_path;
+
+        // the timestamp as 8 uppercase hex digits followed by the image size in
+        // hex, this is the name of the directory in a symbol store, such as
+        // `ModOrganizer.exe/<key>/ModOrganizer.exe`
+        //
+        std::string key() const;
+    };
+
+    // parses the headers and debug directory of a PE binary, returns empty if
+    // the bytes are not a valid PE file; a binary without a codeview record is
+    // valid, but its `pdb` member will be empty
+    //
+    // this doesn't use any system api and can be given the bytes of a file
+    // from any source
+    //
+    std::optional<pe_info> parse_pe(std::string_view bytes);
+
+    // parses the msf 7.0 container of a pdb file and returns the guid from the
+    // pdb info stream and the age from the dbi stream, returns empty if the
+    // bytes are not a valid pdb
+    //
+    std::optional<pdb_id> parse_pdb(std::string_view bytes);
+
+}  // namespace mob
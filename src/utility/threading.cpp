@@ -184,14 +184,60 @@ namespace mob {
         std::set_terminate(mob::terminate_handler);
     }
 
+    cancellation::cancellation()
+        : cancelled_(false), time_(0),
+          event_(::CreateEventW(nullptr, TRUE, FALSE, nullptr))
+    {
+    }
+
+    cancellation& cancellation::global()
+    {
+        static cancellation c;
+        return c;
+    }
+
+    void cancellation::cancel()
+    {
+        if (cancelled_)
+            return;
+
+        // time is set first so elapsed() never sees the flag without it
+        time_      = hr_clock::now().time_since_epoch().count();
+        cancelled_ = true;
+
+        if (event_)
+            ::SetEvent(event_.get());
+    }
+
+    bool cancellation::cancelled() const
+    {
+        return cancelled_;
+    }
+
+    HANDLE cancellation::event() const
+    {
+        return event_.get();
+    }
+
+    std::chrono::milliseconds cancellation::elapsed() const
+    {
+        if (!cancelled_)
+            return std::chrono::milliseconds(0);
+
+        using namespace std::chrono;
+
+        const hr_clock::time_point t(hr_clock::duration(time_.load()));
+        return duration_cast<milliseconds>(hr_clock::now() - t);
+    }
+
     std::size_t make_thread_count(std::optional<std::size_t> count)
     {
         static const auto def = std::thread::hardware_concurrency();
         return std::max<std::size_t>(1, count.value_or(def));
     }
 
-    thread_pool::thread_pool(std::optional<std::size_t> count)
-        : count_(make_thread_count(count))
+    thread_pool::thread_pool(std::optional<std::size_t> count, const cancellation& c)
+        : count_(make_thread_count(count)), cancel_(c)
     {
         for (std::size_t i = 0; i < count_; ++i)
             threads_.emplace_back(std::make_unique<thread_info>());
@@ -210,11 +256,18 @@ namespace mob {
         }
     }
 
-    void thread_pool::add(fun thread_fun)
+    bool thread_pool::add(fun thread_fun)
     {
+        alloc_scope scope(alloc_tag::threading);
+
         for (;;) {
+            // checked on every iteration, a cancellation while waiting for a
+            // thread must not start the function
+            if (cancel_.cancelled())
+                return false;
+
             if (try_add(thread_fun))
-                break;
+                return true;
 
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "fs.h"
+
 namespace mob {
 
     // sets unhandled exception and std::terminate handlers for the current thread
@@ -17,13 +19,60 @@ namespace mob {
         });
     }
 
+    // a flag that's set once to stop work early, with a manual-reset event that's
+    // signaled at the same time so it can be waited on along with other handles
+    //
+    // the global one is cancelled by task_manager::interrupt_all() on sigint or
+    // when a task bails out; cancel() can be called from the console control
+    // handler
+    //
+    class cancellation {
+    public:
+        cancellation();
+
+        // non-copyable
+        cancellation(const cancellation&)            = delete;
+        cancellation& operator=(const cancellation&) = delete;
+
+        // cancelled on interruption, checked by thread pools, processes and
+        // downloads
+        //
+        static cancellation& global();
+
+        // sets the flag and signals the event, remembers the time of the first
+        // call
+        //
+        void cancel();
+
+        // whether cancel() was called
+        //
+        bool cancelled() const;
+
+        // signaled once cancel() is called, never reset
+        //
+        HANDLE event() const;
+
+        // time since cancel() was first called, 0 if it wasn't
+        //
+        std::chrono::milliseconds elapsed() const;
+
+    private:
+        std::atomic<bool> cancelled_;
+        std::atomic<hr_clock::rep> time_;
+        handle_ptr event_;
+    };
+
     // executes a function in a thread, blocks if there are too many
     //
+    // once the given cancellation is cancelled, add() stops waiting for a thread
+    // and drops the function, so queued work never starts
+    //
     class thread_pool {
     public:
         typedef std::function<void()> fun;
 
-        thread_pool(std::optional<std::size_t> count = {});
+        thread_pool(std::optional<std::size_t> count = {},
+                    const cancellation& c = cancellation::global());
 
         // joins
         //
@@ -36,7 +85,10 @@ namespace mob {
         // runs the given function in a thread; if there no threads available,
         // blocks until another thread finishes
         //
-        void add(fun f);
+        // returns false without running the function if the pool's cancellation
+        // was cancelled
+        //
+        bool add(fun f);
 
         // blocks until all threads are finished
         //
@@ -50,6 +102,7 @@ namespace mob {
         };
 
         const std::size_t count_;
+        const cancellation& cancel_;
         std::vector<std::unique_ptr<thread_info>> threads_;
 
         // tries to find an available thread, returns false if none are found
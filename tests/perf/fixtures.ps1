@@ -0,0 +1,261 @@
+# creates everything the performance suite needs to run mob without a network or
+# a compiler, dot-sourced by run.ps1
+#
+#   - bare git repos for every task, cloned by mob with file:// urls;
+#   - archives for the downloads, served by a local http server through
+#     `[global] download_mirror`;
+#   - the stub tools, see stub.cpp;
+#   - an ini that points mob at all of the above.
+
+# versions used for all the downloads, they only need to match the urls below
+$FixtureVersion = "1.0"
+
+# the github releases downloaded by the stylesheets task, this must be kept in
+# sync with releases() in src/tasks/stylesheets.cpp
+$Stylesheets = @(
+    @{ User = "6788-00"; Repo = "paper-light-and-dark"; Key = "ss_paper_lad_6788"; File = "paper-light-and-dark" },
+    @{ User = "6788-00"; Repo = "paper-automata"; Key = "ss_paper_automata_6788"; File = "paper-automata" },
+    @{ User = "6788-00"; Repo = "paper-mono"; Key = "ss_paper_mono_6788"; File = "paper-mono" },
+    @{ User = "6788-00"; Repo = "1809-dark-mode"; Key = "ss_dark_mode_1809_6788"; File = "1809" },
+    @{ User = "Trosski"; Repo = "ModOrganizer_Style_Morrowind"; Key = "ss_morrowind_trosski"; File = "Morrowind-MO2-Stylesheet" },
+    @{ User = "Trosski"; Repo = "Mod-Organizer-2-Skyrim-Stylesheet"; Key = "ss_skyrim_trosski"; File = "Skyrim-MO2-Stylesheet" },
+    @{ User = "Trosski"; Repo = "ModOrganizer_Style_Fallout3"; Key = "ss_fallout3_trosski"; File = "Fallout3-MO2-Stylesheet" },
+    @{ User = "Trosski"; Repo = "Mod-Organizer2-Fallout-4-Stylesheet"; Key = "ss_fallout4_trosski"; File = "Fallout4-MO2-Stylesheet" },
+    @{ User = "Trosski"; Repo = "Starfield_MO2_Stylesheet"; Key = "ss_starfield_trosski"; File = "Starfield.MO2.Stylsheet" }
+)
+
+# ModOrganizer projects built by the suite, they're all configured, built and
+# installed through the stub cmake; cmake_common has no CMakeLists.txt and is
+# only cloned
+$Projects = @(
+    "modorganizer-uibase",
+    "modorganizer-archive",
+    "modorganizer-game_bethesda",
+    "modorganizer-installer_manual",
+    "modorganizer"
+)
+
+# tasks given to `mob build`
+$Tasks = @("usvfs", "cmake_common") + $Projects + @("explorerpp", "stylesheets", "translations")
+
+# runs git and throws if it fails
+function Invoke-Git {
+    & git -c user.name=mob-perf -c user.email=mob-perf@localhost @args | Out-Null
+    if ($LastExitCode -ne 0) {
+        throw "git $args failed with exit code $LastExitCode"
+    }
+}
+
+# writes a text file, creating its directory if needed
+function Write-Fixture([string] $Path, [string] $Content) {
+    New-Item -ItemType Directory -Force (Split-Path $Path) | Out-Null
+    [IO.File]::WriteAllText($Path, $Content)
+}
+
+# creates a bare repo in `$Remotes/ModOrganizer2/<name>.git` with a single
+# commit on master containing the given files, relative path -> content
+function New-Remote([string] $Remotes, [string] $Name, [hashtable] $Files) {
+    $bare = Join-Path $Remotes "ModOrganizer2/$Name.git"
+    $work = Join-Path $Remotes "_work/$Name"
+
+    Invoke-Git init --quiet --bare --initial-branch=master $bare
+    Invoke-Git init --quiet --initial-branch=master $work
+
+    foreach ($f in $Files.GetEnumerator()) {
+        Write-Fixture (Join-Path $work $f.Key) $f.Value
+    }
+
+    Invoke-Git -C $work add --all
+    Invoke-Git -C $work commit --quiet -m "initial"
+    Invoke-Git -C $work push --quiet $bare master
+}
+
+# commits a change to one file of a remote created by New-Remote
+function Update-Remote([string] $Remotes, [string] $Name, [string] $File) {
+    $bare = Join-Path $Remotes "ModOrganizer2/$Name.git"
+    $work = Join-Path $Remotes "_work/$Name"
+
+    Add-Content (Join-Path $work $File) "// changed $(Get-Date -Format o)"
+
+    Invoke-Git -C $work commit --quiet --all -m "change $File"
+    Invoke-Git -C $work push --quiet $bare master
+}
+
+# a CMakeLists.txt and a CMakePresets.json for a ModOrganizer project, the stub
+# cmake only reads the binary directories of the presets
+function New-ProjectFiles([string] $Name, [string[]] $Presets) {
+    $presets = ($Presets | ForEach-Object {
+        "    {`n      `"name`": `"$($_.Split('=')[0])`",`n" +
+        "      `"binaryDir`": `"`${sourceDir}/$($_.Split('=')[1])`"`n    }"
+    }) -join ",`n"
+
+    return @{
+        "CMakeLists.txt"    = "cmake_minimum_required(VERSION 3.16)`nproject($Name)`n"
+        "CMakePresets.json" = "{`n  `"version`": 6,`n  `"configurePresets`": [`n$presets`n  ]`n}`n"
+        "src/main.cpp"      = "int main() {}`n"
+    }
+}
+
+function New-Remotes([string] $Remotes) {
+    New-Remote $Remotes "usvfs" (New-ProjectFiles "usvfs" @(
+        "vs2022-windows-x64=vsbuild64", "vs2022-windows-x86=vsbuild32"))
+
+    New-Remote $Remotes "cmake_common" @{ "mo2.cmake" = "# shared cmake files`n" }
+
+    foreach ($p in $Projects) {
+        New-Remote $Remotes $p (New-ProjectFiles $p @("vs2022-windows=vsbuild"))
+    }
+}
+
+# an archive that the stub 7z can extract, one relative path per line
+function New-Archive([string] $Path, [string[]] $Entries) {
+    Write-Fixture $Path ((@("mob-stub-archive") + $Entries) -join "`n")
+}
+
+# files served by the http server, in `<host>/<path>` like download_mirror
+# expects
+function New-Downloads([string] $Root) {
+    New-Archive (Join-Path $Root "download.explorerplusplus.com/stable/$FixtureVersion/explorerpp_x64.zip") @(
+        "Explorer++.exe", "config.xml")
+
+    foreach ($s in $Stylesheets) {
+        $path = "github.com/$($s.User)/$($s.Repo)/releases/download/$FixtureVersion/$($s.File).7z"
+        New-Archive (Join-Path $Root $path) @("$($s.File).qss", "$($s.File)/icon.png")
+    }
+}
+
+# copies the stub under the name of every tool it replaces
+function New-Stubs([string] $Dir, [string] $Stub) {
+    New-Item -ItemType Directory -Force $Dir | Out-Null
+
+    foreach ($t in @("cmake", "msbuild", "lrelease", "7z", "tx")) {
+        Copy-Item $Stub (Join-Path $Dir "$t.exe")
+    }
+
+    # mob runs vcvars in cmd and reads the variables with `set` afterwards
+    Write-Fixture (Join-Path $Dir "vcvars.bat") "@exit /b 0`r`n"
+}
+
+# the .ts files that transifex would have pulled, the ini disables configuring
+# and pulling so the stub tx only sees `tx init`
+function New-Translations([string] $Prefix) {
+    $root = Join-Path $Prefix "build/transifex-translations/translations"
+
+    foreach ($p in @("organizer", "uibase", "game_bethesda")) {
+        foreach ($lang in @("de", "fr", "zh_CN")) {
+            Write-Fixture (Join-Path $root "mod-organizer-2.$p/$lang.ts") "<TS/>`n"
+        }
+    }
+}
+
+# directories that mob requires to exist but which the stubs don't use
+function New-Toolchain([string] $Dir) {
+    foreach ($d in @("third-party/bin", "licenses", "vs", "vcpkg", "qt/bin", "qt/translations")) {
+        New-Item -ItemType Directory -Force (Join-Path $Dir $d) | Out-Null
+    }
+}
+
+# the ini given to mob with --ini, on top of mob.ini
+function New-Ini([string] $Path, [string] $Fixtures, [string] $Mirror) {
+    $f = $Fixtures.Replace('\', '/')
+    $remotes = "file:///$f/remotes/"
+    $stubs = "$f/stubs"
+
+    $versions = ($Stylesheets | ForEach-Object { "$($_.Key) = $FixtureVersion" }) -join "`n"
+
+    Write-Fixture $Path @"
+[global]
+download_mirror = $Mirror
+throttle        = false
+
+[task]
+git_url_prefix = $remotes
+
+[translations:task]
+enabled = true
+
+[transifex]
+configure = false
+pull      = false
+
+[gc]
+auto = false
+
+[tools]
+cmake    = $stubs/cmake.exe
+msbuild  = $stubs/msbuild.exe
+lrelease = $stubs/lrelease.exe
+sevenz   = $stubs/7z.exe
+tx       = $stubs/tx.exe
+vcvars   = $stubs/vcvars.bat
+
+[versions]
+usvfs      = master
+explorerpp = $FixtureVersion
+$versions
+
+[paths]
+third_party     = $f/toolchain/third-party
+licenses        = $f/toolchain/licenses
+vs              = $f/toolchain/vs
+vcpkg           = $f/toolchain/vcpkg
+qt_install      = $f/toolchain/qt
+qt_bin          = $f/toolchain/qt/bin
+qt_translations = $f/toolchain/qt/translations
+"@
+}
+
+# serves the files in `$Root` on `http://localhost:$Port/`, every request is
+# appended to `$Log`; returns the job, stop it with Stop-Job
+function Start-FixtureServer([string] $Root, [int] $Port, [string] $Log) {
+    $job = Start-Job -ArgumentList $Root, $Port, $Log -ScriptBlock {
+        param($Root, $Port, $Log)
+
+        $l = [Net.HttpListener]::new()
+        $l.Prefixes.Add("http://localhost:$Port/")
+        $l.Start()
+
+        while ($l.IsListening) {
+            $c = $l.GetContext()
+            $path = [Uri]::UnescapeDataString($c.Request.Url.AbsolutePath.TrimStart('/'))
+
+            if ($path -ne "_ready") {
+                Add-Content $Log $path
+            }
+
+            $file = Join-Path $Root $path
+
+            if ($path -eq "_ready") {
+                $c.Response.StatusCode = 200
+            }
+            elseif (Test-Path -PathType Leaf $file) {
+                $bytes = [IO.File]::ReadAllBytes($file)
+                $c.Response.ContentLength64 = $bytes.Length
+                $c.Response.OutputStream.Write($bytes, 0, $bytes.Length)
+            }
+            else {
+                $c.Response.StatusCode = 404
+            }
+
+            $c.Response.Close()
+        }
+    }
+
+    # wait until it's listening
+    for ($i = 0; $i -lt 100; ++$i) {
+        try {
+            Invoke-WebRequest -UseBasicParsing "http://localhost:$Port/_ready" | Out-Null
+            return $job
+        }
+        catch {
+            if ($job.State -ne "Running") {
+                throw "fixture server failed: $(Receive-Job $job 2>&1)"
+            }
+
+            Start-Sleep -Milliseconds 100
+        }
+    }
+
+    Stop-Job $job
+    throw "fixture server didn't start on port $Port"
+}
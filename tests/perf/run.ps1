@@ -0,0 +1,227 @@
+# end-to-end performance suite for mob itself
+#
+# builds a synthetic prefix with `mob build` against local stand-ins for
+# everything mob normally talks to, so nothing but mob's own overhead is
+# measured and no network is needed:
+#
+#   - every task is cloned from a bare repo with a file:// url;
+#   - archives are downloaded from a local http server through
+#     `[global] download_mirror`;
+#   - cmake, msbuild, lrelease, 7z and tx are the stub from stub.cpp.
+#
+# scenarios, run in this order on the same prefix:
+#
+#   - cold:   empty prefix, everything is cloned, downloaded and built;
+#   - noop:   nothing changed since the cold build;
+#   - single: one commit was pushed to modorganizer-uibase;
+#   - reclone: `--reextract`, every repo is deleted and cloned again.
+#
+# each scenario records mob's wall time, the processes it created, the bytes it
+# logged and its peak memory from `[global] metrics_file`, along with the
+# number of downloads and tool invocations; they're written to
+# `<work>/results/summary.json`
+#
+# the suite fails if a scenario exceeds the limits in thresholds.json or, when
+# -Baseline is given, if a metric is worse than the baseline by more than the
+# tolerance in thresholds.json; -Update writes the summary to the baseline file
+# instead of comparing against it
+#
+# only the counters that don't depend on the machine are compared: processes,
+# tool calls and downloads; the baseline usually comes from another runner, so
+# wall time, log size and peak memory are only reported next to the baseline
+
+param(
+    # mob.exe to measure
+    [Parameter(Mandatory)]
+    [string]
+    $Mob,
+
+    # mob-stub.exe, built from stub.cpp
+    [Parameter(Mandatory)]
+    [string]
+    $Stub,
+
+    # everything is created in there, it's deleted first
+    [string]
+    $Work = (Join-Path ([IO.Path]::GetTempPath()) "mob-perf"),
+
+    # summary.json of a previous run
+    [string]
+    $Baseline,
+
+    [string]
+    $Thresholds = (Join-Path $PSScriptRoot "thresholds.json"),
+
+    # writes the results to -Baseline instead of comparing them
+    [switch]
+    $Update,
+
+    # port of the fixture server
+    [int]
+    $Port = 8765
+)
+
+$ErrorActionPreference = "Stop"
+
+. (Join-Path $PSScriptRoot "fixtures.ps1")
+
+if ($Update -and !$Baseline) {
+    throw "-Update needs -Baseline"
+}
+
+$Mob = (Resolve-Path $Mob).Path
+$Stub = (Resolve-Path $Stub).Path
+$Work = [IO.Path]::GetFullPath($Work)
+
+if (Test-Path $Work) {
+    Remove-Item -Recurse -Force $Work
+}
+
+$fixtures = Join-Path $Work "fixtures"
+$prefix = Join-Path $Work "prefix"
+$results = Join-Path $Work "results"
+$ini = Join-Path $fixtures "mob-perf.ini"
+$serverLog = Join-Path $results "downloads.log"
+
+New-Item -ItemType Directory -Force $fixtures, $prefix, $results | Out-Null
+New-Item -ItemType File -Force $serverLog | Out-Null
+
+Write-Output "creating fixtures in $fixtures"
+
+New-Remotes (Join-Path $fixtures "remotes")
+New-Downloads (Join-Path $fixtures "downloads")
+New-Stubs (Join-Path $fixtures "stubs") $Stub
+New-Toolchain (Join-Path $fixtures "toolchain")
+New-Translations $prefix
+New-Ini $ini $fixtures "http://localhost:$Port/"
+
+# git refuses file:// urls for submodules by default, mob adds every project as
+# a submodule of build/modorganizer_super
+$env:GIT_CONFIG_COUNT = "1"
+$env:GIT_CONFIG_KEY_0 = "protocol.file.allow"
+$env:GIT_CONFIG_VALUE_0 = "always"
+
+# runs `mob build` for all the tasks and returns the metrics of the run
+function Invoke-Scenario([string] $Name, [string[]] $BuildArgs) {
+    Write-Host "scenario $Name"
+
+    $metrics = Join-Path $results "$Name.json"
+    $tools = Join-Path $results "$Name-tools.log"
+    $downloadsBefore = @(Get-Content $serverLog).Count
+
+    $env:MOB_STUB_LOG = $tools
+
+    & $Mob --ini $ini -d $prefix -s "global/metrics_file=$metrics" `
+        build @BuildArgs @Tasks | Out-File (Join-Path $results "$Name.out")
+
+    $exitCode = $LastExitCode
+    Remove-Item Env:\MOB_STUB_LOG
+
+    if ($exitCode -ne 0) {
+        throw "scenario $Name failed with exit code $exitCode, see $results"
+    }
+
+    $m = Get-Content $metrics | ConvertFrom-Json
+
+    $calls = if (Test-Path $tools) { @(Get-Content $tools) } else { @() }
+
+    return [ordered]@{
+        wall_ms     = $m.wall_ms
+        processes   = $m.processes
+        log_bytes   = $m.log_bytes
+        peak_memory = $m.peak_memory
+        downloads   = @(Get-Content $serverLog).Count - $downloadsBefore
+        tool_calls  = $calls.Count
+    }
+}
+
+$server = Start-FixtureServer (Join-Path $fixtures "downloads") $Port $serverLog
+$summary = [ordered]@{}
+
+try {
+    $summary.cold = Invoke-Scenario "cold" @()
+    $summary.noop = Invoke-Scenario "noop" @()
+
+    Update-Remote (Join-Path $fixtures "remotes") "modorganizer-uibase" "src/main.cpp"
+    $summary.single = Invoke-Scenario "single" @()
+
+    $summary.reclone = Invoke-Scenario "reclone" @("--reextract")
+}
+finally {
+    Stop-Job $server
+    Remove-Job $server
+}
+
+$summary | ConvertTo-Json | Set-Content (Join-Path $results "summary.json")
+
+foreach ($s in $summary.Keys) {
+    $m = $summary[$s]
+    Write-Output ("{0,-8} {1,8} ms {2,5} processes {3,10} bytes logged {4,6} MB peak {5,3} downloads {6,4} tool calls" -f `
+        $s, $m.wall_ms, $m.processes, $m.log_bytes, [math]::Round($m.peak_memory / 1MB),
+        $m.downloads, $m.tool_calls)
+}
+
+if ($Update) {
+    Copy-Item (Join-Path $results "summary.json") $Baseline
+    Write-Output "baseline written to $Baseline"
+    exit 0
+}
+
+$t = Get-Content $Thresholds | ConvertFrom-Json
+$failures = @()
+
+foreach ($s in $summary.Keys) {
+    # hard limits
+    $limits = $t.limits.$s
+
+    if ($limits) {
+        foreach ($p in $limits.PSObject.Properties) {
+            if ($summary[$s][$p.Name] -gt $p.Value) {
+                $failures += "$s/$($p.Name) is $($summary[$s][$p.Name]), the limit is $($p.Value)"
+            }
+        }
+    }
+}
+
+if ($Baseline) {
+    $base = Get-Content $Baseline | ConvertFrom-Json
+
+    foreach ($s in $summary.Keys) {
+        foreach ($p in $t.tolerance.PSObject.Properties) {
+            $before = $base.$s.($p.Name)
+            if ($null -eq $before) {
+                continue
+            }
+
+            # relative tolerance, with an absolute slack so small values don't
+            # fail on noise
+            $allowed = [math]::Max($before * (1 + $p.Value), $before + $t.slack.($p.Name))
+            $now = $summary[$s][$p.Name]
+
+            if ($now -gt $allowed) {
+                $failures += "$s/$($p.Name) regressed from $before to $now, at most $([math]::Floor($allowed)) is allowed"
+            }
+        }
+
+        foreach ($name in $t.informational) {
+            $before = $base.$s.$name
+            if (!$before) {
+                continue
+            }
+
+            $now = $summary[$s][$name]
+            Write-Output ("{0,-8} {1,-12} {2,12} -> {3,12} ({4:+0;-0}%, not checked)" -f `
+                $s, $name, $before, $now, (($now - $before) * 100 / $before))
+        }
+    }
+}
+else {
+    Write-Output "no baseline given, only checking the limits"
+}
+
+if ($failures.Count -gt 0) {
+    $failures | ForEach-Object { Write-Output "FAIL $_" }
+    exit 1
+}
+
+Write-Output "no regressions"
@@ -0,0 +1,372 @@
+// stand-in for cmake, msbuild, lrelease, 7z and tx used by the performance
+// suite, see run.ps1
+//
+// the suite copies this executable under the name of every tool it replaces and
+// it behaves depending on its own filename; it does just enough for mob to go
+// through a full build without a compiler or a network:
+//
+//   - cmake writes a CMakeCache.txt when configuring, a file per project when
+//     building and copies it to the prefix with an install_manifest.txt when
+//     installing;
+//   - lrelease writes the .qm file given with -qm;
+//   - 7z extracts the text archives created by fixtures.ps1, which list one
+//     relative path per line;
+//   - msbuild, tx and anything else do nothing.
+//
+// every invocation is appended to the file in MOB_STUB_LOG if it's set, the
+// suite uses it to count tool processes per scenario
+
+#include <algorithm>
+#include <cstdlib>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    // arguments without argv[0]
+    using args_t = std::vector<std::wstring>;
+
+    std::string utf8(const fs::path& p)
+    {
+        const auto s = p.u8string();
+        return std::string(s.begin(), s.end());
+    }
+
+    fs::path from_utf8(const std::string& s)
+    {
+        return fs::path(std::u8string(s.begin(), s.end()));
+    }
+
+    std::wstring lower(std::wstring s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(), std::towlower);
+        return s;
+    }
+
+    // value of a `-Dname=value` or `-Dname:TYPE=value` argument, or of the
+    // argument following `-Dname=` when the value was given separately
+    //
+    std::wstring find_def(const args_t& args, const std::wstring& name)
+    {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const auto& a = args[i];
+
+            if (!a.starts_with(L"-D" + name))
+                continue;
+
+            const auto rest = a.substr(2 + name.size());
+            if (!rest.starts_with(L"=") && !rest.starts_with(L":"))
+                continue;
+
+            const auto eq = a.find(L'=');
+            if (eq == std::wstring::npos)
+                continue;
+
+            auto v = a.substr(eq + 1);
+            if (v.empty() && i + 1 < args.size())
+                v = args[i + 1];
+
+            return v;
+        }
+
+        return {};
+    }
+
+    // value following `name`, or the rest of the argument for `-oDIR` style
+    // options when `joined` is set
+    //
+    std::wstring find_opt(const args_t& args, const std::wstring& name,
+                          bool joined = false)
+    {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            if (args[i] == name && i + 1 < args.size())
+                return args[i + 1];
+
+            if (joined && args[i].starts_with(name) && args[i].size() > name.size())
+                return args[i].substr(name.size());
+        }
+
+        return {};
+    }
+
+    std::map<std::string, std::string> read_cache(const fs::path& build)
+    {
+        std::map<std::string, std::string> m;
+
+        std::ifstream in(build / "CMakeCache.txt");
+        std::string line;
+
+        while (std::getline(in, line)) {
+            const auto eq = line.find('=');
+            if (eq != std::string::npos)
+                m[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+
+        return m;
+    }
+
+    void write_file(const fs::path& p, const std::string& content)
+    {
+        fs::create_directories(p.parent_path());
+        std::ofstream(p, std::ios::binary) << content;
+    }
+
+    // the binary built from a project lists its source files with their size
+    // and time, so it changes when a source file changes and only then
+    //
+    std::string fake_binary(const fs::path& source)
+    {
+        std::string s;
+
+        for (auto i = fs::recursive_directory_iterator(source);
+             i != fs::recursive_directory_iterator(); ++i) {
+            if (i->path().filename() == ".git") {
+                i.disable_recursion_pending();
+                continue;
+            }
+
+            if (!i->is_regular_file())
+                continue;
+
+            const auto rel  = fs::relative(i->path(), source).generic_u8string();
+            const auto time = i->last_write_time().time_since_epoch().count();
+
+            s += std::string(rel.begin(), rel.end()) + " " +
+                 std::to_string(i->file_size()) + " " + std::to_string(time) + "\n";
+        }
+
+        return s;
+    }
+
+    int cmake_configure(const args_t& args)
+    {
+        const auto cwd = fs::current_path();
+        fs::path source, build;
+
+        const auto preset = find_opt(args, L"--preset");
+        build             = find_opt(args, L"-B");
+
+        if (!preset.empty()) {
+            source = cwd;
+
+            // the binary directory of the preset, fixtures.ps1 writes them with
+            // one key per line
+            if (build.empty()) {
+                std::ifstream in(source / "CMakePresets.json");
+                std::string line, name;
+
+                while (std::getline(in, line)) {
+                    const auto n = line.find("\"name\"");
+                    if (n != std::string::npos)
+                        name = line;
+
+                    const auto b = line.find("${sourceDir}/");
+                    if (b != std::string::npos &&
+                        name.find("\"" + utf8(preset) + "\"") != std::string::npos) {
+                        const auto end = line.find('"', b);
+                        build = source / line.substr(b + 13, end - b - 13);
+                        break;
+                    }
+                }
+            }
+        }
+        else {
+            // `cmake -G ... ..` from the build directory
+            build  = cwd;
+            source = cwd.parent_path();
+        }
+
+        if (build.empty()) {
+            std::cerr << "stub cmake: no build directory\n";
+            return 1;
+        }
+
+        if (build.is_relative())
+            build = source / build;
+
+        const auto prefix = find_def(args, L"CMAKE_INSTALL_PREFIX");
+
+        write_file(build / "CMakeCache.txt",
+                   "CMAKE_HOME_DIRECTORY=" + utf8(source) + "\n" +
+                       "CMAKE_INSTALL_PREFIX=" + utf8(prefix) + "\n");
+
+        return 0;
+    }
+
+    int cmake_install(const fs::path& build, const std::wstring& config,
+                      fs::path prefix)
+    {
+        const auto cache = read_cache(build);
+
+        if (prefix.empty()) {
+            auto itor = cache.find("CMAKE_INSTALL_PREFIX");
+            if (itor == cache.end() || itor->second.empty()) {
+                std::cerr << "stub cmake: no install prefix\n";
+                return 1;
+            }
+
+            prefix = from_utf8(itor->second);
+        }
+
+        std::string manifest;
+        const auto from = build / config;
+
+        if (fs::exists(from)) {
+            for (auto&& e : fs::directory_iterator(from)) {
+                const auto to = prefix / "bin" / e.path().filename();
+
+                fs::create_directories(to.parent_path());
+                fs::copy_file(e.path(), to, fs::copy_options::update_existing);
+
+                manifest += utf8(fs::absolute(to).generic_wstring()) + "\n";
+            }
+        }
+
+        write_file(build / "install_manifest.txt", manifest);
+        return 0;
+    }
+
+    int cmake(const args_t& args)
+    {
+        if (std::ranges::find(args, L"--version") != args.end()) {
+            std::cout << "cmake version 3.31.0 (mob stub)\n";
+            return 0;
+        }
+
+        const auto build_dir   = find_opt(args, L"--build");
+        const auto install_dir = find_opt(args, L"--install");
+        const auto config      = find_opt(args, L"--config");
+
+        if (!install_dir.empty())
+            return cmake_install(install_dir, config, find_opt(args, L"--prefix"));
+
+        if (build_dir.empty())
+            return cmake_configure(args);
+
+        const auto target = find_opt(args, L"--target");
+        const auto cache  = read_cache(build_dir);
+
+        auto itor = cache.find("CMAKE_HOME_DIRECTORY");
+        if (itor == cache.end()) {
+            std::cerr << "stub cmake: " << utf8(build_dir) << " is not configured\n";
+            return 1;
+        }
+
+        if (target == L"ZERO_CHECK")
+            return 0;
+
+        const auto source = from_utf8(itor->second);
+        const auto out    = fs::path(build_dir) / config /
+                         (source.filename().wstring() + L".dll");
+
+        const auto content = fake_binary(source);
+
+        // left alone when nothing changed, like a real incremental build
+        std::ifstream in(out, std::ios::binary);
+        const std::string old((std::istreambuf_iterator<char>(in)), {});
+        in.close();
+
+        if (old != content)
+            write_file(out, content);
+
+        if (target == L"INSTALL")
+            return cmake_install(build_dir, config, {});
+
+        return 0;
+    }
+
+    int lrelease(const args_t& args)
+    {
+        const auto qm = find_opt(args, L"-qm");
+        if (qm.empty()) {
+            std::cerr << "stub lrelease: no -qm\n";
+            return 1;
+        }
+
+        write_file(qm, "");
+        return 0;
+    }
+
+    int sevenz(const args_t& args)
+    {
+        if (args.empty() || args[0] != L"x")
+            return 0;
+
+        const fs::path out     = find_opt(args, L"-o", true);
+        const fs::path archive = args.back();
+
+        std::ifstream in(archive);
+        std::string line;
+
+        if (!std::getline(in, line) || line != "mob-stub-archive") {
+            std::cerr << "stub 7z: " << utf8(archive) << " is not a stub archive\n";
+            return 2;
+        }
+
+        while (std::getline(in, line)) {
+            if (!line.empty())
+                write_file(out / from_utf8(line), line + "\n");
+        }
+
+        return 0;
+    }
+
+    void log_call(const std::wstring& tool, const args_t& args)
+    {
+        const auto* log = _wgetenv(L"MOB_STUB_LOG");
+        if (!log || !*log)
+            return;
+
+        std::string line = utf8(tool);
+        for (auto&& a : args)
+            line += " " + utf8(a);
+
+        // several stubs run at the same time, a handle opened only for appending
+        // makes every write go to the end of the file in one piece
+        HANDLE h =
+            ::CreateFileW(log, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                          nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (h == INVALID_HANDLE_VALUE)
+            return;
+
+        line += "\n";
+
+        DWORD written = 0;
+        ::WriteFile(h, line.data(), static_cast<DWORD>(line.size()), &written, nullptr);
+        ::CloseHandle(h);
+    }
+
+}  // namespace
+
+int wmain(int argc, wchar_t** argv)
+{
+    const auto tool = lower(fs::path(argv[0]).stem().wstring());
+    const args_t args(argv + 1, argv + argc);
+
+    log_call(tool, args);
+
+    try {
+        if (tool == L"cmake")
+            return cmake(args);
+        else if (tool == L"lrelease")
+            return lrelease(args);
+        else if (tool == L"7z")
+            return sevenz(args);
+
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << "stub " << utf8(tool) << ": " << e.what() << "\n";
+        return 1;
+    }
+}
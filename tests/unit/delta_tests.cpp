@@ -0,0 +1,227 @@
+// tests for make_delta() and apply_delta() in src/utility/delta.cpp
+
+#include "test.h"
+#include "../../src/utility/delta.h"
+
+namespace mob::tests {
+
+    // same bytes for the same seed, xorshift is good enough to never find
+    // matches by chance
+    //
+    std::string random_bytes(std::size_t n, std::uint64_t seed)
+    {
+        std::string s(n, '\0');
+        std::uint64_t x = seed * 0x9e3779b97f4a7c15 + 1;
+
+        for (auto& c : s) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            c = static_cast<char>(x & 0xff);
+        }
+
+        return s;
+    }
+
+    // makes a delta, checks that it recreates `new_bytes` and returns its size
+    //
+    std::size_t round_trip(std::string_view old_bytes, std::string_view new_bytes,
+                           std::size_t block_size = 64)
+    {
+        const auto delta = make_delta(old_bytes, new_bytes, block_size);
+        const auto out   = apply_delta(old_bytes, delta);
+
+        MOB_CHECK(out);
+        MOB_CHECK(out && *out == new_bytes);
+
+        return delta.size();
+    }
+
+    // "MOBDELTA" and both sizes
+    const std::size_t header_size = 8 + 8 + 8;
+
+    // one 'C' with an offset and a length
+    const std::size_t copy_size = 1 + 8 + 8;
+
+    // one 'L' with a length, followed by the bytes
+    const std::size_t literal_size = 1 + 8;
+
+    void put_u64(std::string& s, std::size_t offset, std::uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            s[offset + i] = static_cast<char>((v >> (i * 8)) & 0xff);
+    }
+
+    MOB_TEST(delta_empty)
+    {
+        const auto bytes = random_bytes(1000, 1);
+
+        MOB_CHECK(round_trip("", "") == header_size);
+        MOB_CHECK(round_trip("", bytes) == header_size + literal_size + bytes.size());
+        MOB_CHECK(round_trip(bytes, "") == header_size);
+    }
+
+    MOB_TEST(delta_identical)
+    {
+        // a single copy, whatever the size, even if it's not a multiple of the
+        // block size
+        for (const auto n : {64, 1000, 100'000}) {
+            const auto bytes = random_bytes(n, 2);
+            MOB_CHECK(round_trip(bytes, bytes) == header_size + copy_size);
+        }
+
+        // smaller than a block, can't be matched
+        const auto small = random_bytes(10, 3);
+        MOB_CHECK(round_trip(small, small) == header_size + literal_size + 10);
+    }
+
+    MOB_TEST(delta_shifted)
+    {
+        // the offsets in the old file are multiples of the block size, matches
+        // are only found from the start of a block
+        const auto old_bytes = random_bytes(100'000, 4);
+        const auto inserted  = random_bytes(37, 5);
+
+        // inserted at the start, the rest is found at every offset
+        const auto prepended = inserted + old_bytes;
+        MOB_CHECK(round_trip(old_bytes, prepended) ==
+                  header_size + literal_size + inserted.size() + copy_size);
+
+        // inserted in the middle, the old file is copied in two parts
+        const auto middle =
+            old_bytes.substr(0, 49'984) + inserted + old_bytes.substr(49'984);
+
+        MOB_CHECK(round_trip(old_bytes, middle) ==
+                  header_size + copy_size + literal_size + inserted.size() +
+                      copy_size);
+
+        // removed from the middle
+        const auto removed = old_bytes.substr(0, 40'000) + old_bytes.substr(60'032);
+        MOB_CHECK(round_trip(old_bytes, removed) == header_size + copy_size * 2);
+
+        // both halves swapped
+        const auto swapped = old_bytes.substr(49'984) + old_bytes.substr(0, 49'984);
+        MOB_CHECK(round_trip(old_bytes, swapped) == header_size + copy_size * 2);
+    }
+
+    MOB_TEST(delta_all_different)
+    {
+        const auto old_bytes = random_bytes(50'000, 6);
+        const auto new_bytes = random_bytes(60'000, 7);
+
+        // everything is a literal, merged into one
+        MOB_CHECK(round_trip(old_bytes, new_bytes) ==
+                  header_size + literal_size + new_bytes.size());
+    }
+
+    MOB_TEST(delta_repeated_blocks)
+    {
+        // zero padding has the same checksum everywhere, only a few candidates
+        // are kept, but the matches are still found and extended
+        const std::string zeros(100'000, '\0');
+        const auto mixed = random_bytes(1000, 8) + zeros + random_bytes(1000, 9);
+
+        round_trip(zeros, zeros);
+        round_trip(zeros, mixed);
+        round_trip(mixed, zeros);
+        round_trip(mixed, mixed);
+    }
+
+    MOB_TEST(delta_block_sizes)
+    {
+        const auto old_bytes = random_bytes(20'000, 10);
+        auto new_bytes       = old_bytes;
+
+        // a few modified bytes here and there
+        for (std::size_t i = 100; i < new_bytes.size(); i += 3001)
+            new_bytes[i] = static_cast<char>(~new_bytes[i]);
+
+        for (const std::size_t bs : {1, 2, 7, 64, 4096, 20'000, 50'000})
+            round_trip(old_bytes, new_bytes, bs);
+    }
+
+    MOB_TEST(delta_truncated)
+    {
+        const auto old_bytes = random_bytes(10'000, 11);
+        const auto new_bytes = random_bytes(100, 12) + old_bytes.substr(5000);
+        const auto delta     = make_delta(old_bytes, new_bytes, 64);
+
+        // a delta that was cut anywhere, even between operations, must never
+        // produce a file
+        for (std::size_t n = 0; n < delta.size(); ++n)
+            MOB_CHECK(!apply_delta(old_bytes, delta.substr(0, n)));
+    }
+
+    MOB_TEST(delta_corrupt)
+    {
+        const auto old_bytes = random_bytes(10'000, 13);
+        const auto new_bytes = random_bytes(100, 14) + old_bytes;
+        const auto delta     = make_delta(old_bytes, new_bytes, 64);
+
+        MOB_CHECK(apply_delta(old_bytes, delta));
+
+        // the literal comes first, then the copy
+        const std::size_t literal = header_size;
+        const std::size_t copy    = literal + literal_size + 100;
+
+        MOB_CHECK(delta[literal] == 'L');
+        MOB_CHECK(delta[copy] == 'C');
+
+        // not a delta
+        auto magic = delta;
+        magic[0]   = 'X';
+        MOB_CHECK(!apply_delta(old_bytes, magic));
+
+        // made from another file
+        MOB_CHECK(!apply_delta(old_bytes.substr(1), delta));
+        MOB_CHECK(!apply_delta(old_bytes + "x", delta));
+
+        // unknown operation
+        auto op = delta;
+        op[copy] = 'X';
+        MOB_CHECK(!apply_delta(old_bytes, op));
+
+        // trailing garbage
+        MOB_CHECK(!apply_delta(old_bytes, delta + "C"));
+
+        // trailing operation, the file would be too large
+        auto extra = delta;
+        extra += delta.substr(copy);
+        MOB_CHECK(!apply_delta(old_bytes, extra));
+
+        // copy past the end of the old file, from an offset or with a length
+        auto offset = delta;
+        put_u64(offset, copy + 1, old_bytes.size() + 1);
+        MOB_CHECK(!apply_delta(old_bytes, offset));
+
+        auto length = delta;
+        put_u64(length, copy + 9, old_bytes.size() + 1);
+        MOB_CHECK(!apply_delta(old_bytes, length));
+
+        // offset + length overflows
+        auto overflow = delta;
+        put_u64(overflow, copy + 1, 1);
+        put_u64(overflow, copy + 9, 0xffffffffffffffff);
+        MOB_CHECK(!apply_delta(old_bytes, overflow));
+
+        // literal longer than what's left in the delta
+        auto literal_length = delta;
+        put_u64(literal_length, literal + 1, delta.size());
+        MOB_CHECK(!apply_delta(old_bytes, literal_length));
+
+        // new size doesn't match what the operations produce
+        auto smaller = delta;
+        put_u64(smaller, 16, new_bytes.size() - 1);
+        MOB_CHECK(!apply_delta(old_bytes, smaller));
+
+        auto larger = delta;
+        put_u64(larger, 16, new_bytes.size() + 1);
+        MOB_CHECK(!apply_delta(old_bytes, larger));
+
+        // absurd new size, must fail instead of allocating it
+        auto huge = delta;
+        put_u64(huge, 16, 0x7fffffffffffffff);
+        MOB_CHECK(!apply_delta(old_bytes, huge));
+    }
+
+}  // namespace mob::tests
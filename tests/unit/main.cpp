@@ -0,0 +1,84 @@
+// runs all the tests registered with MOB_TEST(), or only the ones whose name
+// contains one of the arguments; returns 1 if any check failed
+
+#include "test.h"
+#include "../../src/utility/assert.h"
+
+namespace mob::tests {
+
+    struct test {
+        const char* name;
+        test_function f;
+    };
+
+    // tests are registered during static initialization, from every file
+    //
+    std::vector<test>& all_tests()
+    {
+        static std::vector<test> v;
+        return v;
+    }
+
+    std::size_t failures = 0;
+
+    bool add(const char* name, test_function f)
+    {
+        all_tests().push_back({name, f});
+        return true;
+    }
+
+    void check(bool b, const char* exp, const char* file, int line)
+    {
+        if (b)
+            return;
+
+        std::cerr << file << "(" << line << "): check failed: " << exp << "\n";
+        ++failures;
+    }
+
+}  // namespace mob::tests
+
+namespace mob {
+
+    // the code under test uses MOB_ASSERT(), which logs through the global
+    // context in mob; the tests don't have one
+    //
+    void mob_assertion_failed(const char* message, const char* exp, const wchar_t*,
+                              int line, const char* func)
+    {
+        std::cerr << "assertion failed: " << func << ":" << line << ": "
+                  << (message ? message : "") << " '" << exp << "'\n";
+
+        std::exit(1);
+    }
+
+}  // namespace mob
+
+int main(int argc, char** argv)
+{
+    using namespace mob::tests;
+
+    std::size_t ran = 0;
+
+    for (auto&& t : all_tests()) {
+        bool wanted = (argc < 2);
+
+        for (int i = 1; i < argc; ++i) {
+            if (std::string_view(t.name).find(argv[i]) != std::string_view::npos)
+                wanted = true;
+        }
+
+        if (!wanted)
+            continue;
+
+        const auto before = failures;
+        t.f();
+        ++ran;
+
+        std::cout << (failures == before ? "ok   " : "FAIL ") << t.name << "\n";
+    }
+
+    std::cout << ran << " tests, " << failures << " failed checks\n";
+
+    return (failures == 0 ? 0 : 1);
+}
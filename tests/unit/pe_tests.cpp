@@ -0,0 +1,421 @@
+// tests for parse_pe() and parse_pdb() in src/utility/pe.cpp
+//
+// the fixtures are built here byte by byte instead of being real binaries, they
+// only contain the structures that the parsers read:
+//   - a PE with the dos header, coff header, optional header with 16 data
+//     directories, one section and a debug directory with a codeview record;
+//   - a PDB with the msf superblock, the block map, the stream directory, the
+//     pdb info stream and the dbi stream, one block each
+
+#include "test.h"
+#include "../../src/utility/pe.h"
+
+namespace mob::tests {
+
+    const std::uint32_t pe_timestamp  = 0x5f3e2a1b;
+    const std::uint32_t pe_image_size = 0x1a000;
+    const std::string pdb_path        = "C:\\build\\ModOrganizer.pdb";
+
+    // {12345678-9ABC-DEF0-0102-030405060708}
+    const std::array<std::uint8_t, 16> guid = {0x78, 0x56, 0x34, 0x12, 0xbc, 0x9a,
+                                               0xf0, 0xde, 0x01, 0x02, 0x03, 0x04,
+                                               0x05, 0x06, 0x07, 0x08};
+
+    const std::string guid_key = "123456789ABCDEF00102030405060708";
+
+    template <class T>
+    void put(std::string& s, std::size_t offset, T v)
+    {
+        if (s.size() < offset + sizeof(T))
+            s.resize(offset + sizeof(T));
+
+        std::memcpy(s.data() + offset, &v, sizeof(T));
+    }
+
+    void put_bytes(std::string& s, std::size_t offset, std::string_view bytes)
+    {
+        if (s.size() < offset + bytes.size())
+            s.resize(offset + bytes.size());
+
+        std::memcpy(s.data() + offset, bytes.data(), bytes.size());
+    }
+
+    struct pe_fixture {
+        bool pe32_plus         = true;
+        bool debug_directory   = true;
+        std::uint32_t cv_type  = 2;
+        std::uint32_t cv_age   = 0x2a;
+        std::uint32_t cv_magic = 0x53445352;  // "RSDS"
+    };
+
+    // offsets in the fixture, see make_pe()
+    const std::size_t pe_offset      = 0x40;
+    const std::size_t coff_offset    = pe_offset + 4;
+    const std::size_t opt_offset     = coff_offset + 20;
+    const std::size_t section_offset = 0x200;
+    const std::size_t debug_offset   = section_offset;
+    const std::size_t cv_offset      = debug_offset + 28;
+
+    std::string make_pe(const pe_fixture& f = {})
+    {
+        std::string s(0x400, '\0');
+
+        // dos header
+        put_bytes(s, 0, "MZ");
+        put<std::uint32_t>(s, 0x3c, pe_offset);
+
+        // pe signature and coff header
+        put_bytes(s, pe_offset, std::string_view("PE\0\0", 4));
+
+        const std::uint16_t opt_size = (f.pe32_plus ? 112 : 96) + 16 * 8;
+
+        put<std::uint16_t>(s, coff_offset, 0x8664);
+        put<std::uint16_t>(s, coff_offset + 2, 1);
+        put<std::uint32_t>(s, coff_offset + 4, pe_timestamp);
+        put<std::uint16_t>(s, coff_offset + 16, opt_size);
+
+        // optional header
+        put<std::uint16_t>(s, opt_offset, f.pe32_plus ? 0x20b : 0x10b);
+        put<std::uint32_t>(s, opt_offset + 56, pe_image_size);
+
+        const std::size_t dirs = opt_offset + (f.pe32_plus ? 108 : 92);
+        put<std::uint32_t>(s, dirs, 16);
+
+        // debug directory, 7th data directory, in the only section
+        const std::uint32_t section_rva = 0x1000;
+
+        if (f.debug_directory) {
+            put<std::uint32_t>(s, dirs + 4 + 6 * 8, section_rva);
+            put<std::uint32_t>(s, dirs + 4 + 6 * 8 + 4, 28);
+        }
+
+        // section header
+        const std::size_t section = opt_offset + opt_size;
+        put_bytes(s, section, ".rdata");
+        put<std::uint32_t>(s, section + 8, 0x1000);
+        put<std::uint32_t>(s, section + 12, section_rva);
+        put<std::uint32_t>(s, section + 16, 0x200);
+        put<std::uint32_t>(s, section + 20, section_offset);
+
+        // codeview record
+        std::string cv;
+        put<std::uint32_t>(cv, 0, f.cv_magic);
+        put_bytes(cv, 4, {reinterpret_cast<const char*>(guid.data()), guid.size()});
+        put<std::uint32_t>(cv, 20, f.cv_age);
+        put_bytes(cv, 24, pdb_path);
+        cv += '\0';
+
+        put_bytes(s, cv_offset, cv);
+
+        // debug directory entry
+        put<std::uint32_t>(s, debug_offset + 12, f.cv_type);
+        put<std::uint32_t>(s, debug_offset + 16, static_cast<std::uint32_t>(cv.size()));
+        put<std::uint32_t>(s, debug_offset + 20, section_rva + 28);
+        put<std::uint32_t>(s, debug_offset + 24, cv_offset);
+
+        return s;
+    }
+
+    struct pdb_fixture {
+        std::uint32_t block_size = 512;
+        std::uint32_t info_age   = 7;
+        std::uint32_t dbi_age    = 0x2a;
+        bool dbi_stream          = true;
+    };
+
+    // blocks of the fixture, see make_pdb()
+    const std::uint32_t map_block  = 1;
+    const std::uint32_t dir_block  = 2;
+    const std::uint32_t info_block = 3;
+    const std::uint32_t dbi_block  = 4;
+
+    // offset of the directory size in the superblock
+    const std::size_t dir_size_offset = 44;
+
+    std::string make_pdb(const pdb_fixture& f = {})
+    {
+        const auto bs = f.block_size;
+        std::string s(bs * 5, '\0');
+
+        // stream directory: stream count, sizes, then the blocks of each stream;
+        // stream 0 is empty, stream 2 is unused
+        std::string dir;
+        const std::uint32_t streams = (f.dbi_stream ? 4 : 2);
+
+        put<std::uint32_t>(dir, 0, streams);
+        put<std::uint32_t>(dir, 4, 0);
+        put<std::uint32_t>(dir, 8, 28);
+
+        if (f.dbi_stream) {
+            put<std::uint32_t>(dir, 12, 0xffffffff);
+            put<std::uint32_t>(dir, 16, 12);
+            put<std::uint32_t>(dir, 20, info_block);
+            put<std::uint32_t>(dir, 24, dbi_block);
+        }
+        else {
+            put<std::uint32_t>(dir, 12, info_block);
+        }
+
+        // superblock
+        put_bytes(s, 0, std::string_view("Microsoft C/C++ MSF 7.00\r\n\x1a"
+                                         "DS\0\0\0",
+                                         32));
+
+        put<std::uint32_t>(s, 32, bs);
+        put<std::uint32_t>(s, 36, 1);
+        put<std::uint32_t>(s, 40, 5);
+        put<std::uint32_t>(s, dir_size_offset, static_cast<std::uint32_t>(dir.size()));
+        put<std::uint32_t>(s, 52, map_block);
+
+        // block map, the directory fits in one block
+        put<std::uint32_t>(s, map_block * bs, dir_block);
+        put_bytes(s, dir_block * bs, dir);
+
+        // pdb info stream: version, signature, age, guid
+        put<std::uint32_t>(s, info_block * bs, 20000404);
+        put<std::uint32_t>(s, info_block * bs + 8, f.info_age);
+        put_bytes(s, info_block * bs + 12,
+                  {reinterpret_cast<const char*>(guid.data()), guid.size()});
+
+        // dbi stream: signature, version, age
+        put<std::uint32_t>(s, dbi_block * bs, 0xffffffff);
+        put<std::uint32_t>(s, dbi_block * bs + 4, 19990903);
+        put<std::uint32_t>(s, dbi_block * bs + 8, f.dbi_age);
+
+        return s;
+    }
+
+    MOB_TEST(pe32_plus_with_codeview)
+    {
+        const auto pe = parse_pe(make_pe());
+
+        MOB_CHECK(pe);
+        MOB_CHECK(pe->timestamp == pe_timestamp);
+        MOB_CHECK(pe->image_size == pe_image_size);
+        MOB_CHECK(pe->pdb);
+        MOB_CHECK(pe->pdb->guid == guid);
+        MOB_CHECK(pe->pdb->age == 0x2a);
+        MOB_CHECK(pe->pdb_path == pdb_path);
+    }
+
+    MOB_TEST(pe32_with_codeview)
+    {
+        const auto pe = parse_pe(make_pe({.pe32_plus = false}));
+
+        MOB_CHECK(pe);
+        MOB_CHECK(pe->timestamp == pe_timestamp);
+        MOB_CHECK(pe->pdb);
+        MOB_CHECK(pe->pdb_path == pdb_path);
+    }
+
+    MOB_TEST(pe_keys)
+    {
+        const auto pe = parse_pe(make_pe());
+
+        // uppercase timestamp, lowercase image size, like symstore
+        MOB_CHECK(pe->key() == "5F3E2A1B1a000");
+
+        // the first three parts of the guid are little-endian, the age is hex
+        MOB_CHECK(pe->pdb->key() == guid_key + "2A");
+
+        pdb_id id;
+        id.guid = guid;
+        id.age  = 1;
+        MOB_CHECK(id.key() == guid_key + "1");
+    }
+
+    MOB_TEST(pe_without_codeview)
+    {
+        // valid binaries, but there's no pdb to look for
+        const auto no_debug = parse_pe(make_pe({.debug_directory = false}));
+        MOB_CHECK(no_debug);
+        MOB_CHECK(!no_debug->pdb);
+
+        const auto other_type = parse_pe(make_pe({.cv_type = 4}));
+        MOB_CHECK(other_type);
+        MOB_CHECK(!other_type->pdb);
+
+        // "NB10", codeview 2.0
+        const auto old_cv = parse_pe(make_pe({.cv_magic = 0x3031424e}));
+        MOB_CHECK(old_cv);
+        MOB_CHECK(!old_cv->pdb);
+    }
+
+    MOB_TEST(pe_not_a_pe)
+    {
+        MOB_CHECK(!parse_pe(""));
+        MOB_CHECK(!parse_pe("MZ"));
+        MOB_CHECK(!parse_pe(make_pdb()));
+
+        auto bad_mz = make_pe();
+        bad_mz[0]   = 'X';
+        MOB_CHECK(!parse_pe(bad_mz));
+
+        auto bad_sig = make_pe();
+        put_bytes(bad_sig, pe_offset, "NE");
+        MOB_CHECK(!parse_pe(bad_sig));
+
+        auto bad_magic = make_pe();
+        put<std::uint16_t>(bad_magic, opt_offset, 0x107);
+        MOB_CHECK(!parse_pe(bad_magic));
+    }
+
+    MOB_TEST(pe_truncated)
+    {
+        const auto full = make_pe();
+
+        // nothing can be parsed without the whole optional header up to the
+        // image size
+        for (std::size_t n = 0; n < opt_offset + 60; ++n)
+            MOB_CHECK(!parse_pe(full.substr(0, n)));
+
+        // the headers are complete, but the pdb is only found once the whole
+        // codeview record is there
+        const auto cv_end = cv_offset + 24 + pdb_path.size() + 1;
+
+        for (std::size_t n = opt_offset + 60; n < full.size(); ++n) {
+            const auto pe = parse_pe(full.substr(0, n));
+
+            if (pe && pe->pdb)
+                MOB_CHECK(n >= cv_end);
+        }
+    }
+
+    MOB_TEST(pe_out_of_bounds)
+    {
+        // e_lfanew past the end
+        auto lfanew = make_pe();
+        put<std::uint32_t>(lfanew, 0x3c, 0xfffffff0);
+        MOB_CHECK(!parse_pe(lfanew));
+
+        // more sections than there are in the file, the debug directory is in
+        // the first one so it's still found
+        auto sections = make_pe();
+        put<std::uint16_t>(sections, coff_offset + 2, 0xffff);
+        MOB_CHECK(parse_pe(sections));
+
+        // debug directory rva outside of any section
+        auto rva = make_pe();
+        put<std::uint32_t>(rva, opt_offset + 108 + 4 + 6 * 8, 0x80000000);
+        MOB_CHECK(parse_pe(rva));
+        MOB_CHECK(!parse_pe(rva)->pdb);
+
+        // huge debug directory, the entries past the end of the file are
+        // ignored
+        auto debug_size = make_pe();
+        put<std::uint32_t>(debug_size, opt_offset + 108 + 4 + 6 * 8 + 4, 0xffffffe0);
+        MOB_CHECK(parse_pe(debug_size));
+        MOB_CHECK(parse_pe(debug_size)->pdb);
+
+        // codeview record past the end, or larger than the file
+        auto cv_offset_bad = make_pe();
+        put<std::uint32_t>(cv_offset_bad, debug_offset + 24, 0xfffffff0);
+        MOB_CHECK(!parse_pe(cv_offset_bad)->pdb);
+
+        auto cv_size_bad = make_pe();
+        put<std::uint32_t>(cv_size_bad, debug_offset + 16, 0xfffffff0);
+        MOB_CHECK(!parse_pe(cv_size_bad)->pdb);
+    }
+
+    MOB_TEST(pdb_info_and_dbi)
+    {
+        const auto id = parse_pdb(make_pdb());
+
+        // the age comes from the dbi stream, not the info stream
+        MOB_CHECK(id);
+        MOB_CHECK(id->guid == guid);
+        MOB_CHECK(id->age == 0x2a);
+        MOB_CHECK(id->key() == guid_key + "2A");
+    }
+
+    MOB_TEST(pdb_other_block_size)
+    {
+        const auto id = parse_pdb(make_pdb({.block_size = 4096}));
+
+        MOB_CHECK(id);
+        MOB_CHECK(id->guid == guid);
+        MOB_CHECK(id->age == 0x2a);
+    }
+
+    MOB_TEST(pdb_without_dbi)
+    {
+        // falls back to the age of the info stream
+        const auto id = parse_pdb(make_pdb({.dbi_stream = false}));
+
+        MOB_CHECK(id);
+        MOB_CHECK(id->age == 7);
+    }
+
+    MOB_TEST(pdb_matches_pe)
+    {
+        // what the symbol store cross-checks
+        const auto pe  = parse_pe(make_pe());
+        const auto pdb = parse_pdb(make_pdb());
+
+        MOB_CHECK(pe->pdb->key() == pdb->key());
+    }
+
+    MOB_TEST(pdb_not_a_pdb)
+    {
+        MOB_CHECK(!parse_pdb(""));
+        MOB_CHECK(!parse_pdb(make_pe()));
+
+        // msf 2.0
+        auto old = make_pdb();
+        put_bytes(old, 0, "Microsoft C/C++ program database 2.00\r\n");
+        MOB_CHECK(!parse_pdb(old));
+    }
+
+    MOB_TEST(pdb_truncated)
+    {
+        const auto full = make_pdb();
+
+        // the info stream is in the 4th block
+        for (std::size_t n = 0; n < (info_block * 512) + 28; ++n)
+            MOB_CHECK(!parse_pdb(full.substr(0, n)));
+
+        // without the dbi stream, the age is the one from the info stream
+        const auto no_dbi = parse_pdb(full.substr(0, dbi_block * 512));
+        MOB_CHECK(no_dbi);
+        MOB_CHECK(no_dbi->age == 7);
+    }
+
+    MOB_TEST(pdb_out_of_bounds)
+    {
+        // a zero block size would divide by zero
+        auto zero = make_pdb();
+        put<std::uint32_t>(zero, 32, 0);
+        MOB_CHECK(!parse_pdb(zero));
+
+        // directory larger than the file
+        auto dir_size = make_pdb();
+        put<std::uint32_t>(dir_size, dir_size_offset, 0xfffffff0);
+        MOB_CHECK(!parse_pdb(dir_size));
+
+        // block map and directory blocks past the end
+        auto map = make_pdb();
+        put<std::uint32_t>(map, 52, 0xffffff);
+        MOB_CHECK(!parse_pdb(map));
+
+        auto dir = make_pdb();
+        put<std::uint32_t>(dir, map_block * 512, 0xffffff);
+        MOB_CHECK(!parse_pdb(dir));
+
+        // more streams than the directory has
+        auto count = make_pdb();
+        put<std::uint32_t>(count, dir_block * 512, 0xffffffff);
+        MOB_CHECK(!parse_pdb(count));
+
+        // info stream block past the end
+        auto info = make_pdb();
+        put<std::uint32_t>(info, dir_block * 512 + 20, 0xffffff);
+        MOB_CHECK(!parse_pdb(info));
+
+        // huge stream before the info stream, its blocks would be past the end
+        // of the directory
+        auto huge = make_pdb();
+        put<std::uint32_t>(huge, dir_block * 512 + 4, 0xfffffff0);
+        MOB_CHECK(!parse_pdb(huge));
+    }
+
+}  // namespace mob::tests
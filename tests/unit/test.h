@@ -0,0 +1,29 @@
+#pragma once
+
+// minimal test runner for the unit tests, see main.cpp
+//
+// a test is a function defined with MOB_TEST(name), checks in it use
+// MOB_CHECK(), which reports the failure and lets the test continue
+
+#include "../../src/pch.h"
+
+namespace mob::tests {
+
+    using test_function = void (*)();
+
+    // registers a test, called by MOB_TEST() before main()
+    //
+    bool add(const char* name, test_function f);
+
+    // reports a failed check if `b` is false
+    //
+    void check(bool b, const char* exp, const char* file, int line);
+
+}  // namespace mob::tests
+
+#define MOB_TEST(name)                                                                 \
+    static void name();                                                                \
+    static const bool name##_added = mob::tests::add(#name, name);                     \
+    static void name()
+
+#define MOB_CHECK(x) mob::tests::check(static_cast<bool>(x), #x, __FILE__, __LINE__)